@@ -0,0 +1,92 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTypes.h"
+
+/**
+ * The arguments of a log message captured from a variable argument list, so the
+ * message can be formatted at a later time on another thread. Scalars are copied
+ * by value, C strings are copied and objects are retained.
+ * Formats with positional arguments (%1$@), variable width or precision (%*d)
+ * or %n are not supported.
+ */
+@interface NXLogArguments : NSObject
+
+#pragma mark - Properties
+
+/// The message format
+@property (nonatomic, readonly) NSString *format;
+/// Whether the format contains variables like $(Process), which have to be expanded before the arguments are substituted
+@property (nonatomic, readonly) BOOL containsVariables;
+
+#pragma mark - Designated initializer
+
+/**
+ * Capture the arguments for a message format
+ *
+ * @param format The message format as in -[NSString initWithFormat:arguments:]
+ * @param site The call site of the log statement or NULL. If the call site is cacheable,
+ * the parsed format is cached with it.
+ * @param arguments The arguments to substitute into format
+ * @return The captured arguments or nil if the format is not supported
+ */
+- (instancetype)initWithFormat:(NSString *)format site:(NXLogCallSite *)site arguments:(va_list)arguments NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Class methods
+
+/**
+ * Whether a message format contains variables like $(Process)
+ *
+ * @param format The message format
+ * @param site The call site of the log statement or NULL. If the call site is cacheable,
+ * the answer is taken from the parsed format cached with it.
+ * @return YES, if the format contains variables
+ */
++ (BOOL)formatContainsVariables:(NSString *)format site:(NXLogCallSite *)site;
+
+#pragma mark - Formatting
+
+/**
+ * Format the message
+ *
+ * @return The same string -[NSString initWithFormat:arguments:] would have returned
+ * for the format and the original arguments
+ */
+- (NSString *)message;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
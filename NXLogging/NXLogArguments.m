@@ -0,0 +1,495 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogArguments.h"
+#import <stddef.h>
+#import <stdint.h>
+
+/// The type of a captured argument as read from the variable argument list
+typedef NS_ENUM(uint8_t, NXLogArgumentType) {
+    NXLogArgumentTypeInt,
+    NXLogArgumentTypeLong,
+    NXLogArgumentTypeLongLong,
+    NXLogArgumentTypeSize,
+    NXLogArgumentTypePtrDiff,
+    NXLogArgumentTypeIntMax,
+    NXLogArgumentTypeDouble,
+    NXLogArgumentTypeLongDouble,
+    NXLogArgumentTypeCString,
+    NXLogArgumentTypeUniString,
+    NXLogArgumentTypePointer,
+    NXLogArgumentTypeObject,
+};
+
+/// A captured argument
+typedef struct _NXLogArgument {
+    NXLogArgumentType type;
+    union {
+        int i;
+        long l;
+        long long ll;
+        size_t z;
+        ptrdiff_t t;
+        intmax_t j;
+        double d;
+        long double ld;
+        void *p;
+    } value;
+} NXLogArgument;
+
+/**
+ * A parsed message format: the types of its arguments and the format split into
+ * segments, each containing a single conversion specification (and the literal
+ * text preceding it), plus the trailing literal text.
+ */
+@interface NXLogFormatSignature : NSObject
+
+@property (nonatomic, readonly) NSString *format;
+@property (nonatomic, readonly) NSArray<NSString *> *segments;
+@property (nonatomic, readonly) NSString *trailer;
+@property (nonatomic, readonly) NSUInteger count;
+@property (nonatomic, readonly) const NXLogArgumentType *types;
+/// The precision of each conversion, NSUIntegerMax if it has none
+@property (nonatomic, readonly) const NSUInteger *precisions;
+/// Whether the format contains variables like $(Process)
+@property (nonatomic, readonly) BOOL containsVariables;
+
+- (instancetype)initWithFormat:(NSString *)format;
+
++ (instancetype)signatureForFormat:(NSString *)format site:(NXLogCallSite *)site;
+
+@end
+
+@implementation NXLogArguments {
+    NXLogFormatSignature *_signature;
+    NXLogArgument *_arguments;
+}
+
+- (instancetype)initWithFormat:(NSString *)format site:(NXLogCallSite *)site arguments:(va_list)arguments {
+    NXLogFormatSignature *signature = [NXLogFormatSignature signatureForFormat:format site:site];
+    
+    if (signature == nil) {
+        return nil;
+    }
+    
+    self = [super init];
+    if (self) {
+        NSUInteger count = signature.count;
+        const NXLogArgumentType *types = signature.types;
+        const NSUInteger *precisions = signature.precisions;
+        
+        _signature = signature;
+        _format = format;
+        _arguments = count ? calloc(count, sizeof(NXLogArgument)) : NULL;
+        
+        for (NSUInteger i = 0; i < count; i++) {
+            NXLogArgument *arg = &_arguments[i];
+            
+            arg->type = types[i];
+            
+            switch (types[i]) {
+                case NXLogArgumentTypeInt:
+                    arg->value.i = va_arg(arguments, int);
+                    break;
+                case NXLogArgumentTypeLong:
+                    arg->value.l = va_arg(arguments, long);
+                    break;
+                case NXLogArgumentTypeLongLong:
+                    arg->value.ll = va_arg(arguments, long long);
+                    break;
+                case NXLogArgumentTypeSize:
+                    arg->value.z = va_arg(arguments, size_t);
+                    break;
+                case NXLogArgumentTypePtrDiff:
+                    arg->value.t = va_arg(arguments, ptrdiff_t);
+                    break;
+                case NXLogArgumentTypeIntMax:
+                    arg->value.j = va_arg(arguments, intmax_t);
+                    break;
+                case NXLogArgumentTypeDouble:
+                    arg->value.d = va_arg(arguments, double);
+                    break;
+                case NXLogArgumentTypeLongDouble:
+                    arg->value.ld = va_arg(arguments, long double);
+                    break;
+                case NXLogArgumentTypeCString: {
+                    const char *str = va_arg(arguments, const char *);
+                    if (str) {
+                        // With a precision the string need not be terminated, so never read beyond it
+                        size_t length = precisions[i] == NSUIntegerMax ? strlen(str) : strnlen(str, precisions[i]);
+                        arg->value.p = malloc(length + 1);
+                        memcpy(arg->value.p, str, length);
+                        ((char *)arg->value.p)[length] = '\0';
+                    }
+                    break;
+                }
+                case NXLogArgumentTypeUniString: {
+                    const unichar *str = va_arg(arguments, const unichar *);
+                    if (str) {
+                        size_t length = 0;
+                        while (length < precisions[i] && str[length]) {
+                            length++;
+                        }
+                        arg->value.p = malloc((length + 1) * sizeof(unichar));
+                        memcpy(arg->value.p, str, length * sizeof(unichar));
+                        ((unichar *)arg->value.p)[length] = 0;
+                    }
+                    break;
+                }
+                case NXLogArgumentTypePointer:
+                    arg->value.p = va_arg(arguments, void *);
+                    break;
+                case NXLogArgumentTypeObject: {
+                    id obj = va_arg(arguments, id);
+                    arg->value.p = obj ? (void *)CFBridgingRetain(obj) : NULL;
+                    break;
+                }
+            }
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    NSUInteger count = _signature.count;
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        NXLogArgument *arg = &_arguments[i];
+        
+        if (arg->value.p == NULL) {
+            continue;
+        }
+        switch (arg->type) {
+            case NXLogArgumentTypeCString:
+            case NXLogArgumentTypeUniString:
+                free(arg->value.p);
+                break;
+            case NXLogArgumentTypeObject:
+                CFRelease(arg->value.p);
+                break;
+            default:
+                break;
+        }
+    }
+    free(_arguments);
+}
+
+- (BOOL)containsVariables {
+    return _signature.containsVariables;
+}
+
++ (BOOL)formatContainsVariables:(NSString *)format site:(NXLogCallSite *)site {
+    NXLogFormatSignature *signature = site && site->cacheable ? [NXLogFormatSignature signatureForFormat:format site:site] : nil;
+    
+    if (signature) {
+        return signature.containsVariables;
+    }
+    return [format rangeOfString:@"$(" options:NSLiteralSearch].location != NSNotFound;
+}
+
+- (NSString *)message {
+    NSArray<NSString *> *segments = _signature.segments;
+    NSUInteger count = _signature.count;
+    NSMutableString *message = [NSMutableString new];
+    
+    // Format every segment with its single argument
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *segment = segments[i];
+        NXLogArgument *arg = &_arguments[i];
+        NSString *str = nil;
+        
+        switch (arg->type) {
+            case NXLogArgumentTypeInt:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.i];
+                break;
+            case NXLogArgumentTypeLong:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.l];
+                break;
+            case NXLogArgumentTypeLongLong:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.ll];
+                break;
+            case NXLogArgumentTypeSize:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.z];
+                break;
+            case NXLogArgumentTypePtrDiff:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.t];
+                break;
+            case NXLogArgumentTypeIntMax:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.j];
+                break;
+            case NXLogArgumentTypeDouble:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.d];
+                break;
+            case NXLogArgumentTypeLongDouble:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.ld];
+                break;
+            case NXLogArgumentTypeCString:
+            case NXLogArgumentTypeUniString:
+            case NXLogArgumentTypePointer:
+                str = [[NSString alloc] initWithFormat:segment, arg->value.p];
+                break;
+            case NXLogArgumentTypeObject:
+                str = [[NSString alloc] initWithFormat:segment, (__bridge id)arg->value.p];
+                break;
+        }
+        if (str) {
+            [message appendString:str];
+        }
+    }
+    
+    [message appendString:_signature.trailer];
+    
+    return message;
+}
+
+@end
+
+@implementation NXLogFormatSignature {
+    NXLogArgumentType *_types;
+    NSUInteger *_precisions;
+}
+
++ (instancetype)signatureForFormat:(NSString *)format site:(NXLogCallSite *)site {
+    
+    // Use the signature cached with the call site, if it was made for the very same format ...
+    
+    void *cached = site ? __atomic_load_n(&site->formatCache, __ATOMIC_ACQUIRE) : NULL;
+    
+    if (cached && ((__bridge NXLogFormatSignature *)cached).format == format) {
+        return (__bridge NXLogFormatSignature *)cached;
+    }
+    
+    // ... or parse the format
+    
+    NXLogFormatSignature *signature = [[self alloc] initWithFormat:format];
+    
+    if (signature && site && site->cacheable && cached == NULL) {
+        
+        // Publish the signature. It retains the format, so its address cannot be reused
+        // by another format while the signature is cached.
+        
+        void *expected = NULL;
+        void *retained = (void *)CFBridgingRetain(signature);
+        
+        if (!__atomic_compare_exchange_n(&site->formatCache, &expected, retained, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            CFRelease(retained);
+        }
+    }
+    
+    return signature;
+}
+
+- (instancetype)initWithFormat:(NSString *)format {
+    self = [super init];
+    if (self) {
+        NSUInteger length = format.length;
+        unichar *chars = malloc(MAX(length, 1) * sizeof(unichar));
+        NSMutableArray<NSString *> *segments = [NSMutableArray new];
+        NSMutableData *types = [NSMutableData new];
+        NSMutableData *precisions = [NSMutableData new];
+        NSUInteger segmentStart = 0;
+        NSUInteger i = 0;
+        BOOL supported = YES;
+        
+        [format getCharacters:chars range:NSMakeRange(0, length)];
+        
+        while (i < length && supported) {
+            if (chars[i] != '%') {
+                i++;
+                continue;
+            }
+            
+            i++;
+            
+            // Escaped percent sign
+            
+            if (i < length && chars[i] == '%') {
+                i++;
+                continue;
+            }
+            
+            // Positional arguments (not supported)
+            
+            NSUInteger j = i;
+            while (j < length && chars[j] >= '0' && chars[j] <= '9') {
+                j++;
+            }
+            if (j < length && j > i && chars[j] == '$') {
+                supported = NO;
+                break;
+            }
+            
+            // Flags
+            
+            while (i < length && (chars[i] == '-' || chars[i] == '+' || chars[i] == ' ' || chars[i] == '#' || chars[i] == '0' || chars[i] == '\'')) {
+                i++;
+            }
+            
+            // Width and precision (only literal numbers supported)
+            
+            NSUInteger precision = NSUIntegerMax;
+            
+            while (i < length && chars[i] >= '0' && chars[i] <= '9') {
+                i++;
+            }
+            if (i < length && chars[i] == '.') {
+                i++;
+                precision = 0;
+                while (i < length && chars[i] >= '0' && chars[i] <= '9') {
+                    precision = precision < INT_MAX / 10 ? precision * 10 + (chars[i] - '0') : INT_MAX;
+                    i++;
+                }
+            }
+            if (i < length && chars[i] == '*') {
+                supported = NO;
+                break;
+            }
+            
+            // Length modifier
+            
+            unichar modifier = 0;
+            
+            if (i < length) {
+                switch (chars[i]) {
+                    case 'h':
+                        modifier = 'h';
+                        i += (i + 1 < length && chars[i + 1] == 'h') ? 2 : 1;
+                        break;
+                    case 'l':
+                        modifier = (i + 1 < length && chars[i + 1] == 'l') ? 'q' : 'l';
+                        i += modifier == 'q' ? 2 : 1;
+                        break;
+                    case 'q':
+                    case 'L':
+                    case 'z':
+                    case 't':
+                    case 'j':
+                        modifier = chars[i];
+                        i++;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            
+            if (i >= length) {
+                supported = NO;
+                break;
+            }
+            
+            // Conversion
+            
+            NXLogArgumentType type;
+            
+            switch (chars[i]) {
+                case 'c': case 'C':
+                    type = NXLogArgumentTypeInt; // A wint_t (%lc) is promoted to int as well
+                    break;
+                case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+                    switch (modifier) {
+                        case 'l': type = NXLogArgumentTypeLong; break;
+                        case 'q': case 'L': type = NXLogArgumentTypeLongLong; break;
+                        case 'z': type = NXLogArgumentTypeSize; break;
+                        case 't': type = NXLogArgumentTypePtrDiff; break;
+                        case 'j': type = NXLogArgumentTypeIntMax; break;
+                        default: type = NXLogArgumentTypeInt; break;
+                    }
+                    break;
+                case 'D': case 'O': case 'U':
+                    type = NXLogArgumentTypeLong;
+                    break;
+                case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                    type = modifier == 'L' ? NXLogArgumentTypeLongDouble : NXLogArgumentTypeDouble;
+                    break;
+                case 's':
+                    type = NXLogArgumentTypeCString;
+                    supported = modifier == 0;
+                    break;
+                case 'S':
+                    type = NXLogArgumentTypeUniString;
+                    break;
+                case 'p':
+                    type = NXLogArgumentTypePointer;
+                    break;
+                case '@':
+                    type = NXLogArgumentTypeObject;
+                    break;
+                default: // %n and unknown conversions
+                    supported = NO;
+                    type = NXLogArgumentTypePointer;
+                    break;
+            }
+            
+            i++;
+            
+            [segments addObject:[format substringWithRange:NSMakeRange(segmentStart, i - segmentStart)]];
+            [types appendBytes:&type length:sizeof(type)];
+            [precisions appendBytes:&precision length:sizeof(precision)];
+            segmentStart = i;
+        }
+        
+        free(chars);
+        
+        if (!supported) {
+            return nil;
+        }
+        
+        // The trailing literal text is never formatted, so unescape it right away
+        
+        _trailer = [[format substringFromIndex:segmentStart] stringByReplacingOccurrencesOfString:@"%%" withString:@"%"];
+        _format = format;
+        _containsVariables = [format rangeOfString:@"$(" options:NSLiteralSearch].location != NSNotFound;
+        _segments = segments;
+        _count = segments.count;
+        _types = malloc(MAX(types.length, 1));
+        memcpy(_types, types.bytes, types.length);
+        _precisions = malloc(MAX(precisions.length, 1));
+        memcpy(_precisions, precisions.bytes, precisions.length);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_types);
+    free(_precisions);
+}
+
+- (const NXLogArgumentType *)types {
+    return _types;
+}
+
+- (const NSUInteger *)precisions {
+    return _precisions;
+}
+
+@end
@@ -31,6 +31,7 @@
 // -----------------------------------------------------------------------------
 
 #import <Foundation/Foundation.h>
+#import "NXLogTypes.h"
 
 /// Information about the log client.
 @interface NXLogClientInfo : NSObject
@@ -42,6 +43,10 @@
 @property (nonatomic, readonly) NSString *function;
 /// The log caller's file path
 @property (nonatomic, readonly) NSString *file;
+/// The last path component of the log caller's file path
+@property (nonatomic, readonly) NSString *fileName;
+/// The log caller's function name shortened to "[Class method]" for Objective C methods
+@property (nonatomic, readonly) NSString *methodName;
 /// The log caller's line number
 @property (nonatomic, readonly) NSNumber *line;
 /// The log caller's module
@@ -60,9 +65,11 @@
 @property (nonatomic, readonly) NSString *systemName;
 /// The log caller's operating system version
 @property (nonatomic, readonly) NSString *systemVersion;
+/// The bit mask representing the info that was captured. Info not captured is nil.
+@property (nonatomic, readonly) NXLogInfo capturedInfo;
 
-#pragma mark - Designated initializer
-/// @name Designated initializer
+#pragma mark - Initializers
+/// @name Initializers
 
 /**
  * Create the log info from some basic info.
@@ -71,20 +78,74 @@
  * or to be precise, a dictionary with the keys @(NXLogInfoFile), @(NXLogInfoFunction),
  * and @(NXLogInfoLine) and their corresponding values.
  */
-- (instancetype)initWithSourceCodeInfo:(NSDictionary *)info NS_DESIGNATED_INITIALIZER;
+- (instancetype)initWithSourceCodeInfo:(NSDictionary *)info;
+
+/**
+ * Create the log info from a call site.
+ *
+ * @param site The call site of the log statement. Normally NX_LOG_SITE would be passed.
+ * If the call site is cacheable, the info derived from it is computed only once and
+ * stored with the call site.
+ */
+- (instancetype)initWithCallSite:(NXLogCallSite *)site;
+
+/**
+ * Create the log info from a call site, capturing only the given info.
+ *
+ * @param site The call site of the log statement. Normally NX_LOG_SITE would be passed.
+ * @param capturedInfo The bit mask representing the info to capture. If the date is not
+ * included, the clock is not even read.
+ */
+- (instancetype)initWithCallSite:(NXLogCallSite *)site capturedInfo:(NXLogInfo)capturedInfo;
+
+/**
+ * Create the log info from a call site and a date captured earlier, capturing only the given info.
+ *
+ * @param site The call site of the log statement. Normally NX_LOG_SITE would be passed.
+ * @param capturedInfo The bit mask representing the info to capture.
+ * @param date The date of the log statement. Ignored, if capturedInfo does not include the date.
+ */
+- (instancetype)initWithCallSite:(NXLogCallSite *)site capturedInfo:(NXLogInfo)capturedInfo date:(NSDate *)date;
+
+/**
+ * Create the log info from a call site and a date captured earlier, capturing only the given info.
+ * Variables for the source code info and the date can be expanded even if they are not captured.
+ *
+ * @param site The call site of the log statement. Normally NX_LOG_SITE would be passed.
+ * @param capturedInfo The bit mask representing the info to capture.
+ * @param date The date of the log statement or nil to read the clock, if needed.
+ * @param expandsVariables Whether to keep the source code info and the date for variables,
+ * even if they are not captured. Pass YES, if the message format contains variables.
+ */
+- (instancetype)initWithCallSite:(NXLogCallSite *)site capturedInfo:(NXLogInfo)capturedInfo date:(NSDate *)date expandsVariables:(BOOL)expandsVariables;
 
 #pragma mark - Public methods
 ///@name Other methods
 
 /**
  * Replaces all variables in a string with their values
- * Variables are formed $(variable) where variable is one of this class' property names
+ * Variables are formed $(variable) where variable is one of this class' property names.
+ * Variables for source code info or a date that was not captured are left untouched, unless the
+ * log info was created to expand them. Process, device and system info is always available.
+ * The string is scanned once from left to right, values inserted are not scanned again.
  *
  * @param string The string to search
  * @return The resulting string
  */
 - (NSString *)stringByReplacingVariablesInString:(NSString *)string;
 
+/**
+ * Replaces all variables in a format string with their values, before the format arguments
+ * are substituted. Thus argument text containing "$(" is never taken for a variable.
+ * Any % in a value is escaped, so the result is still a valid format.
+ * The positions of the variables are cached per format string instance (normally a literal),
+ * hence a format is scanned only once.
+ *
+ * @param format The format string to search
+ * @return The resulting format string
+ */
+- (NSString *)formatByReplacingVariablesInFormat:(NSString *)format;
+
 #pragma mark - Unavailable methods
 
 + (id)new NS_UNAVAILABLE;
@@ -31,87 +31,452 @@
 // -----------------------------------------------------------------------------
 
 #import "NXLogClientInfo.h"
-#import <UIKit/UIKit.h>
-#import <sys/utsname.h>
+#import "NXLogHostInfo.h"
 #import "NXLogTypes.h"
-#include <pthread.h>
+#import "NXLogTimestampRenderer.h"
+#import <pthread.h>
 
-@interface NSMutableString (NXLogging)
+/// A variable that may be used in the form $(name)
+typedef struct {
+    __unsafe_unretained NSString *name;
+    NXLogInfo info;
+} NXLogVariable;
 
--(void)replaceVariable:(NSString *)variable with:(id)value;
+static const NXLogVariable NXLogVariables[] = {
+    { @"file",          NXLogInfoFile },
+    { @"function",      NXLogInfoFunction },
+    { @"line",          NXLogInfoLine },
+    { @"module",        NXLogInfoModule },
+    { @"date",          NXLogInfoDate },
+    { @"processName",   NXLogInfoProcessName },
+    { @"processID",     NXLogInfoProcessID },
+    { @"deviceName",    NXLogInfoDeviceName },
+    { @"deviceModel",   NXLogInfoDeviceModel },
+    { @"systemName",    NXLogInfoSystemName },
+    { @"systemVersion", NXLogInfoSystemVersion },
+};
+
+static const NSUInteger NXLogVariableCount = sizeof(NXLogVariables) / sizeof(NXLogVariables[0]);
+
+/// The maximum number of format templates a thread caches before its cache is cleared
+static const NSUInteger NXLogVariableTemplateCacheLimit = 256;
+
+static pthread_key_t NXLogVariableTemplatesKey;
+
+static void _NXLogFreeVariableTemplates(void *templates) {
+    CFRelease(templates);
+}
+
+/// Returns the index of the variable with the given name in NXLogVariables or NSNotFound
+static NSUInteger NXLogVariableIndex(NSString *name) {
+    for (NSUInteger i = 0; i < NXLogVariableCount; i++) {
+        if ([NXLogVariables[i].name isEqualToString:name]) {
+            return i;
+        }
+    }
+    return NSNotFound;
+}
+
+/// A format string split into literal parts (NSString) and variables (NSNumber indexes into NXLogVariables)
+@interface NXLogVariableTemplate : NSObject
+
+@property (nonatomic, readonly) NSArray *parts;
+@property (nonatomic, readonly) BOOL hasVariables;
+
+- (instancetype)initWithString:(NSString *)string;
+
+@end
+
+/// Info derived from the source code location of a log statement
+@interface NXLogSourceInfo : NSObject
+
+@property (nonatomic, readonly) NSString *function;
+@property (nonatomic, readonly) NSString *methodName;
+@property (nonatomic, readonly) NSString *file;
+@property (nonatomic, readonly) NSString *fileName;
+@property (nonatomic, readonly) NSNumber *line;
+@property (nonatomic, readonly) NSString *module;
+
+- (instancetype)initWithFunction:(NSString *)function file:(NSString *)file line:(NSNumber *)line module:(NSString *)module;
+
++ (instancetype)sourceInfoForCallSite:(NXLogCallSite *)site;
+
+@end
+
+@interface NXLogClientInfo ()
+
+- (instancetype)_initWithSourceInfo:(NXLogSourceInfo *)source capturedInfo:(NXLogInfo)capturedInfo date:(NSDate *)date NS_DESIGNATED_INITIALIZER;
 
 @end
 
 @implementation NXLogClientInfo  {
-    NSDateFormatter *_dateFormatter;
+    NXLogSourceInfo *_source;
+    NXLogHostInfo *_host;
+    NSDate *_variableDate; // The date for variables, even if it was not captured
+    BOOL _expandsVariables;
 }
 
 - (instancetype)initWithSourceCodeInfo:(NSDictionary *)info {
+    NXLogSourceInfo *source = [[NXLogSourceInfo alloc] initWithFunction:info[@(NXLogInfoFunction)]
+                                                                   file:info[@(NXLogInfoFile)]
+                                                                   line:info[@(NXLogInfoLine)]
+                                                                 module:info[@(NXLogInfoModule)]];
+    return [self _initWithSourceInfo:source capturedInfo:NXLogInfoAll date:[NSDate new]];
+}
+
+- (instancetype)initWithCallSite:(NXLogCallSite *)site {
+    return [self initWithCallSite:site capturedInfo:NXLogInfoAll];
+}
+
+- (instancetype)initWithCallSite:(NXLogCallSite *)site capturedInfo:(NXLogInfo)capturedInfo {
+    return [self initWithCallSite:site capturedInfo:capturedInfo date:capturedInfo & NXLogInfoDate ? [NSDate new] : nil];
+}
+
+- (instancetype)initWithCallSite:(NXLogCallSite *)site capturedInfo:(NXLogInfo)capturedInfo date:(NSDate *)date {
+    NXLogSourceInfo *source = capturedInfo & (NXLogInfoSourceCode | NXLogInfoModule) ? [NXLogSourceInfo sourceInfoForCallSite:site] : nil;
+    
+    return [self _initWithSourceInfo:source capturedInfo:capturedInfo date:date];
+}
+
+- (instancetype)initWithCallSite:(NXLogCallSite *)site capturedInfo:(NXLogInfo)capturedInfo date:(NSDate *)date expandsVariables:(BOOL)expandsVariables {
+    if (!expandsVariables) {
+        return [self initWithCallSite:site capturedInfo:capturedInfo date:date ?: (capturedInfo & NXLogInfoDate ? [NSDate new] : nil)];
+    }
+    
+    NSDate *variableDate = date ?: [NSDate new];
+    
+    self = [self _initWithSourceInfo:site ? [NXLogSourceInfo sourceInfoForCallSite:site] : nil capturedInfo:capturedInfo date:variableDate];
+    if (self) {
+        _variableDate = variableDate;
+        _expandsVariables = YES;
+    }
+    return self;
+}
+
+- (instancetype)_initWithSourceInfo:(NXLogSourceInfo *)source capturedInfo:(NXLogInfo)capturedInfo date:(NSDate *)date {
     self = [super init];
     if (self) {
-        UIDevice *device = [UIDevice currentDevice];
-        NSProcessInfo *process = NSProcessInfo.processInfo;
-
-        _dateFormatter = [NSDateFormatter new]; // Beware: Only thread-safe from iOS 7 upwards
-        [_dateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
-
-        _file = info[@(NXLogInfoFile)];
-        _function = info[@(NXLogInfoFunction)];
-        _line = info[@(NXLogInfoLine)];
-        _module = info[@(NXLogInfoModule)];
-        _date = [NSDate new];
-        _processName = process.processName;
-        _processID = @(process.processIdentifier);
-        _deviceName = device.name;
-        _deviceModel = [self.class _model];//device.model;
-        _systemName = device.systemName;
-        _systemVersion = device.systemVersion;
+        _capturedInfo = capturedInfo;
+        _source = source;
+        _host = capturedInfo & (NXLogInfoProcess | NXLogInfoDevice | NXLogInfoSystem) ? [NXLogHostInfo currentHostInfo] : nil;
+        _date = capturedInfo & NXLogInfoDate ? date : nil;
     }
     return self;
 }
 
+- (NSString *)function {
+    return _capturedInfo & NXLogInfoFunction ? _source.function : nil;
+}
+
+- (NSString *)methodName {
+    return _capturedInfo & NXLogInfoFunction ? _source.methodName : nil;
+}
+
+- (NSString *)file {
+    return _capturedInfo & NXLogInfoFile ? _source.file : nil;
+}
+
+- (NSString *)fileName {
+    return _capturedInfo & NXLogInfoFile ? _source.fileName : nil;
+}
+
+- (NSNumber *)line {
+    return _capturedInfo & NXLogInfoLine ? _source.line : nil;
+}
+
+- (NSString *)module {
+    return _capturedInfo & NXLogInfoModule ? _source.module : nil;
+}
+
+- (NSString *)processName {
+    return _capturedInfo & NXLogInfoProcessName ? _host.processName : nil;
+}
+
+- (NSNumber *)processID {
+    return _capturedInfo & NXLogInfoProcessID ? _host.processID : nil;
+}
+
+- (NSString *)deviceName {
+    return _capturedInfo & NXLogInfoDeviceName ? _host.deviceName : nil;
+}
+
+- (NSString *)deviceModel {
+    return _capturedInfo & NXLogInfoDeviceModel ? _host.deviceModel : nil;
+}
+
+- (NSString *)systemName {
+    return _capturedInfo & NXLogInfoSystemName ? _host.systemName : nil;
+}
+
+- (NSString *)systemVersion {
+    return _capturedInfo & NXLogInfoSystemVersion ? _host.systemVersion : nil;
+}
+
 - (NSString *)stringByReplacingVariablesInString:(NSString *)string {
     
-    if ([string rangeOfString:@"$("].location != NSNotFound) {
-        NSMutableString *msg = [NSMutableString stringWithString:string];
+    NSRange range = [string rangeOfString:@"$(" options:NSLiteralSearch];
+    
+    if (range.location == NSNotFound) {
+        return string;
+    }
+    
+    // Scan once from left to right. Values are appended to the result and never scanned again.
+    
+    NSUInteger length = string.length;
+    NSUInteger pos = 0;
+    NSMutableString *msg = [NSMutableString stringWithCapacity:length];
+    
+    while (range.location != NSNotFound) {
+        NSUInteger nameStart = NSMaxRange(range);
+        NSRange close = [string rangeOfString:@")" options:NSLiteralSearch range:NSMakeRange(nameStart, length - nameStart)];
         
-        [msg replaceVariable:@"file" with:self.file.length ? self.file.lastPathComponent : nil];
-        [msg replaceVariable:@"function" with:self.function];
-        [msg replaceVariable:@"line" with:self.line];
-        [msg replaceVariable:@"module" with:self.module];
-        [msg replaceVariable:@"date" with:self.date ? [_dateFormatter stringFromDate:self.date] : nil];
-        [msg replaceVariable:@"processName" with:self.processName];
-        [msg replaceVariable:@"processID" with:self.processID];
-        [msg replaceVariable:@"deviceName" with:self.deviceName];
-        [msg replaceVariable:@"deviceModel" with:self.deviceModel];
-        [msg replaceVariable:@"systemName" with:self.systemName];
-        [msg replaceVariable:@"systemVersion" with:self.systemVersion];
+        if (close.location == NSNotFound) {
+            break;
+        }
+        
+        NSString *value = [self _valueOfVariableAtIndex:NXLogVariableIndex([string substringWithRange:NSMakeRange(nameStart, close.location - nameStart)])];
+        NSUInteger next = value ? NSMaxRange(close) : nameStart;
+        
+        [msg appendString:[string substringWithRange:NSMakeRange(pos, (value ? range.location : next) - pos)]];
+        if (value) {
+            [msg appendString:value];
+        }
+        pos = next;
+        
+        range = [string rangeOfString:@"$(" options:NSLiteralSearch range:NSMakeRange(pos, length - pos)];
+    }
+    
+    [msg appendString:[string substringFromIndex:pos]];
+    
+    return msg;
+}
 
-        return msg;
+- (NSString *)formatByReplacingVariablesInFormat:(NSString *)format {
+    
+    NXLogVariableTemplate *template = [self.class _templateForFormat:format];
+    
+    if (!template.hasVariables) {
+        return format;
     }
     
-    return string;
+    NSMutableString *result = [NSMutableString stringWithCapacity:format.length];
+    
+    for (id part in template.parts) {
+        if ([part isKindOfClass:NSNumber.class]) {
+            NSUInteger index = [part unsignedIntegerValue];
+            NSString *value = [self _valueOfVariableAtIndex:index];
+            
+            if (value) {
+                // The result is still a format, hence a literal % in the value needs to be escaped
+                
+                [result appendString:[value rangeOfString:@"%"].location == NSNotFound ? value : [value stringByReplacingOccurrencesOfString:@"%" withString:@"%%"]];
+            } else {
+                [result appendFormat:@"$(%@)", NXLogVariables[index].name];
+            }
+        } else {
+            [result appendString:part];
+        }
+    }
+    
+    return result;
 }
 
 #pragma mark - Private methods
 
-+ (NSString *)_model {
-    struct utsname systemInfo;
-    uname(&systemInfo);
+- (NSString *)_valueOfVariableAtIndex:(NSUInteger)index {
+    
+    if (index == NSNotFound) {
+        return nil; // Unknown variable
+    }
+    
+    NXLogInfo info = NXLogVariables[index].info;
+    
+    // Process, device and system info is the same for every record, so it is taken from the
+    // host even if the record did not capture it. Source code info and the date only are,
+    // if the record was created to expand variables.
+    
+    NXLogHostInfo *host = _host;
+    
+    if (!(_capturedInfo & info)) {
+        if (info & (NXLogInfoProcess | NXLogInfoDevice | NXLogInfoSystem)) {
+            host = [NXLogHostInfo currentHostInfo];
+        } else if (!_expandsVariables) {
+            return nil; // Info not captured
+        }
+    }
+    
+    NSDate *date = _date ?: _variableDate;
+    id value;
+    
+    switch (info) {
+        case NXLogInfoFile:          value = _source.fileName; break;
+        case NXLogInfoFunction:      value = _source.function; break;
+        case NXLogInfoLine:          value = _source.line; break;
+        case NXLogInfoModule:        value = _source.module; break;
+        case NXLogInfoDate:          value = date ? [[self.class _timestampRenderer] stringFromDate:date] : nil; break;
+        case NXLogInfoProcessName:   value = host.processName; break;
+        case NXLogInfoProcessID:     value = host.processID; break;
+        case NXLogInfoDeviceName:    value = host.deviceName; break;
+        case NXLogInfoDeviceModel:   value = host.deviceModel; break;
+        case NXLogInfoSystemName:    value = host.systemName; break;
+        case NXLogInfoSystemVersion: value = host.systemVersion; break;
+        default:                     value = nil; break;
+    }
+    
+    NSString *str = value ? [NSString stringWithFormat:@"%@", value] : nil;
+    
+    return str.length ? str : [NSString stringWithFormat:@"<Unknown %@>", NXLogVariables[index].name];
+}
+
++ (NXLogVariableTemplate *)_templateForFormat:(NSString *)format {
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        pthread_key_create(&NXLogVariableTemplatesKey, _NXLogFreeVariableTemplates);
+    });
+    
+    // Every thread caches its templates on its own, so looking them up takes no lock
+    
+    NSMapTable *templates = (__bridge NSMapTable *)pthread_getspecific(NXLogVariableTemplatesKey);
+    
+    if (!templates) {
+        // Keyed by the identity of the format, which normally is a string literal
+        templates = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                              valueOptions:NSPointerFunctionsStrongMemory
+                                                  capacity:NXLogVariableTemplateCacheLimit];
+        pthread_setspecific(NXLogVariableTemplatesKey, CFBridgingRetain(templates));
+    }
+    
+    NXLogVariableTemplate *template = [templates objectForKey:format];
+    
+    if (!template) {
+        template = [[NXLogVariableTemplate alloc] initWithString:format];
+        
+        if (templates.count >= NXLogVariableTemplateCacheLimit) {
+            [templates removeAllObjects]; // Formats built at runtime must not let the cache grow without bounds
+        }
+        [templates setObject:template forKey:format];
+    }
     
-    return [NSString stringWithCString:systemInfo.machine encoding:NSUTF8StringEncoding];
+    return template;
+}
+
++ (NXLogTimestampRenderer *)_timestampRenderer {
+    static NXLogTimestampRenderer *timestampRenderer = nil;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        NSDateFormatter *dateFormatter = [NSDateFormatter new]; // Beware: Only thread-safe from iOS 7 upwards
+        [dateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
+        timestampRenderer = [[NXLogTimestampRenderer alloc] initWithDateFormatter:dateFormatter];
+    });
+    return timestampRenderer;
 }
 
 @end
 
-@implementation NSMutableString (NXLogging)
+@implementation NXLogSourceInfo
 
--(void)replaceVariable:(NSString *)variable with:(id)value {
+- (instancetype)initWithFunction:(NSString *)function file:(NSString *)file line:(NSNumber *)line module:(NSString *)module {
+    self = [super init];
+    if (self) {
+        _function = function;
+        _file = file;
+        _line = line;
+        _module = module;
+        _fileName = file.length ? file.lastPathComponent : nil;
+        _methodName = function;
+        
+        // Shorten "-[Class method]" to "[Class method]"
+        
+        NSArray *comps = [function componentsSeparatedByCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"[]"]];
+        
+        if (comps.count >= 2) {
+            _methodName = [NSString stringWithFormat:@"[%@]", [comps objectAtIndex:1]];
+        }
+    }
+    return self;
+}
+
++ (instancetype)sourceInfoForCallSite:(NXLogCallSite *)site {
+    
+    // Use the info cached with the call site, if there is any ...
+    
+    void *cached = __atomic_load_n(&site->cache, __ATOMIC_ACQUIRE);
     
-    NSString *val = value ? [NSString stringWithFormat:@"%@", value] : nil;
-    val = val.length ? val : [NSString stringWithFormat:@"<Unknown %@>", variable];
+    if (cached) {
+        return (__bridge NXLogSourceInfo *)cached;
+    }
+    
+    // ... or derive it from the call site
     
-    [self replaceOccurrencesOfString:[NSString stringWithFormat:@"$(%@)", variable] withString:val options:NSLiteralSearch range:NSMakeRange(0, self.length)];
+    NXLogSourceInfo *info = [[self alloc] initWithFunction:site->function ? @(site->function) : nil
+                                                      file:site->file ? @(site->file) : nil
+                                                      line:site->line ? @(site->line) : nil
+                                                    module:site->module ? @(site->module) : nil];
+    
+    if (site->cacheable) {
+        
+        // Publish the info. If another thread was faster, use its info instead.
+        
+        void *expected = NULL;
+        void *retained = (void *)CFBridgingRetain(info);
+        
+        if (!__atomic_compare_exchange_n(&site->cache, &expected, retained, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            CFRelease(retained);
+            return (__bridge NXLogSourceInfo *)expected;
+        }
+    }
+    
+    return info;
+}
+
+@end
+
+@implementation NXLogVariableTemplate
+
+- (instancetype)initWithString:(NSString *)string {
+    self = [super init];
+    if (self) {
+        NSMutableArray *parts = [NSMutableArray new];
+        NSMutableString *literal = [NSMutableString new];
+        NSUInteger length = string.length;
+        NSUInteger pos = 0;
+        NSRange range = [string rangeOfString:@"$(" options:NSLiteralSearch];
+        
+        while (range.location != NSNotFound) {
+            NSUInteger nameStart = NSMaxRange(range);
+            NSRange close = [string rangeOfString:@")" options:NSLiteralSearch range:NSMakeRange(nameStart, length - nameStart)];
+            
+            if (close.location == NSNotFound) {
+                break;
+            }
+            
+            NSUInteger index = NXLogVariableIndex([string substringWithRange:NSMakeRange(nameStart, close.location - nameStart)]);
+            
+            if (index != NSNotFound) {
+                [literal appendString:[string substringWithRange:NSMakeRange(pos, range.location - pos)]];
+                if (literal.length) {
+                    [parts addObject:[literal copy]];
+                    [literal setString:@""];
+                }
+                [parts addObject:@(index)];
+                pos = NSMaxRange(close);
+                _hasVariables = YES;
+            } else {
+                [literal appendString:[string substringWithRange:NSMakeRange(pos, nameStart - pos)]];
+                pos = nameStart;
+            }
+            
+            range = [string rangeOfString:@"$(" options:NSLiteralSearch range:NSMakeRange(pos, length - pos)];
+        }
+        
+        [literal appendString:[string substringFromIndex:pos]];
+        if (literal.length) {
+            [parts addObject:[literal copy]];
+        }
+        
+        _parts = parts;
+    }
+    return self;
 }
 
 @end
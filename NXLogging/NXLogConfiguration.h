@@ -0,0 +1,118 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTarget.h"
+
+/**
+ * Configures loggers and log targets from a JSON file, which can be watched for changes,
+ * so log levels can be changed in a running process. The file looks like this:
+ *
+ *     {
+ *         "loggers": { "net": "Debug", "net.http": "Info" },
+ *         "targets": { "console": { "level": "Debug", "pattern": "%d %p %m", "hiddenInfo": ["deviceName"] } }
+ *     }
+ *
+ * Loggers are looked up (or created) with +[NXLogger loggerNamed:] and get the given maxLogLevel.
+ * Targets are referred to by the names they were registered with; the shared console and system
+ * log targets are registered as "console" and "system". A target takes the options "level" and,
+ * if its formatter supports them, "pattern", "hiddenInfo", "exceptionSymbolsThreshold",
+ * "expandsVariablesInFormat" and "prettyPrint". Levels are given by name, e.g. "Notice",
+ * or as "None" and "Any", and for loggers as "Inherit". Loggers and targets dropped from the file on reload
+ * get their former levels back; formatter options stay as they are.
+ *
+ * The settings are applied to the loggers and targets, which publish their new plans atomically,
+ * so logging threads never wait for a reconfiguration. The generation is incremented once
+ * after each complete configuration.
+ */
+@interface NXLogConfiguration : NSObject
+
+#pragma mark - Properties
+/// @name Properties
+
+/// The path of the configuration file
+@property (nonatomic, readonly) NSString *path;
+
+/// The number of configurations applied so far
+@property (atomic, readonly) NSUInteger generation;
+
+/// YES, while the file is watched for changes
+@property (atomic, readonly, getter=isWatching) BOOL watching;
+
+#pragma mark - Designated initializer
+/// @name Designated initializer
+
+/**
+ * Create a configuration for a file. The file is not read before reload or startWatching is called.
+ *
+ * @param path (input) The path of the configuration file
+ * @result The configuration
+ */
+- (instancetype)initWithPath:(NSString *)path NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Methods to manage targets
+/// @name Methods to manage targets
+
+/**
+ * Make a target configurable under a name
+ *
+ * @param target (input) The target
+ * @param name (input) The name of the target in the configuration file
+ */
+- (void)registerTarget:(id<NXLogTarget>)target name:(NSString *)name;
+
+#pragma mark - Methods to apply the configuration
+/// @name Methods to apply the configuration
+
+/**
+ * Read the file and apply its settings. Problems with the file are logged
+ * to the application logger, and the current settings are kept then.
+ *
+ * @result YES, if the settings were applied, NO otherwise
+ */
+- (BOOL)reload;
+
+/**
+ * Apply the settings of the file, and again whenever the file changes.
+ * Uses inotify on Linux and a dispatch source on other systems. Editors replacing the file are supported.
+ */
+- (void)startWatching;
+
+/// Stop watching the file
+- (void)stopWatching;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
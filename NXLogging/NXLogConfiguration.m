@@ -0,0 +1,498 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogConfiguration.h"
+#import "NXLogger.h"
+#import "NXConsoleLogTarget.h"
+#if defined(__APPLE__)
+#import "NXSystemLogTarget.h"
+#elif defined(__linux__)
+#import "NXLinuxSystemLogTarget.h"
+#endif
+#import "NXBasicLogFormatter.h"
+#import "NXJSONLogFormatter.h"
+#import "NXLogPatternLayout.h"
+#import <stdatomic.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <unistd.h>
+#if defined(__linux__)
+#import <sys/inotify.h>
+#endif
+
+// The time to wait for further changes before the file is read, since editors often save in several steps
+static const int64_t NXLogConfigurationSettleTime = 100 * NSEC_PER_MSEC;
+
+@interface NXBasicLogFormatter (NXLogConfiguration)
+
+// The compiled pattern
+- (NXLogPatternLayout *)layout;
+- (void)setLayout:(NXLogPatternLayout *)layout;
+
+@end
+
+// The names of the info in "hiddenInfo", as used for log variables
+static NSDictionary<NSString *, NSNumber *> *NXLogConfigurationInfoNames(void) {
+    static NSDictionary<NSString *, NSNumber *> *names = nil;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        names = @{ @"function" : @(NXLogInfoFunction),
+                   @"file" : @(NXLogInfoFile),
+                   @"line" : @(NXLogInfoLine),
+                   @"module" : @(NXLogInfoModule),
+                   @"processName" : @(NXLogInfoProcessName),
+                   @"processID" : @(NXLogInfoProcessID),
+                   @"date" : @(NXLogInfoDate),
+                   @"deviceName" : @(NXLogInfoDeviceName),
+                   @"deviceModel" : @(NXLogInfoDeviceModel),
+                   @"systemName" : @(NXLogInfoSystemName),
+                   @"systemVersion" : @(NXLogInfoSystemVersion),
+                   @"loggerName" : @(NXLogInfoLoggerName),
+                   @"level" : @(NXLogInfoLevel),
+                   @"message" : @(NXLogInfoMessage),
+                   @"error" : @(NXLogInfoError),
+                   @"exception" : @(NXLogInfoException) };
+    });
+    return names;
+}
+
+@implementation NXLogConfiguration {
+    dispatch_queue_t _queue; // Serialises reading the file, applying it and watching it
+    NSMutableDictionary<NSString *, id<NXLogTarget>> *_targets;
+    NSData *_contents; // The contents of the file last applied
+    NSMutableDictionary<NSString *, NSNumber *> *_formerLoggerLevels; // The levels of the configured loggers before they were configured
+    NSMutableDictionary<NSString *, NSNumber *> *_formerTargetLevels; // Ditto for the targets
+    dispatch_source_t _source;
+    BOOL _sourceStale; // YES, if the watched file was replaced
+    BOOL _reloadScheduled;
+    _Atomic(NSUInteger) _generation;
+}
+
+- (instancetype)initWithPath:(NSString *)path {
+    self = [super init];
+    if (self) {
+        _path = [path copy];
+        _queue = dispatch_queue_create("com.naxos-software.NXLogging.configuration", DISPATCH_QUEUE_SERIAL);
+        _targets = [NSMutableDictionary dictionaryWithDictionary:@{ @"console" : [NXConsoleLogTarget sharedInstance] }];
+#if defined(__APPLE__)
+        _targets[@"system"] = [NXSystemLogTarget sharedInstance];
+#elif defined(__linux__)
+        _targets[@"system"] = [NXLinuxSystemLogTarget sharedInstance];
+#endif
+        _formerLoggerLevels = [NSMutableDictionary new];
+        _formerTargetLevels = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_source) {
+        dispatch_source_cancel(_source);
+    }
+}
+
+#pragma mark - Public API
+
+- (NSUInteger)generation {
+    return atomic_load_explicit(&_generation, memory_order_acquire);
+}
+
+- (BOOL)isWatching {
+    __block BOOL watching;
+    
+    dispatch_sync(_queue, ^{
+        watching = self->_source != nil;
+    });
+    
+    return watching;
+}
+
+- (void)registerTarget:(id<NXLogTarget>)target name:(NSString *)name {
+    dispatch_sync(_queue, ^{
+        self->_targets[name] = target;
+    });
+}
+
+- (BOOL)reload {
+    __block BOOL reloaded;
+    
+    dispatch_sync(_queue, ^{
+        reloaded = [self _reloadIfChanged:NO];
+    });
+    
+    return reloaded;
+}
+
+- (void)startWatching {
+    dispatch_sync(_queue, ^{
+        if (self->_source == nil) {
+            [self _reloadIfChanged:NO];
+            [self _watch];
+        }
+    });
+}
+
+- (void)stopWatching {
+    dispatch_sync(_queue, ^{
+        if (self->_source) {
+            dispatch_source_cancel(self->_source);
+            self->_source = nil;
+        }
+    });
+}
+
+#pragma mark - Private methods for reading and applying the file (on the queue)
+
+- (BOOL)_reloadIfChanged:(BOOL)onlyIfChanged {
+    NSData *contents = [NSData dataWithContentsOfFile:_path];
+    
+    if (contents == nil) {
+        NXLog(NXLogLevelError, @"Unable to read the log configuration at path %@", _path);
+        return NO;
+    }
+    
+    if (onlyIfChanged && [contents isEqualToData:_contents]) {
+        return YES;
+    }
+    
+    // Validate everything before applying anything, so a broken file does not leave a half-applied configuration
+    
+    NSError *error = nil;
+    NSDictionary *json = [NSJSONSerialization JSONObjectWithData:contents options:0 error:&error];
+    NSMutableDictionary<NSString *, NSNumber *> *loggerLevels = [NSMutableDictionary new];
+    NSMutableDictionary<NSString *, NSDictionary *> *targetSettings = [NSMutableDictionary new];
+    NSString *problem = nil;
+    
+    if (![json isKindOfClass:NSDictionary.class]) {
+        problem = error ? error.localizedDescription : @"The top level is not an object";
+    } else {
+        problem = [self _parseLoggers:json[@"loggers"] into:loggerLevels] ?: [self _parseTargets:json[@"targets"] into:targetSettings];
+    }
+    
+    if (problem) {
+        NXLog(NXLogLevelError, @"Invalid log configuration at path %@: %@", _path, problem);
+        return NO;
+    }
+    
+    [self _applyLoggerLevels:loggerLevels];
+    [self _applyTargetSettings:targetSettings];
+    
+    _contents = contents;
+    
+    // Publish that the configuration is complete
+    
+    atomic_fetch_add_explicit(&_generation, 1, memory_order_release);
+    
+    return YES;
+}
+
+- (NSString *)_parseLoggers:(id)loggers into:(NSMutableDictionary<NSString *, NSNumber *> *)levels {
+    if (loggers && ![loggers isKindOfClass:NSDictionary.class]) {
+        return @"\"loggers\" is not an object";
+    }
+    
+    for (NSString *name in loggers) {
+        NSNumber *level = [self.class _levelFromValue:loggers[name]];
+        
+        if (level == nil) {
+            return [NSString stringWithFormat:@"Invalid level for logger \"%@\"", name];
+        }
+        levels[name] = level;
+    }
+    
+    return nil;
+}
+
+- (NSString *)_parseTargets:(id)targets into:(NSMutableDictionary<NSString *, NSDictionary *> *)settings {
+    if (targets && ![targets isKindOfClass:NSDictionary.class]) {
+        return @"\"targets\" is not an object";
+    }
+    
+    for (NSString *name in targets) {
+        NSDictionary *options = targets[name];
+        NSMutableDictionary *resolved = [NSMutableDictionary new];
+        
+        if (_targets[name] == nil) {
+            return [NSString stringWithFormat:@"Unknown target \"%@\"", name];
+        }
+        if (![options isKindOfClass:NSDictionary.class]) {
+            return [NSString stringWithFormat:@"The options of target \"%@\" are not an object", name];
+        }
+        
+        for (NSString *key in options) {
+            id value = options[key];
+            
+            if ([key isEqualToString:@"level"] || [key isEqualToString:@"exceptionSymbolsThreshold"]) {
+                value = [self.class _levelFromValue:value];
+                
+                // Only loggers have ancestors to inherit from
+                
+                value = [value integerValue] == NXLogLevelInherit ? nil : value;
+            } else if ([key isEqualToString:@"expandsVariablesInFormat"] || [key isEqualToString:@"prettyPrint"]) {
+                value = [value isKindOfClass:NSNumber.class] ? value : nil;
+            } else if ([key isEqualToString:@"pattern"]) {
+                
+                // Compile the pattern right away, so a malformed one is a problem like any other and nothing is applied
+                
+                @try {
+                    value = [value isKindOfClass:NSString.class] ? [[NXLogPatternLayout alloc] initWithPattern:value] : nil;
+                } @catch (NSException *exception) {
+                    return [NSString stringWithFormat:@"Invalid pattern for target \"%@\": %@", name, exception.reason];
+                }
+            } else if (![key isEqualToString:@"hiddenInfo"]) {
+                return [NSString stringWithFormat:@"Unknown option %@ for target \"%@\"", key, name];
+            }
+            
+            if (value == nil) {
+                return [NSString stringWithFormat:@"Invalid %@ for target \"%@\"", key, name];
+            }
+            resolved[key] = value;
+        }
+        if (options[@"hiddenInfo"]) {
+            NXLogInfo hiddenInfo = NXLogInfoNone;
+            
+            if (![options[@"hiddenInfo"] isKindOfClass:NSArray.class]) {
+                return [NSString stringWithFormat:@"Invalid hiddenInfo for target \"%@\"", name];
+            }
+            for (id infoName in options[@"hiddenInfo"]) {
+                NSNumber *info = [infoName isKindOfClass:NSString.class] ? NXLogConfigurationInfoNames()[infoName] : nil;
+                
+                if (info == nil) {
+                    return [NSString stringWithFormat:@"Invalid hiddenInfo \"%@\" for target \"%@\"", infoName, name];
+                }
+                hiddenInfo |= info.unsignedIntegerValue;
+            }
+            resolved[@"hiddenInfo"] = @(hiddenInfo);
+        }
+        
+        settings[name] = resolved;
+    }
+    
+    return nil;
+}
+
+- (void)_applyLoggerLevels:(NSDictionary<NSString *, NSNumber *> *)levels {
+    
+    // Loggers no longer configured get their former levels back, ...
+    
+    for (NSString *name in _formerLoggerLevels.allKeys) {
+        if (levels[name] == nil) {
+            [NXLogger loggerNamed:name].maxLogLevel = _formerLoggerLevels[name].integerValue;
+            [_formerLoggerLevels removeObjectForKey:name];
+        }
+    }
+    
+    // ... and the others get their new ones, but only if they change, since that updates the loggers below as well
+    
+    [levels enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSNumber *level, BOOL *stop) {
+        NXLogger *logger = [NXLogger loggerNamed:name];
+        
+        if (self->_formerLoggerLevels[name] == nil) {
+            self->_formerLoggerLevels[name] = @(logger.maxLogLevel);
+        }
+        if (logger.maxLogLevel != level.integerValue) {
+            logger.maxLogLevel = level.integerValue;
+        }
+    }];
+}
+
+- (void)_applyTargetSettings:(NSDictionary<NSString *, NSDictionary *> *)settings {
+    for (NSString *name in _formerTargetLevels.allKeys) {
+        if (settings[name][@"level"] == nil) {
+            _targets[name].maxLogLevel = _formerTargetLevels[name].integerValue;
+            [_formerTargetLevels removeObjectForKey:name];
+        }
+    }
+    
+    [settings enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSDictionary *options, BOOL *stop) {
+        id<NXLogTarget> target = self->_targets[name];
+        NSNumber *level = options[@"level"];
+        
+        if (level) {
+            if (self->_formerTargetLevels[name] == nil) {
+                self->_formerTargetLevels[name] = @(target.maxLogLevel);
+            }
+            if (target.maxLogLevel != level.integerValue) {
+                target.maxLogLevel = level.integerValue;
+            }
+        }
+        [self _applyOptions:options toFormatter:target.logFormatter];
+    }];
+}
+
+// Apply the options the formatter supports. Formatters are often shared, so the options apply to all their targets.
+- (void)_applyOptions:(NSDictionary *)options toFormatter:(id<NXLogFormatter>)formatter {
+    NXBasicLogFormatter *basicFormatter = [formatter isKindOfClass:NXBasicLogFormatter.class] ? (NXBasicLogFormatter *)formatter : nil;
+    NXJSONLogFormatter *jsonFormatter = [formatter isKindOfClass:NXJSONLogFormatter.class] ? (NXJSONLogFormatter *)formatter : nil;
+    
+    NXLogPatternLayout *layout = options[@"pattern"];
+    
+    if (basicFormatter && layout && ![basicFormatter.pattern isEqualToString:layout.pattern]) {
+        basicFormatter.layout = layout;
+    }
+    if (basicFormatter && options[@"hiddenInfo"] && basicFormatter.hiddenInfo != [options[@"hiddenInfo"] unsignedIntegerValue]) {
+        basicFormatter.hiddenInfo = [options[@"hiddenInfo"] unsignedIntegerValue];
+    }
+    if (basicFormatter && options[@"exceptionSymbolsThreshold"]) {
+        basicFormatter.exceptionSymbolsThreshold = [options[@"exceptionSymbolsThreshold"] integerValue];
+    }
+    if (basicFormatter && options[@"expandsVariablesInFormat"]) {
+        basicFormatter.expandsVariablesInFormat = [options[@"expandsVariablesInFormat"] boolValue];
+    }
+    if (jsonFormatter && options[@"prettyPrint"]) {
+        jsonFormatter.prettyPrint = [options[@"prettyPrint"] boolValue];
+    }
+}
+
++ (NSNumber *)_levelFromValue:(id)value {
+    if (![value isKindOfClass:NSString.class]) {
+        return nil;
+    }
+    
+    NSString *name = [value lowercaseString];
+    
+    if ([name isEqualToString:@"none"]) {
+        return @(NXLogLevelNone);
+    }
+    if ([name isEqualToString:@"any"]) {
+        return @(NXLogLevelAny);
+    }
+    if ([name isEqualToString:@"inherit"]) {
+        return @(NXLogLevelInherit);
+    }
+    for (NXLogLevel level = NXLogLevelEmergency; level <= NXLogLevelDebug; level++) {
+        if ([name isEqualToString:[NXBasicLogFormatter levelName:level].lowercaseString]) {
+            return @(level);
+        }
+    }
+    
+    return nil;
+}
+
+#pragma mark - Private methods for watching the file (on the queue)
+
+- (void)_watch {
+    __weak typeof(self) weakSelf = self;
+    
+#if defined(__linux__)
+    
+    // Watch the directory, so replacing the file (as most editors do) is noticed as well
+    
+    NSString *directory = _path.stringByDeletingLastPathComponent.length ? _path.stringByDeletingLastPathComponent : @".";
+    NSString *fileName = _path.lastPathComponent;
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    
+    if (fd < 0 || inotify_add_watch(fd, directory.fileSystemRepresentation, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        NXLog(NXLogLevelError, @"Unable to watch the log configuration at path %@: %s", _path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, _queue);
+    
+    dispatch_source_set_event_handler(source, ^{
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        const char *name = fileName.fileSystemRepresentation;
+        BOOL changed = NO;
+        ssize_t length;
+        
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char *ptr = buffer; ptr < buffer + length; ) {
+                const struct inotify_event *event = (const struct inotify_event *)ptr;
+                
+                changed = changed || (event->len && strcmp(event->name, name) == 0);
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed) {
+            [weakSelf _scheduleReload];
+        }
+    });
+#else
+    
+    // Watch the file itself, and watch the new one once the file was replaced
+    
+    int fd = open(_path.fileSystemRepresentation, O_EVTONLY);
+    
+    if (fd < 0) {
+        NXLog(NXLogLevelError, @"Unable to watch the log configuration at path %@: %s", _path, strerror(errno));
+        return;
+    }
+    
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fd, DISPATCH_VNODE_WRITE | DISPATCH_VNODE_EXTEND | DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME, _queue);
+    
+    dispatch_source_set_event_handler(source, ^{
+        NXLogConfiguration *strongSelf = weakSelf;
+        
+        if (strongSelf) {
+            strongSelf->_sourceStale |= (dispatch_source_get_data(source) & (DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME)) != 0;
+            [strongSelf _scheduleReload];
+        }
+    });
+#endif
+    
+    dispatch_source_set_cancel_handler(source, ^{
+        close(fd);
+    });
+    
+    _source = source;
+    _sourceStale = NO;
+    dispatch_resume(source);
+}
+
+- (void)_scheduleReload {
+    if (_reloadScheduled) {
+        return;
+    }
+    _reloadScheduled = YES;
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, NXLogConfigurationSettleTime), _queue, ^{
+        self->_reloadScheduled = NO;
+        
+        // Stopped watching meanwhile
+        
+        if (self->_source == nil) {
+            return;
+        }
+        
+        if (self->_sourceStale) {
+            dispatch_source_cancel(self->_source);
+            self->_source = nil;
+            [self _watch];
+        }
+        [self _reloadIfChanged:YES];
+    });
+}
+
+@end
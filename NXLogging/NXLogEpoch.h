@@ -0,0 +1,99 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Epoch-based reclamation of objects that are read without taking a lock.
+ * Readers enter the epoch, load a pointer and retain what it points to, then leave again.
+ * A writer publishes a new pointer and then waits until every reader that entered before
+ * has left, so the old object may be released safely: no reader can still be about to
+ * retain it. Readers never block, writers block only for the few instructions of the
+ * read sections in progress.
+ * Slots are plain pointers, holding an object retained by the epoch, or NULL.
+ */
+@interface NXLogEpoch : NSObject
+
+#pragma mark - Read sections
+/// @name Read sections
+
+/**
+ * Enter a read section. Anything loaded from a slot stays valid until the section is left.
+ *
+ * @return The token to pass to leave:
+ */
+- (NSUInteger)enter;
+
+/**
+ * Leave a read section
+ *
+ * @param token The token returned by enter
+ */
+- (void)leave:(NSUInteger)token;
+
+/**
+ * Wait until all read sections entered so far have been left
+ */
+- (void)synchronize;
+
+#pragma mark - Object slots
+/// @name Object slots
+
+/**
+ * Load the object in a slot
+ *
+ * @param slot The slot
+ * @return The object (retained by the caller), or nil if the slot is empty
+ */
+- (id)objectAtSlot:(void * const *)slot;
+
+/**
+ * Replace the object in a slot. Returns after all readers that may have loaded the old object have retained it.
+ *
+ * @param slot The slot
+ * @param object The new object, or nil to empty the slot
+ * @return The old object, safe to release
+ */
+- (id)replaceObjectAtSlot:(void **)slot withObject:(id)object;
+
+/**
+ * Replace the object in a slot, unless another writer has replaced it meanwhile.
+ * Returns after all readers that may have loaded the old object have retained it.
+ *
+ * @param slot The slot
+ * @param expected The object that must still be in the slot (compared by identity), or nil for an empty slot
+ * @param object The new object, or nil to empty the slot
+ * @return YES, if the object was replaced
+ */
+- (BOOL)replaceObjectAtSlot:(void **)slot ifIdenticalTo:(id)expected withObject:(id)object;
+
+@end
@@ -0,0 +1,114 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogEpoch.h"
+#import <stdatomic.h>
+#import <sched.h>
+
+@implementation NXLogEpoch {
+    _Atomic(NSUInteger) _epoch;
+    _Atomic(NSUInteger) _readers[2]; // The readers in the read sections entered at even and odd epochs
+}
+
+#pragma mark - Read sections
+
+- (NSUInteger)enter {
+    NSUInteger token = atomic_load(&_epoch) & 1;
+    
+    atomic_fetch_add(&_readers[token], 1);
+    
+    return token;
+}
+
+- (void)leave:(NSUInteger)token {
+    atomic_fetch_sub_explicit(&_readers[token], 1, memory_order_release);
+}
+
+- (void)synchronize {
+    @synchronized(self) {
+        // Readers entering from now on count in the other half. Wait for the current half to
+        // drain, then flip again for readers that loaded the epoch before the first flip.
+        
+        for (NSUInteger i = 0; i < 2; i++) {
+            NSUInteger token = atomic_fetch_add(&_epoch, 1) & 1;
+            
+            while (atomic_load(&_readers[token])) {
+                sched_yield();
+            }
+        }
+    }
+}
+
+#pragma mark - Object slots
+
+- (id)objectAtSlot:(void * const *)slot {
+    NSUInteger token = [self enter];
+    void *object = __atomic_load_n(slot, __ATOMIC_SEQ_CST);
+    
+    if (object) {
+        CFRetain(object);
+    }
+    
+    [self leave:token];
+    
+    return object ? CFBridgingRelease(object) : nil;
+}
+
+- (id)replaceObjectAtSlot:(void **)slot withObject:(id)object {
+    void *oldObject = __atomic_exchange_n(slot, (void *)CFBridgingRetain(object), __ATOMIC_SEQ_CST);
+    
+    [self synchronize];
+    
+    return oldObject ? CFBridgingRelease(oldObject) : nil;
+}
+
+- (BOOL)replaceObjectAtSlot:(void **)slot ifIdenticalTo:(id)expected withObject:(id)object {
+    void *oldObject = (__bridge void *)expected;
+    void *newObject = (void *)CFBridgingRetain(object);
+    
+    if (!__atomic_compare_exchange_n(slot, &oldObject, newObject, NO, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        if (newObject) {
+            CFRelease(newObject);
+        }
+        return NO;
+    }
+    
+    [self synchronize];
+    
+    if (oldObject) {
+        CFRelease(oldObject);
+    }
+    
+    return YES;
+}
+
+@end
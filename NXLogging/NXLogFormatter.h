@@ -33,6 +33,7 @@
 #import <Foundation/Foundation.h>
 #import "NXLogClientInfo.h"
 #import "NXLogTypes.h"
+#import "NXLogRecord.h"
 
 /**
  * Protocol describing a formatter for log messages.
@@ -56,4 +57,32 @@
  */
 - (id)messageForLogger:(NSString *)loggerName level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments;
 
+@optional
+
+/// @name Format the log record
+
+/**
+ * Creates a log record with the formatted message. Loggers prefer this method, if it is implemented,
+ * and hand the record to all targets of the formatter.
+ *
+ * @param loggerName The name of the logger for the message (must not be nil)
+ * @param level The log level
+ * @param client Some info about the log client.
+ * @param error An error or nil
+ * @param format The message format as in -[NSString initWithFormat:arguments:]. May be nil.
+ * @param arguments Arguments to substitute into format or nil. Not taken into account if format is nil.
+ * @return The log record
+ * @discussion This method should be implemented in a thread-safe way
+ */
+- (NXLogRecord *)recordForLogger:(NSString *)loggerName level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments;
+
+/// @name Info required by the formatter
+
+/**
+ * The bit mask representing the client info the formatter needs to format a message.
+ * Loggers only capture the info required by the formatters of their targets. A formatter
+ * not implementing this property will be passed all info. Changes must be KVO compliant.
+ */
+@property (atomic, readonly) NXLogInfo requiredInfo;
+
 @end
@@ -0,0 +1,74 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A snapshot of the static info about the logging process and its host.
+ * None of this info changes while the process runs (except the process ID
+ * after a fork), so it is captured only once and shared by all log messages.
+ */
+@interface NXLogHostInfo : NSObject
+
+#pragma mark - Properties
+/// @name Properties
+
+/// The process name
+@property (nonatomic, readonly) NSString *processName;
+/// The process ID
+@property (nonatomic, readonly) NSNumber *processID;
+/// The device name (the host name on Linux)
+@property (nonatomic, readonly) NSString *deviceName;
+/// The device model (the machine hardware name)
+@property (nonatomic, readonly) NSString *deviceModel;
+/// The operating system
+@property (nonatomic, readonly) NSString *systemName;
+/// The operating system version
+@property (nonatomic, readonly) NSString *systemVersion;
+
+#pragma mark - Static initializer
+/// @name Static initializer
+
+/**
+ * Get the snapshot for the current process.
+ * The snapshot is captured on first use and captured again after the process forked.
+ *
+ * @result The snapshot
+ */
++ (instancetype)currentHostInfo;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
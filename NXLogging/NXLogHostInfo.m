@@ -0,0 +1,125 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogHostInfo.h"
+#import <sys/utsname.h>
+#import <stdatomic.h>
+#import <pthread.h>
+#import <unistd.h>
+#ifdef __APPLE__
+#import <TargetConditionals.h>
+#endif
+#if TARGET_OS_IPHONE
+#import <UIKit/UIKit.h>
+#endif
+
+static NXLogHostInfo *_currentHostInfo = nil;
+static atomic_bool _needsCapture = true;
+
+static void _NXLogHostInfoAfterFork(void) {
+    // Only async-signal-safe work is allowed in the child, so just flag the snapshot as stale
+    atomic_store_explicit(&_needsCapture, true, memory_order_release);
+}
+
+@interface NXLogHostInfo ()
+
+- (instancetype)_initWithCurrentProcess NS_DESIGNATED_INITIALIZER;
+
+@end
+
+@implementation NXLogHostInfo
+
++ (instancetype)currentHostInfo {
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        // The process ID changes in the child, so capture again on the next access
+        pthread_atfork(NULL, NULL, _NXLogHostInfoAfterFork);
+    });
+    
+    if (atomic_load_explicit(&_needsCapture, memory_order_acquire)) {
+        @synchronized(self) {
+            if (atomic_load_explicit(&_needsCapture, memory_order_relaxed)) {
+                _currentHostInfo = [[self alloc] _initWithCurrentProcess];
+                atomic_store_explicit(&_needsCapture, false, memory_order_release);
+            }
+        }
+    }
+    
+    return _currentHostInfo;
+}
+
+- (instancetype)_initWithCurrentProcess {
+    self = [super init];
+    if (self) {
+        struct utsname systemInfo;
+        uname(&systemInfo);
+        
+        _processID = @(getpid());
+        _deviceModel = [NSString stringWithCString:systemInfo.machine encoding:NSUTF8StringEncoding];
+        
+#if TARGET_OS_IPHONE
+        UIDevice *device = [UIDevice currentDevice];
+        
+        _processName = NSProcessInfo.processInfo.processName;
+        _deviceName = device.name;
+        _systemName = device.systemName;
+        _systemVersion = device.systemVersion;
+#else
+        char hostName[256];
+        
+        _processName = [self.class _processName];
+        _deviceName = gethostname(hostName, sizeof(hostName)) == 0 ? [NSString stringWithCString:hostName encoding:NSUTF8StringEncoding] : nil;
+        _systemName = [NSString stringWithCString:systemInfo.sysname encoding:NSUTF8StringEncoding];
+        _systemVersion = [NSString stringWithCString:systemInfo.release encoding:NSUTF8StringEncoding];
+#endif
+    }
+    return self;
+}
+
+#pragma mark - Private methods
+
+#if !TARGET_OS_IPHONE
++ (NSString *)_processName {
+#ifdef __linux__
+    NSString *name = [NSString stringWithContentsOfFile:@"/proc/self/comm" encoding:NSUTF8StringEncoding error:nil];
+    
+    name = [name stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]];
+    
+    if (name.length) {
+        return name;
+    }
+#endif
+    return NSProcessInfo.processInfo.processName;
+}
+#endif
+
+@end
@@ -0,0 +1,102 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTarget.h"
+
+/// What to do with a message if the buffer of the logging thread is full
+typedef NS_ENUM(NSInteger, NXLogOverflowPolicy) {
+    /// Wait until the pipeline has made room for the message
+    NXLogOverflowPolicyBlock = 0,
+    /// Drop the message that is about to be logged
+    NXLogOverflowPolicyDropNewest,
+    /// Drop the oldest message of the buffer to make room for the message
+    NXLogOverflowPolicyDropOldest,
+    /// Drop the message if its level is below overflowLevel, otherwise wait
+    NXLogOverflowPolicyDropBelowLevel,
+};
+
+/**
+ * A singleton delivering log messages to their targets.
+ * Each logging thread writes its messages into a ring buffer of its own,
+ * without taking any lock. Messages are numbered as they are written into
+ * a buffer, after any wait for room. A single delivery thread merges the
+ * buffers by these numbers and passes the messages to their targets one at
+ * a time, so each target sees the messages of all threads combined in the
+ * order they were written.
+ */
+@interface NXLogPipeline : NSObject
+
+#pragma mark - Static singleton initializer
+
+/**
+ * Get the instance of this singleton.
+ *
+ * @result The instance
+ */
++ (instancetype)sharedInstance;
+
+#pragma mark - Properties
+/// @name Properties
+
+/// The number of messages the buffer of each logging thread can hold. Applies to threads logging for the first time after setting it. Defaults to 1024.
+@property (atomic) NSUInteger capacity;
+/// What to do with a message if the buffer of the logging thread is full. Defaults to NXLogOverflowPolicyBlock, so no message is lost.
+@property (atomic) NXLogOverflowPolicy overflowPolicy;
+/// Messages with a level below this level are dropped on overflow if the policy is NXLogOverflowPolicyDropBelowLevel. Defaults to NXLogLevelWarning.
+@property (atomic) NXLogLevel overflowLevel;
+/// The exact number of messages dropped so far
+@property (atomic, readonly) uint64_t droppedCount;
+
+#pragma mark - Methods
+/// @name Methods
+
+/**
+ * Enqueue a message for delivery to a target.
+ *
+ * @param message (input) The message
+ * @param level (input) The log level
+ * @param target (input) The target
+ */
+- (void)enqueueMessage:(id)message level:(NXLogLevel)level target:(id<NXLogTarget>)target;
+
+/**
+ * Wait until all messages enqueued before calling this method have been delivered or dropped.
+ */
+- (void)drain;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
@@ -0,0 +1,459 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogPipeline.h"
+#import <stdatomic.h>
+#import <pthread.h>
+#import <sched.h>
+
+// Time drain waits for the delivery thread before checking again
+static const useconds_t NXLogPipelineDrainInterval = 100;
+
+// The publishing state of a ring while its logging thread takes a sequence number but has not taken one yet
+static const uint64_t NXLogRingReserving = UINT64_MAX;
+
+/// A message waiting for delivery
+typedef struct _NXLogSlot {
+    uint64_t sequence;
+    NXLogLevel level;
+    void *target;  // Retained
+    void *message; // Retained
+} NXLogSlot;
+
+/// The ring buffer of a logging thread. Only the logging thread advances the tail. The head is
+/// advanced by the delivery thread, and by the logging thread when it drops the oldest message.
+typedef struct _NXLogRing {
+    _Alignas(64) _Atomic(uint64_t) head;
+    _Alignas(64) _Atomic(uint64_t) tail;
+    _Atomic(uint64_t) publishing; // 0, NXLogRingReserving, or 1 + the sequence of the message being published
+    _Atomic(uint64_t) dropped;
+    atomic_bool closed; // Set when the logging thread has exited
+    NSUInteger mask;
+    NXLogSlot *slots;
+    struct _NXLogRing *next;
+} NXLogRing;
+
+static __thread NXLogRing *NXLogPipelineThreadRing = NULL;
+static __thread BOOL NXLogPipelineIsDeliveryThread = NO;
+static pthread_key_t NXLogPipelineRingKey;
+
+static void _NXLogPipelineThreadExit(void *ring) {
+    NXLogPipelineThreadRing = NULL;
+    atomic_store(&((NXLogRing *)ring)->closed, true);
+}
+
+// Deliver the messages still buffered, when the process exits
+static void _NXLogPipelineDrainAtExit(void) {
+    [[NXLogPipeline sharedInstance] drain];
+}
+
+@implementation NXLogPipeline {
+    pthread_mutex_t _ringsLock;
+    NXLogRing *_rings; // Only accessed while locked
+    _Atomic(uint64_t) _ringsGeneration;
+    _Atomic(uint64_t) _nextSequence;
+    _Atomic(uint64_t) _settledCount;  // Messages delivered or dropped
+    _Atomic(uint64_t) _retiredDropped; // Dropped messages of rings already freed
+    atomic_bool _consumerWaiting;
+    dispatch_semaphore_t _wakeup;
+    pthread_mutex_t _roomLock;
+    pthread_cond_t _roomCondition; // Signalled when the delivery thread has made room while logging threads wait for it
+    _Atomic(NSUInteger) _roomWaiters;
+}
+
+#pragma mark - Static singleton initializer
+
++ (instancetype)sharedInstance {
+    NSAssert(self == NXLogPipeline.class, @"A subclass of this singleton needs its own sharedInstance!");
+    static id sharedInstance = nil;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        sharedInstance = [[self alloc] init];
+        atexit(_NXLogPipelineDrainAtExit);
+    });
+    return sharedInstance;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _capacity = 1024;
+        _overflowPolicy = NXLogOverflowPolicyBlock;
+        _overflowLevel = NXLogLevelWarning;
+        _wakeup = dispatch_semaphore_create(0);
+        pthread_mutex_init(&_ringsLock, NULL);
+        pthread_mutex_init(&_roomLock, NULL);
+        pthread_cond_init(&_roomCondition, NULL);
+        pthread_key_create(&NXLogPipelineRingKey, _NXLogPipelineThreadExit);
+        
+        NSThread *thread = [[NSThread alloc] initWithTarget:self selector:@selector(_deliver) object:nil];
+        thread.name = @"com.naxos-software.NXLogging.pipeline";
+        thread.qualityOfService = NSQualityOfServiceUtility;
+        [thread start];
+    }
+    return self;
+}
+
+#pragma mark - Properties
+
+- (uint64_t)droppedCount {
+    uint64_t dropped = atomic_load(&_retiredDropped);
+    
+    pthread_mutex_lock(&_ringsLock);
+    for (NXLogRing *ring = _rings; ring; ring = ring->next) {
+        dropped += atomic_load(&ring->dropped);
+    }
+    pthread_mutex_unlock(&_ringsLock);
+    
+    return dropped;
+}
+
+#pragma mark - Methods
+
+- (void)enqueueMessage:(id)message level:(NXLogLevel)level target:(id<NXLogTarget>)target {
+    NXLogRing *ring = NXLogPipelineThreadRing ?: [self _registerThreadRing];
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    
+    // Make room for the message, if the buffer is full
+    
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        
+        if (tail - head <= ring->mask) {
+            break;
+        }
+        
+        NXLogOverflowPolicy policy = self.overflowPolicy;
+        
+        // The delivery thread cannot wait for itself
+        
+        if (NXLogPipelineIsDeliveryThread && policy != NXLogOverflowPolicyDropOldest) {
+            policy = NXLogOverflowPolicyDropNewest;
+        }
+        
+        switch (policy) {
+            case NXLogOverflowPolicyDropBelowLevel:
+                if (level <= self.overflowLevel) {
+                    [self _waitForRoomInRing:ring tail:tail];
+                    break;
+                }
+                // Fall through
+            case NXLogOverflowPolicyDropNewest:
+                [self _dropFromRing:ring];
+                return;
+            case NXLogOverflowPolicyDropOldest: {
+                NXLogSlot *slot = &ring->slots[head & ring->mask];
+                void *oldTarget = __atomic_load_n(&slot->target, __ATOMIC_RELAXED);
+                void *oldMessage = __atomic_load_n(&slot->message, __ATOMIC_RELAXED);
+                
+                // If the delivery thread was faster, there is room now
+                
+                if (atomic_compare_exchange_strong(&ring->head, &head, head + 1)) {
+                    CFBridgingRelease(oldTarget);
+                    CFBridgingRelease(oldMessage);
+                    [self _dropFromRing:ring];
+                    atomic_fetch_add(&_settledCount, 1);
+                }
+                break;
+            }
+            case NXLogOverflowPolicyBlock:
+                [self _waitForRoomInRing:ring tail:tail];
+                break;
+        }
+    }
+    
+    // Take the sequence number only now, so a thread that had to wait cannot hold back a number
+    // lower than those of messages logged meanwhile. The delivery thread sees the ring reserving
+    // a number before it is taken, and holds back later messages until it is published.
+    
+    atomic_store(&ring->publishing, NXLogRingReserving);
+    
+    uint64_t sequence = atomic_fetch_add(&_nextSequence, 1);
+    
+    atomic_store(&ring->publishing, sequence + 1);
+    
+    // Write the message and publish it
+    
+    NXLogSlot *slot = &ring->slots[tail & ring->mask];
+    
+    __atomic_store_n(&slot->sequence, sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->level, level, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->target, (__bridge_retained void *)target, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->message, (__bridge_retained void *)message, __ATOMIC_RELAXED);
+    
+    atomic_store(&ring->tail, tail + 1);
+    atomic_store(&ring->publishing, 0);
+    
+    [self _wakeUpDeliveryThread];
+}
+
+- (void)drain {
+    uint64_t count = atomic_load(&_nextSequence);
+    
+    while (atomic_load(&_settledCount) < count) {
+        [self _wakeUpDeliveryThread];
+        usleep(NXLogPipelineDrainInterval);
+    }
+}
+
+#pragma mark - Private methods for logging threads
+
+- (NXLogRing *)_registerThreadRing {
+    NSUInteger capacity = 2;
+    
+    while (capacity < self.capacity) {
+        capacity <<= 1;
+    }
+    
+    NXLogRing *ring = calloc(1, sizeof(NXLogRing));
+    ring->mask = capacity - 1;
+    ring->slots = calloc(capacity, sizeof(NXLogSlot));
+    
+    pthread_mutex_lock(&_ringsLock);
+    ring->next = _rings;
+    _rings = ring;
+    atomic_fetch_add(&_ringsGeneration, 1);
+    pthread_mutex_unlock(&_ringsLock);
+    
+    pthread_setspecific(NXLogPipelineRingKey, ring);
+    NXLogPipelineThreadRing = ring;
+    
+    return ring;
+}
+
+- (void)_dropFromRing:(NXLogRing *)ring {
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+}
+
+- (void)_waitForRoomInRing:(NXLogRing *)ring tail:(uint64_t)tail {
+    pthread_mutex_lock(&_roomLock);
+    
+    // Announce the wait before checking, so the delivery thread either sees the waiter or made room before the check
+    
+    atomic_fetch_add(&_roomWaiters, 1);
+    
+    while (tail - atomic_load(&ring->head) > ring->mask) {
+        [self _wakeUpDeliveryThread];
+        pthread_cond_wait(&_roomCondition, &_roomLock);
+    }
+    
+    atomic_fetch_sub(&_roomWaiters, 1);
+    
+    pthread_mutex_unlock(&_roomLock);
+}
+
+- (void)_wakeUpDeliveryThread {
+    if (atomic_load(&_consumerWaiting) && atomic_exchange(&_consumerWaiting, false)) {
+        dispatch_semaphore_signal(_wakeup);
+    }
+}
+
+#pragma mark - Private methods for the delivery thread
+
+- (void)_deliver {
+    NXLogPipelineIsDeliveryThread = YES;
+    
+    NXLogRing **rings = NULL;
+    NSUInteger ringCount = 0;
+    uint64_t generation = UINT64_MAX;
+    
+    for (;;) {
+        @autoreleasepool {
+            
+            // Pick up rings of new threads
+            
+            if (generation != atomic_load(&_ringsGeneration)) {
+                pthread_mutex_lock(&_ringsLock);
+                generation = atomic_load(&_ringsGeneration);
+                ringCount = 0;
+                for (NXLogRing *ring = _rings; ring; ring = ring->next) {
+                    ringCount++;
+                }
+                rings = reallocf(rings, MAX(ringCount, 1) * sizeof(NXLogRing *));
+                ringCount = 0;
+                for (NXLogRing *ring = _rings; ring; ring = ring->next) {
+                    rings[ringCount++] = ring;
+                }
+                pthread_mutex_unlock(&_ringsLock);
+            }
+            
+            // Find the ring holding the oldest message and the sequence of the oldest message of all other rings.
+            // Messages numbered from now on cannot be older than those found, and messages still being published
+            // bound the messages that may be delivered: nothing may overtake them.
+            
+            NXLogRing *first = NULL;
+            uint64_t firstSequence = UINT64_MAX;
+            uint64_t secondSequence = UINT64_MAX;
+            uint64_t limit = atomic_load(&_nextSequence);
+            
+            for (NSUInteger i = 0; i < ringCount; i++) {
+                NXLogRing *ring = rings[i];
+                uint64_t publishing = atomic_load(&ring->publishing);
+                uint64_t head = atomic_load(&ring->head);
+                
+                if (publishing == NXLogRingReserving) {
+                    limit = 0; // The number is not known yet, so wait for it
+                } else if (publishing) {
+                    limit = MIN(limit, publishing - 1);
+                }
+                
+                if (head == atomic_load(&ring->tail)) {
+                    continue;
+                }
+                
+                uint64_t sequence = __atomic_load_n(&ring->slots[head & ring->mask].sequence, __ATOMIC_RELAXED);
+                
+                if (sequence < firstSequence) {
+                    secondSequence = firstSequence;
+                    firstSequence = sequence;
+                    first = ring;
+                } else if (sequence < secondSequence) {
+                    secondSequence = sequence;
+                }
+            }
+            
+            // If there is nothing to deliver, free the rings of exited threads and wait for messages
+            
+            if (first == NULL) {
+                if ([self _retireRings]) {
+                    continue;
+                }
+                
+                atomic_store(&_consumerWaiting, true);
+                
+                if ([self _hasMessagesInRings:rings count:ringCount] || generation != atomic_load(&_ringsGeneration)) {
+                    atomic_store(&_consumerWaiting, false);
+                } else {
+                    dispatch_semaphore_wait(_wakeup, DISPATCH_TIME_FOREVER);
+                }
+                continue;
+            }
+            
+            // Deliver the messages of the ring as long as they precede the messages of all other rings
+            
+            if (firstSequence >= limit) {
+                sched_yield(); // A thread is about to publish an older message
+                continue;
+            }
+            
+            while ([self _deliverFromRing:first before:MIN(secondSequence, limit)]);
+        }
+    }
+}
+
+- (BOOL)_deliverFromRing:(NXLogRing *)ring before:(uint64_t)limit {
+    for (;;) {
+        uint64_t head = atomic_load(&ring->head);
+        
+        if (head == atomic_load(&ring->tail)) {
+            return NO;
+        }
+        
+        NXLogSlot *slot = &ring->slots[head & ring->mask];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+        NXLogLevel level = __atomic_load_n(&slot->level, __ATOMIC_RELAXED);
+        void *target = __atomic_load_n(&slot->target, __ATOMIC_RELAXED);
+        void *message = __atomic_load_n(&slot->message, __ATOMIC_RELAXED);
+        
+        if (sequence >= limit) {
+            return NO;
+        }
+        
+        // Claim the slot. Fails, if the logging thread has dropped the message in the meantime.
+        
+        if (atomic_compare_exchange_strong(&ring->head, &head, head + 1)) {
+            id<NXLogTarget> logTarget = CFBridgingRelease(target);
+            
+            id logMessage = CFBridgingRelease(message);
+            
+            // Records go to the targets that take them, all other targets get the message object
+            
+            if ([logMessage isKindOfClass:NXLogRecord.class]) {
+                if ([logTarget respondsToSelector:@selector(logRecord:)]) {
+                    [logTarget logRecord:logMessage];
+                } else {
+                    [logTarget log:level message:[(NXLogRecord *)logMessage message]];
+                }
+            } else {
+                [logTarget log:level message:logMessage];
+            }
+            
+            atomic_fetch_add(&_settledCount, 1);
+            
+            if (atomic_load(&_roomWaiters)) {
+                pthread_mutex_lock(&_roomLock);
+                pthread_cond_broadcast(&_roomCondition);
+                pthread_mutex_unlock(&_roomLock);
+            }
+            return YES;
+        }
+    }
+}
+
+- (BOOL)_hasMessagesInRings:(NXLogRing **)rings count:(NSUInteger)count {
+    for (NSUInteger i = 0; i < count; i++) {
+        if (atomic_load(&rings[i]->head) != atomic_load(&rings[i]->tail)) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (BOOL)_retireRings {
+    BOOL retired = NO;
+    
+    pthread_mutex_lock(&_ringsLock);
+    
+    for (NXLogRing **link = &_rings; *link;) {
+        NXLogRing *ring = *link;
+        
+        if (atomic_load(&ring->closed) && atomic_load(&ring->head) == atomic_load(&ring->tail)) {
+            *link = ring->next;
+            atomic_fetch_add(&_retiredDropped, atomic_load(&ring->dropped));
+            free(ring->slots);
+            free(ring);
+            retired = YES;
+        } else {
+            link = &ring->next;
+        }
+    }
+    
+    if (retired) {
+        atomic_fetch_add(&_ringsGeneration, 1);
+    }
+    
+    pthread_mutex_unlock(&_ringsLock);
+    
+    return retired;
+}
+
+@end
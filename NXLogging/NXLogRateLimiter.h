@@ -0,0 +1,80 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTypes.h"
+
+/**
+ * Token buckets limiting the rate at which call sites may log, one bucket per call site.
+ * Each bucket is a single timestamp updated by compare-and-swap (the generic cell rate
+ * algorithm), so admitting a message takes no lock. Call sites are identified by their
+ * file and line, which also holds for the short-lived call sites of Swift.
+ * The buckets live in a fixed-size table. Call sites not fitting in it are not limited.
+ */
+@interface NXLogRateLimiter : NSObject
+
+#pragma mark - Designated initializer
+
+/**
+ * Create a rate limiter
+ *
+ * @param capacity The maximum number of call sites tracked, rounded up to a power of two
+ * @return The rate limiter
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Rate limiting
+
+/**
+ * Determine if a call site may log another message, and take a token from its bucket if so
+ *
+ * @param site The call site
+ * @param interval The number of nanoseconds after which the bucket gains a token
+ * @param burst The number of tokens the bucket holds (at least 1)
+ * @param dropped (output) The number of messages rejected since the call site was last admitted, if admitted
+ * @return YES, if the message may be logged, NO if it should be dropped
+ */
+- (BOOL)admitCallSite:(NXLogCallSite *)site interval:(uint64_t)interval burst:(NSUInteger)burst dropped:(NSUInteger *)dropped;
+
+/**
+ * Take the counts of the messages rejected since their call sites were last admitted
+ *
+ * @param block Called for each call site with rejected messages, with the file and the line of the call site and the count
+ */
+- (void)collectDroppedCounts:(void (^)(const char *file, NSInteger line, NSUInteger dropped))block;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
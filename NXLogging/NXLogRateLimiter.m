@@ -0,0 +1,183 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogRateLimiter.h"
+#import <stdatomic.h>
+#if defined(__APPLE__)
+#import <mach/mach_time.h>
+#else
+#import <time.h>
+#endif
+
+/// The bucket of a call site
+typedef struct _NXLogRateBucket {
+    _Atomic(uint64_t) key; // The identity of the call site, 0 if the bucket is unused
+    _Atomic(const char *) file; // The file of the call site, NULL until set after claiming the bucket
+    _Atomic(NSInteger) line;
+    _Atomic(uint64_t) arrival; // The time at which the bucket is full again
+    _Atomic(uint64_t) dropped; // The messages rejected since the last one admitted
+} NXLogRateBucket;
+
+// Monotonic time in nanoseconds
+static uint64_t NXLogRateLimiterNow(void) {
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        mach_timebase_info(&timebase);
+    });
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint64_t)now.tv_sec * NSEC_PER_SEC + (uint64_t)now.tv_nsec;
+#endif
+}
+
+// The identity of a call site, never 0
+static uint64_t NXLogRateLimiterKey(NXLogCallSite *site) {
+    uint64_t key = (uint64_t)(uintptr_t)site->file ^ ((uint64_t)site->line * 0x9E3779B97F4A7C15ULL);
+    
+    // Spread the bits, so the keys of neighbouring lines do not cluster in the table
+    
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    
+    return key ? key : 1;
+}
+
+@implementation NXLogRateLimiter {
+    NXLogRateBucket *_buckets;
+    NSUInteger _mask;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        NSUInteger count = 1;
+        
+        while (count < capacity) {
+            count <<= 1;
+        }
+        _buckets = calloc(count, sizeof(NXLogRateBucket));
+        _mask = count - 1;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_buckets);
+}
+
+#pragma mark - Rate limiting
+
+- (BOOL)admitCallSite:(NXLogCallSite *)site interval:(uint64_t)interval burst:(NSUInteger)burst dropped:(NSUInteger *)dropped {
+    NXLogRateBucket *bucket = [self _bucketForSite:site];
+    
+    *dropped = 0;
+    
+    if (bucket == NULL) {
+        return YES;
+    }
+    
+    // A message is admitted, unless the bucket would be full later than burst intervals from now
+    
+    uint64_t now = NXLogRateLimiterNow();
+    uint64_t tolerance = burst > UINT64_MAX / MAX(interval, 1) ? UINT64_MAX : interval * MAX(burst, 1);
+    uint64_t arrival = atomic_load_explicit(&bucket->arrival, memory_order_relaxed);
+    uint64_t next;
+    
+    do {
+        next = MAX(arrival, now) + interval;
+        
+        if (next - now > tolerance) {
+            atomic_fetch_add_explicit(&bucket->dropped, 1, memory_order_relaxed);
+            return NO;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&bucket->arrival, &arrival, next, memory_order_relaxed, memory_order_relaxed));
+    
+    // Hand over the count of the messages dropped meanwhile, avoiding the write if there are none
+    
+    if (atomic_load_explicit(&bucket->dropped, memory_order_relaxed)) {
+        *dropped = (NSUInteger)atomic_exchange_explicit(&bucket->dropped, 0, memory_order_relaxed);
+    }
+    
+    return YES;
+}
+
+- (void)collectDroppedCounts:(void (^)(const char *file, NSInteger line, NSUInteger dropped))block {
+    for (NSUInteger i = 0; i <= _mask; i++) {
+        NXLogRateBucket *bucket = &_buckets[i];
+        const char *file = atomic_load_explicit(&bucket->file, memory_order_acquire);
+        
+        // Buckets just claimed are left for the next time
+        
+        if (file == NULL || atomic_load_explicit(&bucket->dropped, memory_order_relaxed) == 0) {
+            continue;
+        }
+        
+        NSUInteger dropped = (NSUInteger)atomic_exchange_explicit(&bucket->dropped, 0, memory_order_relaxed);
+        
+        if (dropped) {
+            block(file, atomic_load_explicit(&bucket->line, memory_order_relaxed), dropped);
+        }
+    }
+}
+
+#pragma mark - Private methods
+
+// Find or claim the bucket of a call site by linear probing, or NULL if the table is full
+- (NXLogRateBucket *)_bucketForSite:(NXLogCallSite *)site {
+    uint64_t key = NXLogRateLimiterKey(site);
+    
+    for (NSUInteger i = 0; i <= _mask; i++) {
+        NXLogRateBucket *bucket = &_buckets[(key + i) & _mask];
+        uint64_t current = atomic_load_explicit(&bucket->key, memory_order_relaxed);
+        
+        if (current == 0) {
+            if (atomic_compare_exchange_strong_explicit(&bucket->key, &current, key, memory_order_relaxed, memory_order_relaxed)) {
+                atomic_store_explicit(&bucket->line, site->line, memory_order_relaxed);
+                atomic_store_explicit(&bucket->file, site->file, memory_order_release);
+                return bucket;
+            }
+        }
+        if (current == key) {
+            return bucket;
+        }
+    }
+    return NULL;
+}
+
+@end
@@ -0,0 +1,103 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTypes.h"
+#import "NXLogClientInfo.h"
+
+/**
+ * A formatted log message as an immutable buffer of UTF-8 bytes, together with its log level,
+ * the info about the log client and the logger name. A record is produced once per formatter and handed to all targets of the
+ * formatter, so targets implementing -[NXLogTarget logRecord:] can write the bytes without any
+ * conversion or copy. For targets only implementing -[NXLogTarget log:message:], the record keeps
+ * the message object as well. Either representation is derived from the other on first use only.
+ */
+@interface NXLogRecord : NSObject
+
+#pragma mark - Properties
+/// @name Properties
+
+/// The log level
+@property (nonatomic, readonly) NXLogLevel level;
+/// The info about the log client or nil. Only contains the info captured for the formatters.
+@property (nonatomic, readonly) NXLogClientInfo *client;
+/// The date of the log statement or nil, if the date was not captured
+@property (nonatomic, readonly) NSDate *date;
+/// The name of the logger
+@property (nonatomic, readonly) NSString *loggerName;
+/// The message as the formatter produced it. Records created from bytes decode them to a string.
+@property (nonatomic, readonly) id message;
+/// The UTF-8 bytes of the message, not terminated by a line feed or a null character. Valid as long as the record lives.
+@property (nonatomic, readonly) const char *bytes;
+/// The number of bytes
+@property (nonatomic, readonly) NSUInteger length;
+
+#pragma mark - Initializers
+/// @name Initializers
+
+/**
+ * Create a record from a message object
+ *
+ * @param message (input) The message. The bytes are the UTF-8 representation of the message, if it is a string, or its description.
+ * @param level (input) The log level
+ * @param client (input) The info about the log client or nil
+ * @param loggerName (input) The name of the logger
+ */
+- (instancetype)initWithMessage:(id)message level:(NXLogLevel)level client:(NXLogClientInfo *)client loggerName:(NSString *)loggerName;
+
+/**
+ * Create a record from UTF-8 bytes without copying them
+ *
+ * @param bytes (input) The bytes, allocated with malloc. The record takes ownership and frees them.
+ * @param length (input) The number of bytes
+ * @param level (input) The log level
+ * @param client (input) The info about the log client or nil
+ * @param loggerName (input) The name of the logger
+ */
+- (instancetype)initWithBytesNoCopy:(char *)bytes length:(NSUInteger)length level:(NXLogLevel)level client:(NXLogClientInfo *)client loggerName:(NSString *)loggerName NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
+
+/**
+ * Whether a target overrides -[NXLogTarget log:message:] of its base class. A base class writing
+ * the bytes of records must pass their messages to log:message: instead, if it is overridden.
+ *
+ * @param target (input) The target
+ * @param baseClass (input) The class implementing both log:message: and logRecord:
+ * @return YES, if the class of the target implements log:message: differently than the base class
+ */
+FOUNDATION_EXPORT BOOL NXLogTargetOverridesLogMessage(id target, Class baseClass);
@@ -0,0 +1,150 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogRecord.h"
+
+@implementation NXLogRecord {
+    void *_message;     // The retained message, set at most once
+    char *_bytes;       // The malloced bytes, set at most once
+    NSUInteger _length;
+}
+
+#pragma mark - Initializers
+
+- (instancetype)initWithMessage:(id)message level:(NXLogLevel)level client:(NXLogClientInfo *)client loggerName:(NSString *)loggerName {
+    self = [self initWithBytesNoCopy:NULL length:0 level:level client:client loggerName:loggerName];
+    if (self) {
+        _message = message ? (void *)CFBridgingRetain(message) : (void *)CFBridgingRetain(@"");
+    }
+    return self;
+}
+
+- (instancetype)initWithBytesNoCopy:(char *)bytes length:(NSUInteger)length level:(NXLogLevel)level client:(NXLogClientInfo *)client loggerName:(NSString *)loggerName {
+    self = [super init];
+    if (self) {
+        _bytes = bytes;
+        _length = length;
+        _level = level;
+        _client = client;
+        _loggerName = [loggerName copy];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_message) {
+        CFRelease(_message);
+    }
+    free(_bytes);
+}
+
+#pragma mark - Properties
+
+- (NSDate *)date {
+    return _client.date;
+}
+
+- (id)message {
+    void *message = __atomic_load_n(&_message, __ATOMIC_ACQUIRE);
+    
+    if (message) {
+        return (__bridge id)message;
+    }
+    
+    // Decode the bytes and publish the string. If another thread was faster, use its string instead.
+    
+    NSString *string = [[NSString alloc] initWithBytes:_bytes length:_length encoding:NSUTF8StringEncoding] ?: @"";
+    void *expected = NULL;
+    void *retained = (void *)CFBridgingRetain(string);
+    
+    if (!__atomic_compare_exchange_n(&_message, &expected, retained, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        CFRelease(retained);
+        return (__bridge id)expected;
+    }
+    
+    return string;
+}
+
+- (const char *)bytes {
+    char *bytes = __atomic_load_n(&_bytes, __ATOMIC_ACQUIRE);
+    
+    if (bytes) {
+        return bytes;
+    }
+    
+    [self _encodeMessage];
+    
+    return __atomic_load_n(&_bytes, __ATOMIC_ACQUIRE);
+}
+
+- (NSUInteger)length {
+    if (__atomic_load_n(&_bytes, __ATOMIC_ACQUIRE) == NULL) {
+        [self _encodeMessage];
+    }
+    return _length;
+}
+
+- (NSString *)description {
+    id message = self.message;
+    
+    return [message isKindOfClass:NSString.class] ? message : [message description];
+}
+
+#pragma mark - Private methods
+
+- (void)_encodeMessage {
+    id message = (__bridge id)__atomic_load_n(&_message, __ATOMIC_ACQUIRE);
+    NSString *string = [message isKindOfClass:NSString.class] ? message : [message description];
+    NSUInteger maxLength = [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger length = 0;
+    char *bytes = malloc(MAX(maxLength, 1));
+    
+    [string getBytes:bytes maxLength:maxLength usedLength:&length encoding:NSUTF8StringEncoding options:NSStringEncodingConversionAllowLossy range:NSMakeRange(0, string.length) remainingRange:NULL];
+    
+    // Publish the bytes together with their length. If another thread was faster, use its bytes instead.
+    
+    @synchronized(self) {
+        if (_bytes == NULL) {
+            _length = length;
+            __atomic_store_n(&_bytes, bytes, __ATOMIC_RELEASE);
+            bytes = NULL;
+        }
+    }
+    
+    free(bytes);
+}
+
+@end
+
+BOOL NXLogTargetOverridesLogMessage(id target, Class baseClass) {
+    return [target methodForSelector:@selector(log:message:)] != [baseClass instanceMethodForSelector:@selector(log:message:)];
+}
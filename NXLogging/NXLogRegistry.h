@@ -37,12 +37,22 @@
  * A singelton for registration of loggers.
  * Every logger created with the static initializers of the NXLogger
  * class will be looked-up or registered with this registry.
+ * Lookups read an immutable snapshot of the registered loggers without locking.
+ * Registration replaces the snapshot.
  * You don't really need to use this class directly, unless you
  * create a logger with its non-static initializer and want to
  * reuse it at a later time.
  */
 @interface NXLogRegistry : NSObject
 
+#pragma mark - Properties
+
+/**
+ * A counter incremented whenever a logger replaces another one registered under the same name.
+ * Caches of looked-up loggers are valid as long as the generation does not change.
+ */
+@property (atomic, readonly) NSUInteger generation;
+
 #pragma mark - Static singleton initializer
 
 /**
@@ -65,12 +75,32 @@
 /**
  * Register a logger for later usage. The logger will be registered under
  * its name property. A logger registered under the same name will be
- * overwritten
+ * overwritten, which increments the generation. The registered
+ * loggers below the logger then inherit from it.
  *
  * @param logger (input) The logger to register
  */
 - (void)registerLogger:(NXLogger *)logger;
 
+#pragma mark - Methods to navigate the hierarchy of loggers
+
+/**
+ * Retrieve the nearest registered ancestor of a logger. The ancestors of "net.http.client"
+ * are "net.http" and "net", in this order.
+ *
+ * @param name (input) The name of the logger
+ * @result The registered logger with the longest name that is a proper ancestor of the name, or nil if there is none
+ */
+- (NXLogger *)ancestorOfLoggerNamed:(NSString *)name;
+
+/**
+ * Retrieve all registered loggers below a logger, i.e. those whose names start with the name followed by a dot
+ *
+ * @param name (input) The name of the logger
+ * @result The descendants in no particular order
+ */
+- (NSArray<NXLogger *> *)descendantsOfLoggerNamed:(NSString *)name;
+
 #pragma mark - Unavailable methods
 
 + (id)new NS_UNAVAILABLE;
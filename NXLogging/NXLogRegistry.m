@@ -31,9 +31,21 @@
 // -----------------------------------------------------------------------------
 
 #import "NXLogRegistry.h"
+#import "NXLogEpoch.h"
+#import <stdatomic.h>
+
+@interface NXLogger (NXLogRegistry)
+
+// Recompute the effective targets and level, e.g. when an ancestor was registered
+- (void)_updatePlan;
+
+@end
 
 @implementation NXLogRegistry {
-    NSMutableDictionary<NSString *, NXLogger *> *_loggers;
+    NSMutableDictionary<NSString *, NXLogger *> *_loggers; // The master dictionary, only accessed while synchronized
+    NXLogEpoch *_snapshotEpoch;
+    void *_snapshot; // An immutable copy of the master dictionary, only accessed through _snapshotEpoch
+    _Atomic(NSUInteger) _generation;
 }
 
 + (instancetype)sharedInstance {
@@ -50,19 +62,79 @@
     self = [super init];
     if (self) {
         _loggers = [NSMutableDictionary new];
+        _snapshotEpoch = [NXLogEpoch new];
+        [_snapshotEpoch replaceObjectAtSlot:&_snapshot withObject:[NSDictionary new]];
     }
     return self;
 }
 
+- (void)dealloc {
+    [_snapshotEpoch replaceObjectAtSlot:&_snapshot withObject:nil];
+}
+
+- (NSUInteger)generation {
+    return atomic_load_explicit(&_generation, memory_order_acquire);
+}
+
 - (NXLogger *)loggerNamed:(NSString *)name {
-    @synchronized(_loggers) {
-        return _loggers[name];
+    NSDictionary<NSString *, NXLogger *> *loggers = [_snapshotEpoch objectAtSlot:&_snapshot];
+    
+    return name ? loggers[name] : nil;
+}
+
+- (NXLogger *)ancestorOfLoggerNamed:(NSString *)name {
+    NSDictionary<NSString *, NXLogger *> *loggers = [_snapshotEpoch objectAtSlot:&_snapshot];
+    NSRange range = name ? [name rangeOfString:@"." options:NSBackwardsSearch] : NSMakeRange(NSNotFound, 0);
+    
+    while (range.location != NSNotFound) {
+        NXLogger *ancestor = loggers[[name substringToIndex:range.location]];
+        
+        if (ancestor) {
+            return ancestor;
+        }
+        range = [name rangeOfString:@"." options:NSBackwardsSearch range:NSMakeRange(0, range.location)];
     }
+    
+    return nil;
+}
+
+- (NSArray<NXLogger *> *)descendantsOfLoggerNamed:(NSString *)name {
+    NSDictionary<NSString *, NXLogger *> *loggers = [_snapshotEpoch objectAtSlot:&_snapshot];
+    NSString *prefix = [name stringByAppendingString:@"."];
+    NSMutableArray<NXLogger *> *descendants = [NSMutableArray new];
+    
+    if (prefix) {
+        [loggers enumerateKeysAndObjectsUsingBlock:^(NSString *key, NXLogger *logger, BOOL *stop) {
+            if ([key hasPrefix:prefix]) {
+                [descendants addObject:logger];
+            }
+        }];
+    }
+    
+    return descendants;
 }
 
 - (void)registerLogger:(NXLogger *)logger {
     @synchronized(_loggers) {
+        NXLogger *replacedLogger = _loggers[logger.name];
+        
         _loggers[logger.name] = logger;
+        
+        // Publish the new snapshot, ...
+        
+        [_snapshotEpoch replaceObjectAtSlot:&_snapshot withObject:[_loggers copy]];
+        
+        // ... and invalidate the cached lookups, if a logger was replaced
+        
+        if (replacedLogger && replacedLogger != logger) {
+            atomic_fetch_add_explicit(&_generation, 1, memory_order_acq_rel);
+        }
+    }
+    
+    // The loggers below may inherit from the logger now
+    
+    for (NXLogger *descendant in [self descendantsOfLoggerNamed:logger.name]) {
+        [descendant _updatePlan];
     }
 }
 
@@ -59,6 +59,18 @@
  */
 - (void)log:(NXLogLevel)level message:(id)message;
 
+@optional
+
+/**
+ * Log a record.
+ *
+ * @param record (input) The log record, which carries the log level and the message as UTF-8 bytes
+ * @discussion If implemented, this method is called instead of log:message: for messages of formatters that create records, so the bytes can be written without converting the message. The same requirements apply as for log:message:. The record is shared by all targets of the formatter.
+ */
+- (void)logRecord:(NXLogRecord *)record;
+
+@required
+
 #pragma mark - Unavailable methods
 
 + (id)new NS_UNAVAILABLE;
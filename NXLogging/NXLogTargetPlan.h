@@ -0,0 +1,90 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTarget.h"
+
+/// A target of the plan with the max log level it had when the plan was made
+typedef struct _NXLogTargetEntry {
+    __unsafe_unretained id<NXLogTarget> target;
+    __unsafe_unretained id<NXLogFormatter> formatter;
+    NXLogLevel maxLogLevel;
+} NXLogTargetEntry;
+
+/// The targets of the plan sharing the same formatter, sorted by descending max log level
+typedef struct _NXLogTargetGroup {
+    __unsafe_unretained id<NXLogFormatter> formatter;
+    NXLogLevel maxLogLevel;
+    BOOL producesRecords;
+    NSUInteger count;
+    const NXLogTargetEntry *entries;
+} NXLogTargetGroup;
+
+/**
+ * An immutable snapshot of a logger's targets, together with a precomputed
+ * plan of how to fan out a message to them: Targets are grouped by the identity
+ * of their formatters, so each message is formatted only once per formatter,
+ * and groups as well as targets are sorted by descending max log level, so
+ * iteration can stop at the first one not accepting a message.
+ */
+@interface NXLogTargetPlan : NSObject
+
+#pragma mark - Properties
+
+/// The targets in the order they were added
+@property (nonatomic, readonly) NSArray<id<NXLogTarget>> *targets;
+/// The highest max log level of all targets or NXLogLevelNone
+@property (nonatomic, readonly) NXLogLevel maxLogLevel;
+/// The union of the info required by the formatters of the targets that are not silenced
+@property (nonatomic, readonly) NXLogInfo requiredInfo;
+/// The formatters of the targets that implement requiredInfo
+@property (nonatomic, readonly) NSSet<id<NXLogFormatter>> *infoFormatters;
+/// The number of formatter groups
+@property (nonatomic, readonly) NSUInteger groupCount;
+/// The formatter groups. Valid as long as the plan lives.
+@property (nonatomic, readonly) const NXLogTargetGroup *groups;
+
+#pragma mark - Designated initializer
+
+/**
+ * Make a plan for the given targets
+ *
+ * @param targets The targets
+ */
+- (instancetype)initWithTargets:(NSArray<id<NXLogTarget>> *)targets NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
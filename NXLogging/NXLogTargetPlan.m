@@ -0,0 +1,157 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogTargetPlan.h"
+
+static int _NXLogTargetEntryCompare(const NXLogTargetEntry *e1, const NXLogTargetEntry *e2) {
+    uintptr_t f1 = (uintptr_t)(__bridge void *)e1->formatter;
+    uintptr_t f2 = (uintptr_t)(__bridge void *)e2->formatter;
+    
+    if (f1 != f2) {
+        return f1 < f2 ? -1 : 1;
+    }
+    return e1->maxLogLevel > e2->maxLogLevel ? -1 : (e1->maxLogLevel < e2->maxLogLevel ? 1 : 0);
+}
+
+static int _NXLogTargetGroupCompare(const void *p1, const void *p2) {
+    const NXLogTargetGroup *g1 = p1;
+    const NXLogTargetGroup *g2 = p2;
+    
+    return g1->maxLogLevel > g2->maxLogLevel ? -1 : (g1->maxLogLevel < g2->maxLogLevel ? 1 : 0);
+}
+
+@implementation NXLogTargetPlan {
+    NXLogTargetGroup *_groups;
+    NXLogTargetEntry *_entries;
+    NSArray<id<NXLogFormatter>> *_formatters; // Keeps the formatters referenced by the groups alive
+}
+
+- (instancetype)initWithTargets:(NSArray<id<NXLogTarget>> *)targets {
+    self = [super init];
+    if (self) {
+        NSUInteger count = targets.count;
+        NSMutableArray *formatters = [NSMutableArray new];
+        NSMutableSet *infoFormatters = [NSMutableSet new];
+        NXLogTargetEntry *entries = calloc(MAX(count, 1), sizeof(NXLogTargetEntry));
+        NSUInteger n = 0;
+        
+        _targets = [targets copy];
+        _maxLogLevel = NXLogLevelNone;
+        _requiredInfo = NXLogInfoNone;
+        
+        for (id<NXLogTarget> target in _targets) {
+            NXLogLevel level = target.maxLogLevel;
+            id<NXLogFormatter> formatter = target.logFormatter;
+            
+            // Silenced targets are not part of the plan
+            
+            if (level == NXLogLevelNone) {
+                continue;
+            }
+            
+            entries[n].target = target;
+            entries[n].formatter = formatter;
+            entries[n].maxLogLevel = level;
+            n++;
+            
+            if (level > _maxLogLevel) {
+                _maxLogLevel = level;
+            }
+            
+            if (formatter == nil) {
+                continue;
+            }
+            
+            if (![formatters containsObject:formatter]) {
+                [formatters addObject:formatter];
+            }
+            
+            if ([formatter respondsToSelector:@selector(requiredInfo)]) {
+                _requiredInfo |= formatter.requiredInfo;
+                [infoFormatters addObject:formatter];
+            } else {
+                _requiredInfo = NXLogInfoAll;
+            }
+        }
+        
+        // Sort the targets by formatter and descending max log level. Insertion sort is stable,
+        // so targets with the same formatter and level keep the order they were added in.
+        
+        for (NSUInteger i = 1; i < n; i++) {
+            NXLogTargetEntry entry = entries[i];
+            NSUInteger j = i;
+            
+            while (j > 0 && _NXLogTargetEntryCompare(&entry, &entries[j - 1]) < 0) {
+                entries[j] = entries[j - 1];
+                j--;
+            }
+            entries[j] = entry;
+        }
+        
+        // Group the targets by formatter
+        
+        _entries = entries;
+        _groups = calloc(MAX(n, 1), sizeof(NXLogTargetGroup));
+        _groupCount = 0;
+        
+        for (NSUInteger i = 0; i < n; i++) {
+            if (_groupCount == 0 || _groups[_groupCount - 1].formatter != entries[i].formatter) {
+                _groups[_groupCount].formatter = entries[i].formatter;
+                _groups[_groupCount].maxLogLevel = entries[i].maxLogLevel;
+                _groups[_groupCount].producesRecords = [entries[i].formatter respondsToSelector:@selector(recordForLogger:level:client:error:exception:format:arguments:)];
+                _groups[_groupCount].entries = &entries[i];
+                _groups[_groupCount].count = 0;
+                _groupCount++;
+            }
+            _groups[_groupCount - 1].count++;
+        }
+        
+        // Sort the groups by descending max log level
+        
+        qsort(_groups, _groupCount, sizeof(NXLogTargetGroup), _NXLogTargetGroupCompare);
+        
+        _formatters = formatters;
+        _infoFormatters = infoFormatters;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_groups);
+    free(_entries);
+}
+
+- (const NXLogTargetGroup *)groups {
+    return _groups;
+}
+
+@end
@@ -41,10 +41,34 @@ typedef struct _NXColor {
     UInt8 b;
 } NXColor;
 
+/**
+ * Describes the source code location of a log statement. The log macros emit
+ * one static instance per call site, so the strings need not be copied and the
+ * derived info (file name, method name, ...) is computed only once per call site.
+ */
+typedef struct _NXLogCallSite {
+    /// The calling function's name (static C string)
+    const char *function;
+    /// The calling file's path (static C string)
+    const char *file;
+    /// The calling line number
+    NSInteger line;
+    /// The calling module's name (static C string) or NULL
+    const char *module;
+    /// YES, if the call site lives as long as the process and may cache derived info
+    BOOL cacheable;
+    /// Private. Derived info cached by the logging framework. Must be initialised with NULL.
+    void *cache;
+    /// Private. The parsed message format cached by the logging framework. Must be initialised with NULL.
+    void *formatCache;
+} NXLogCallSite;
+
 /// Describes the level of a log message
 typedef NS_ENUM(NSInteger, NXLogLevel) {
     /// Use for maxLogLevel to switch off logging altogether
     NXLogLevelNone = NSIntegerMin,
+    /// Use for the maxLogLevel of a logger to take the level of its nearest ancestor
+    NXLogLevelInherit = NSIntegerMin + 1,
     /// After such an error the application is probably unusable
     NXLogLevelEmergency = -5,
     /// A serious failure in a key component bla
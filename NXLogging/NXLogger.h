@@ -46,12 +46,71 @@
  * @define NXLogErrorTo Log an error and a formatted message with the given log level using the given logger
  * @define NXLogExceptionTo Log an error and a formatted message with the given log level using the given logger
  */
-#define NXLog(level, ...) [[NXLogger applicationLogger] log:level info:NX_LOG_INFO format:__VA_ARGS__]
-#define NXLogError(level, err, ...) [[NXLogger applicationLogger] log:level info:NX_LOG_INFO error:err format:__VA_ARGS__]
-#define NXLogException(level, exc, ...) [[NXLogger applicationLogger] log:level info:NX_LOG_INFO exception:exc format:__VA_ARGS__]
-#define NXLogTo(logger, level, ...) [[NXLogger loggerNamed:logger] log:level info:NX_LOG_INFO format:__VA_ARGS__]
-#define NXLogErrorTo(logger, level, err, ...) [[NXLogger loggerNamed:logger] log:level info:NX_LOG_INFO error:err format:__VA_ARGS__]
-#define NXLogExceptionTo(logger, level, exc, ...) [[NXLogger loggerNamed:logger] log:level info:NX_LOG_INFO exception:exc format:__VA_ARGS__]
+#define NXLog(level, ...) NX_LOG_IF_ENABLED([NXLogger applicationLogger], level, format:__VA_ARGS__)
+#define NXLogError(level, err, ...) NX_LOG_IF_ENABLED([NXLogger applicationLogger], level, error:err format:__VA_ARGS__)
+#define NXLogException(level, exc, ...) NX_LOG_IF_ENABLED([NXLogger applicationLogger], level, exception:exc format:__VA_ARGS__)
+#define NXLogTo(logger, level, ...) NX_LOG_IF_ENABLED(NX_LOGGER_NAMED(logger), level, format:__VA_ARGS__)
+#define NXLogErrorTo(logger, level, err, ...) NX_LOG_IF_ENABLED(NX_LOGGER_NAMED(logger), level, error:err format:__VA_ARGS__)
+#define NXLogExceptionTo(logger, level, exc, ...) NX_LOG_IF_ENABLED(NX_LOGGER_NAMED(logger), level, exception:exc format:__VA_ARGS__)
+/** @/definedblock */
+
+#pragma mark - Logger lookup cached per call site
+
+/**
+ * @definedblock Cached logger lookup
+ * @abstract Looks up a logger by name once per call site
+ * @define NX_LOGGER_NAMED The logger with the given name, as +[NXLogger loggerNamed:] would return it. The logger
+ * is cached in a static variable of the call site, until another logger is registered under its name.
+ */
+#define NX_LOGGER_NAMED(name) ({ static void *_nx_logger_cache = NULL; [NXLogger loggerNamed:(name) cache:&_nx_logger_cache]; })
+/** @/definedblock */
+
+#pragma mark - Level gate used by the log macros
+
+/**
+ * @definedblock Compile-time level threshold
+ * @abstract Strips log statements above a log level from the binary
+ * @define NX_LOG_COMPILE_MAX_LEVEL The most verbose log level compiled in. Log macros with a constant level above it
+ * compile to nothing: Neither the logger, nor the format, nor the arguments are evaluated, and the optimizer removes
+ * the statement with its strings. Define it before importing NXLogging or in the preprocessor macros of a build
+ * configuration, e.g. NX_LOG_COMPILE_MAX_LEVEL=NXLogLevelNotice for Release. Defaults to NXLogLevelAny.
+ */
+#ifndef NX_LOG_COMPILE_MAX_LEVEL
+#define NX_LOG_COMPILE_MAX_LEVEL NXLogLevelAny
+#endif
+/** @/definedblock */
+
+/**
+ * @definedblock Level gate
+ * @abstract Evaluates a log message only if the logger accepts the level
+ * @define NX_LOG_IF_ENABLED Sends the log message to the logger only if the level is compiled in and at least one
+ * of the logger's targets accepts the level. The format arguments are not evaluated otherwise.
+ */
+#define NX_LOG_IF_ENABLED(logger, level, ...) \
+    do { \
+        NXLogLevel _nx_level = (level); \
+        if (_nx_level <= NX_LOG_COMPILE_MAX_LEVEL) { \
+            NXLogger *_nx_logger = (logger); \
+            if ([_nx_logger isEnabledForLevel:_nx_level]) { \
+                [_nx_logger log:_nx_level site:NX_LOG_SITE __VA_ARGS__]; \
+            } \
+        } \
+    } while (0)
+/** @/definedblock */
+
+#pragma mark - Static info about the log client's call site
+
+/**
+ * @definedblock Log call site
+ * @abstract Use to capture the location of the log statement
+ * @define NX_LOG_MODULE The module name recorded for log statements. Define it before importing NXLogging to set a module name. Defaults to NULL.
+ * @define NX_LOG_SITE Pointer to a static NXLogCallSite containing the log client's function, file, line number and module
+ */
+#ifndef NX_LOG_MODULE
+#define NX_LOG_MODULE NULL
+#endif
+
+#define NX_LOG_SITE ({ static NXLogCallSite _nx_site = { __FUNCTION__, __FILE__, __LINE__, NX_LOG_MODULE, YES, NULL, NULL }; &_nx_site; })
 /** @/definedblock */
 
 #pragma mark - Basic dictionary with info about the log client
@@ -70,6 +129,12 @@
  * A logger can be used to log messages at a certain log level to log targets.
  * Normally you would use one of the static initializers to create a new logger
  * or to get the instance of a formerly created logger.
+ *
+ * Logger names form a hierarchy separated by dots: "net" is an ancestor of "net.http.client".
+ * A logger without targets of its own logs to the targets of its nearest registered ancestor
+ * having targets, and a logger whose maxLogLevel is NXLogLevelInherit takes the level of its
+ * nearest registered ancestor setting one. The effective targets and levels are computed when
+ * the configuration of a logger or one of its ancestors changes, not when a message is logged.
  */
 @interface NXLogger : NSObject
 
@@ -79,20 +144,87 @@
 /**
  * The log targets of the logger. If a logger was freshly created by
  * one of the static initializers, this array will contain the singleton
- * instances of NXSystemLogTarget and NXConsoleLogTarget.
+ * instances of NXSystemLogTarget (NXLinuxSystemLogTarget on Linux) and NXConsoleLogTarget, unless the logger
+ * has a registered ancestor. A logger without targets of its own contains
+ * the targets it inherited.
  */
 @property (nonatomic, readonly) NSArray<id<NXLogTarget>> *targets;
 
+/**
+ * The maximum log level of the logger. Messages exceeding it are not logged, whatever the
+ * maxLogLevel of the targets. Defaults to NXLogLevelInherit, which takes the maxLogLevel of the
+ * nearest registered ancestor not inheriting it, or leaves the decision to the targets if there is none.
+ */
+@property (atomic) NXLogLevel maxLogLevel;
+
 /// The name of the logger
 @property (nonatomic, readonly) NSString *name;
 
+/**
+ * The highest maxLogLevel of all the logger's targets or NXLogLevelNone if the
+ * logger has no targets, limited by the logger's own (or inherited) maxLogLevel.
+ * The value is updated whenever a target is added or removed, whenever the maxLogLevel
+ * of one of the targets changes, and whenever an ancestor's configuration changes.
+ */
+@property (atomic, readonly) NXLogLevel effectiveMaxLogLevel;
+
+/**
+ * The bit mask representing the client info captured for each message. This is the union
+ * of the info required by the formatters of all targets that are not silenced.
+ * Updated whenever a target, its formatter, or the formatter's requiredInfo changes.
+ */
+@property (atomic, readonly) NXLogInfo capturedInfo;
+
+/**
+ * Set to YES to format messages on a background queue. The calling thread then only
+ * captures the log level, the call site, the date and the format arguments: scalars are
+ * copied, C strings are copied and objects are retained. Defaults to NO.
+ * @discussion Objects passed as arguments are described on the background queue, so they
+ * must not be mutated after logging them. Messages logged with an info dictionary and
+ * messages whose format cannot be captured (positional arguments, %*d or %n) are still
+ * formatted on the calling thread, as are messages logged from Swift, whose call sites only
+ * live as long as the call.
+ */
+@property (atomic) BOOL asynchronousFormatting;
+
+/**
+ * The number of messages per second each call site may log to this logger, e.g. 10.
+ * Messages exceeding the limit are dropped before they are formatted. Once a call site
+ * may log again, a message reports how many of its messages were dropped. If it does not
+ * log again, the report follows within ten seconds, or when the process exits.
+ * Set to 0 to disable rate limiting. Unless set, the default of +setDefaultRateLimit:burst: applies.
+ * @discussion Only messages logged through the macros or from Swift are limited, since
+ * messages logged with an info dictionary have no call site.
+ */
+@property (atomic) double rateLimit;
+
+/// The number of messages a call site may log at once, before rateLimit applies. Unless set, the default of +setDefaultRateLimit:burst: applies.
+@property (atomic) NSUInteger rateLimitBurst;
+
+/**
+ * Set to YES to suppress consecutive duplicates of a message. A duplicate has the same call site, level
+ * and message text, and neither error nor exception. When a different message follows, a message
+ * reports how often the last one was repeated. While no different message follows, the report is
+ * made every ten seconds and when the process exits. Defaults to NO.
+ * @discussion Detecting duplicates requires the message text, so the format arguments are substituted
+ * on the calling thread, even if asynchronousFormatting is set.
+ */
+@property (atomic) BOOL suppressesDuplicates;
+
+/// The number of messages dropped by the rate limit
+@property (atomic, readonly) NSUInteger droppedCount;
+
+/// The number of messages suppressed as duplicates
+@property (atomic, readonly) NSUInteger suppressedCount;
+
 #pragma mark - Static initializers
 /// @name Static initializers
 
 /**
  * Looks up the logger with the bundleIdentifier of your app as a name.
  * Creates and registers the logger if it does not yet exist. By default the logger
- * will log to the singleton instances of NXSystemLogTarget and NXConsoleLogTarget.
+ * will log to the singleton instances of NXSystemLogTarget (NXLinuxSystemLogTarget on Linux)
+ * and NXConsoleLogTarget.
  *
  * @result The logger instance
  */
@@ -101,13 +233,28 @@
 /**
  * Looks up the logger with the given name.
  * Creates and registers the logger if it does not yet exist. By default the logger
- * will log to the singleton instances of NXSystemLogTarget and NXConsoleLogTarget.
+ * will log to the singleton instances of NXSystemLogTarget (NXLinuxSystemLogTarget on Linux)
+ * and NXConsoleLogTarget.
+ * If a logger with an ancestor name, like "net" for "net.http", is registered,
+ * the logger is created without targets of its own and inherits them instead.
  *
  * @param name (input) The name of the logger
  * @result The logger instance
  */
 + (instancetype)loggerNamed:(NSString *)name;
 
+/**
+ * Looks up the logger with the given name like loggerNamed:, but consults a cache first.
+ * The cache remains valid until the generation of the NXLogRegistry changes. A call site
+ * looking up loggers of different names only caches the first one. A cache hit takes no lock
+ * and writes no shared memory. Loggers cached this way stay alive for the lifetime of the process.
+ *
+ * @param name (input) The name of the logger
+ * @param cache (input/output) The cache, a static variable initialised with NULL. Use the macro NX_LOGGER_NAMED.
+ * @result The logger instance
+ */
++ (instancetype)loggerNamed:(NSString *)name cache:(void **)cache;
+
 #pragma mark - Registration of a custom logger
 /// @name Registration of a custom logger
 
@@ -121,6 +268,18 @@
  */
 + (void)registerLogger:(NXLogger *)logger;
 
+#pragma mark - Global rate limit
+/// @name Global rate limit
+
+/**
+ * Set the rate limit of all loggers whose rateLimit and rateLimitBurst were not set individually.
+ * Defaults to no rate limit.
+ *
+ * @param rateLimit (input) The number of messages per second each call site may log, or 0 for no limit
+ * @param burst (input) The number of messages a call site may log at once
+ */
++ (void)setDefaultRateLimit:(double)rateLimit burst:(NSUInteger)burst;
+
 #pragma mark - Designated initializer
 /// @name Designated initializer
 
@@ -131,7 +290,7 @@
  * instance with the NXLogRegistry.
  *
  * @param name (input) The name for the logger
- * @param target (input) The initial log target for the logger
+ * @param target (input) The initial log target for the logger, or nil to inherit the targets of the nearest registered ancestor
  * @result The logger instance
  */
 - (instancetype)initWithName:(NSString *)name target:(id<NXLogTarget>)target NS_DESIGNATED_INITIALIZER;
@@ -157,6 +316,16 @@
 #pragma mark - Methods for logging
 /// @name Methods for logging
 
+/**
+ * Determine if a message with the given log level would be logged to at least one target
+ *
+ * @param level (input) The log level
+ * @result YES, if the level does not exceed the effectiveMaxLogLevel, NO otherwise.
+ * @discussion The log macros call this method before evaluating any arguments. Use it
+ * yourself to guard expensive log statements when calling the logger directly.
+ */
+- (BOOL)isEnabledForLevel:(NXLogLevel)level;
+
 /**
  * Log a message and info with the given log level to the logger's targets
  *
@@ -219,6 +388,53 @@
  */
 - (void)log:(NXLogLevel)level info:(NSDictionary *)info error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments;
 
+#pragma mark - Methods for logging with a static call site
+/// @name Methods for logging with a static call site
+
+/**
+ * Log a message with the given log level to the logger's targets
+ *
+ * @param level (input) The log level
+ * @param site (input) The call site. Use the macro NX_LOG_SITE or pass a call site that outlives the call.
+ * @param format (input) The message format (can be nil). See +[NSString stringWithFormat:] for more info.
+ * @param ... A comma-separated list of arguments to substitute into format.
+ */
+- (void)log:(NXLogLevel)level site:(NXLogCallSite *)site format:(NSString *)format, ... NS_FORMAT_FUNCTION(3,4);
+
+/**
+ * Log a message and an error with the given log level to the logger's targets
+ *
+ * @param level (input) The log level
+ * @param site (input) The call site. Use the macro NX_LOG_SITE or pass a call site that outlives the call.
+ * @param error (input) The error whose trace will be logged.
+ * @param format (input) The message format (can be nil). See +[NSString stringWithFormat:] for more info.
+ * @param ... A comma-separated list of arguments to substitute into format.
+ */
+- (void)log:(NXLogLevel)level site:(NXLogCallSite *)site error:(NSError *)error format:(NSString *)format, ... NS_FORMAT_FUNCTION(4,5);
+
+/**
+ * Log a message and an exception with the given log level to the logger's targets
+ *
+ * @param level (input) The log level
+ * @param site (input) The call site. Use the macro NX_LOG_SITE or pass a call site that outlives the call.
+ * @param exception (input) The exception whose trace (see NSException+NXLogging) will be logged.
+ * @param format (input) The message format (can be nil). See +[NSString stringWithFormat:] for more info.
+ * @param ... A comma-separated list of arguments to substitute into format.
+ */
+- (void)log:(NXLogLevel)level site:(NXLogCallSite *)site exception:(NSException *)exception format:(NSString *)format, ... NS_FORMAT_FUNCTION(4,5);
+
+/**
+ * Log a message, an error and an exception with the given log level to the logger's targets
+ *
+ * @param level (input) The log level
+ * @param site (input) The call site. Use the macro NX_LOG_SITE or pass a call site that outlives the call.
+ * @param error (input) The error whose trace will be logged.
+ * @param exception (input) The exception whose trace will be logged.
+ * @param format (input) The message format (can be nil). See -[NSString initWithFormat:arguments:] for more info.
+ * @param arguments A list of arguments to substitute into format.
+ */
+- (void)log:(NXLogLevel)level site:(NXLogCallSite *)site error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments;
+
 #pragma mark - Unavailable methods
 
 + (id)new NS_UNAVAILABLE;
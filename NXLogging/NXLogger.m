@@ -32,18 +32,183 @@
 
 #import "NXLogger.h"
 #import "NXSystemLogTarget.h"
+#import "NXLinuxSystemLogTarget.h"
 #import "NXConsoleLogTarget.h"
 #import "NSError+NXLogging.h"
 #import "NXLogRegistry.h"
+#import "NXLogTargetPlan.h"
+#import "NXLogArguments.h"
+#import "NXLogPipeline.h"
+#import "NXLogRateLimiter.h"
+#import "NXLogEpoch.h"
+#import <stdatomic.h>
+
+static void *NXLoggerTargetContext = &NXLoggerTargetContext;
+static void *NXLoggerFormatterContext = &NXLoggerFormatterContext;
+
+// The number of call sites whose rate is limited per logger
+static const NSUInteger NXLoggerRateLimiterCapacity = 1024;
+
+// The interval at which dropped and suppressed messages are reported, if no later message of their call site did
+static const int64_t NXLoggerReportInterval = 10 * NSEC_PER_SEC;
+
+// The loggers limiting the rate or suppressing duplicates, to report their counts periodically
+static NSHashTable<NXLogger *> *NXLoggerReportingInstances = nil;
+
+// All loggers, to finish their asynchronous formatting and report their counts when the process exits
+static NSHashTable<NXLogger *> *NXLoggerInstances = nil;
+
+// The rate limit of loggers without one of their own. The interval is in nanoseconds, 0 means no limit.
+static _Atomic(uint64_t) NXLoggerDefaultRateLimitInterval = 0;
+static _Atomic(NSUInteger) NXLoggerDefaultRateLimitBurst = 1;
+
+// Marks the rate limit of a logger as not set, so the default applies
+static const uint64_t NXLoggerRateLimitIntervalDefault = UINT64_MAX;
+static const NSUInteger NXLoggerRateLimitBurstDefault = NSUIntegerMax;
+
+// Convert a rate in messages per second to the interval between two messages in nanoseconds
+static uint64_t NXLoggerIntervalForRate(double rate) {
+    return rate > 0 ? MAX((uint64_t)MIN(NSEC_PER_SEC / rate, (double)(UINT64_MAX >> 1)), 1) : 0;
+}
+
+// A hash identifying a message for the detection of duplicates, never 0
+static uint64_t NXLoggerMessageHash(NSString *message, NXLogCallSite *site, NXLogLevel level) {
+    uint64_t hash = 0xCBF29CE484222325ULL; // FNV-1a
+    
+    // NSString's own hash only considers a part of long strings, so hash all characters
+    
+    NSUInteger length = message.length;
+    unichar chars[256];
+    
+    for (NSUInteger location = 0; location < length; location += 256) {
+        NSRange range = NSMakeRange(location, MIN(length - location, 256));
+        
+        [message getCharacters:chars range:range];
+        
+        for (NSUInteger i = 0; i < range.length; i++) {
+            hash = (hash ^ chars[i]) * 0x100000001B3ULL;
+        }
+    }
+    
+    hash ^= (uint64_t)length * 0x9E3779B97F4A7C15ULL;
+    hash ^= (uint64_t)level * 0xC2B2AE3D27D4EB4FULL;
+    
+    if (site) {
+        hash ^= ((uint64_t)(uintptr_t)site->file + (uint64_t)site->line) * 0x165667B19E3779F9ULL;
+    }
+    
+    return hash ? hash : 1;
+}
+
+@interface NXLogger ()
+
+- (void)_logUnfiltered:(NXLogLevel)level site:(NXLogCallSite *)site info:(NSDictionary *)info error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments;
+- (void)_logToPlan:(NXLogTargetPlan *)plan level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments;
+- (void)_finishFormatting;
+- (void)_reportCounts;
+
+@end
+
+/// A logger cached for a call site, together with the name it was looked up with and the generation of the registry at that time.
+/// Entries are immutable and never freed, since call sites read them with nothing but an acquire load.
+typedef struct _NXLoggerCacheEntry {
+    NSUInteger generation;
+    const void *name;   // Retained
+    const void *logger; // Retained
+} NXLoggerCacheEntry;
+
+static NSArray<NXLogger *> *_NXLoggerReportingLoggers(void) {
+    @synchronized(NXLoggerReportingInstances) {
+        return NXLoggerReportingInstances.allObjects;
+    }
+}
+
+// Finish the asynchronous formatting and report the counts of all loggers, when the process exits,
+// and make sure the messages are delivered and written before the process is gone
+static void _NXLoggerFlushAtExit(void) {
+    NSArray<NXLogger *> *loggers;
+    NSMutableSet<id<NXLogTarget>> *targets = [NSMutableSet new];
+    
+    @synchronized(NXLoggerInstances) {
+        loggers = NXLoggerInstances.allObjects;
+    }
+    
+    for (NXLogger *logger in loggers) {
+        [logger _finishFormatting];
+        [logger _reportCounts];
+        [targets addObjectsFromArray:logger.targets];
+    }
+    
+    [[NXLogPipeline sharedInstance] drain];
+    
+    for (id<NXLogTarget> target in targets) {
+        if ([target respondsToSelector:@selector(flush)]) {
+            [(id)target flush];
+        }
+    }
+}
+
+// The log target of the system log of the platform
+static id<NXLogTarget> _NXLoggerSystemLogTarget(void) {
+#if defined(__APPLE__)
+    return [NXSystemLogTarget sharedInstance];
+#elif defined(__linux__)
+    return [NXLinuxSystemLogTarget sharedInstance];
+#else
+    return nil;
+#endif
+}
+
+// Variadic trampoline to log a message past the rate limit and the suppression of duplicates
+static void _NXLogUnfiltered(NXLogger *logger, NXLogLevel level, NXLogCallSite *site, NSDictionary *info, NSError *error, NSException *exception, NSString *format, ...) {
+    va_list args;
+    va_start(args, format);
+    
+    [logger _logUnfiltered:level site:site info:info error:error exception:exception format:format arguments:args];
+    
+    va_end(args);
+}
+
+// Variadic trampoline to log a message, whose arguments were captured earlier, with a proper va_list
+static void _NXLogToPlan(NXLogger *logger, NXLogTargetPlan *plan, NXLogLevel level, NXLogClientInfo *client, NSError *error, NSException *exception, NSString *format, ...) {
+    va_list args;
+    va_start(args, format);
+    
+    [logger _logToPlan:plan level:level client:client error:error exception:exception format:format arguments:args];
+    
+    va_end(args);
+}
 
 @implementation NXLogger {
-    NSMutableArray<id<NXLogTarget>> *_targets;
+    NSMutableArray<id<NXLogTarget>> *_targets; // The master list, only accessed while synchronized
+    NSSet<id<NXLogFormatter>> *_observedFormatters;
+    NXLogEpoch *_planEpoch;
+    void *_plan; // The current NXLogTargetPlan, only accessed through _planEpoch
+    _Atomic(NXLogLevel) _maxLogLevel;
+    _Atomic(NXLogLevel) _effectiveMaxLogLevel;
+    _Atomic(NXLogInfo) _capturedInfo;
+    dispatch_queue_t _formatQueue;
+    _Atomic(void *) _rateLimiter; // The NXLogRateLimiter (retained), created when first needed
+    _Atomic(uint64_t) _rateLimitInterval;
+    _Atomic(NSUInteger) _rateLimitBurst;
+    _Atomic(uint64_t) _lastMessageHash; // The hash of the last message, 0 if it cannot be repeated
+    _Atomic(NSUInteger) _repeatCount; // The number of duplicates of the last message suppressed
+    _Atomic(NXLogLevel) _repeatLevel;
+    _Atomic(NSUInteger) _droppedCount;
+    _Atomic(NSUInteger) _suppressedCount;
+    atomic_bool _reporting; // YES, once the logger is one of NXLoggerReportingInstances
 }
 
 #pragma mark - Static initializers
 
 + (instancetype)applicationLogger {
-    return [self loggerNamed:[NSBundle mainBundle].bundleIdentifier];
+    static NSString *bundleIdentifier = nil;
+    static void *cache = NULL;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        bundleIdentifier = [NSBundle mainBundle].bundleIdentifier;
+    });
+    return [self loggerNamed:bundleIdentifier cache:&cache];
 }
 
 + (instancetype)loggerNamed:(NSString *)name {
@@ -57,15 +222,19 @@
     
     if (logger == nil) {
         
-        // ... init the logger with the name and the default log target, ...
+        // ... init the logger with the name and the default log target, unless it inherits the targets of an ancestor, ...
+        
+        BOOL inherits = [registry ancestorOfLoggerNamed:name] != nil;
         
-        logger = [[self alloc] initWithName:name target:[NXSystemLogTarget sharedInstance]];
+        logger = [[self alloc] initWithName:name target:inherits ? nil : _NXLoggerSystemLogTarget()];
         
         if (logger) {
             
             // ... add the debug log target as well, ...
             
-            [logger addLogTarget:[NXConsoleLogTarget sharedInstance]];
+            if (!inherits) {
+                [logger addLogTarget:[NXConsoleLogTarget sharedInstance]];
+            }
             
             // ... and register the logger
             
@@ -76,12 +245,49 @@
     return logger;
 }
 
++ (instancetype)loggerNamed:(NSString *)name cache:(void **)cache {
+    NXLoggerCacheEntry *entry = __atomic_load_n((NXLoggerCacheEntry **)cache, __ATOMIC_ACQUIRE);
+    NSUInteger generation = [NXLogRegistry sharedInstance].generation;
+    
+    // Use the cached logger, unless another logger was registered meanwhile or the name differs
+    
+    if (entry && entry->generation == generation && (entry->name == (__bridge void *)name || [(__bridge NSString *)entry->name isEqualToString:name])) {
+        return (__bridge NXLogger *)entry->logger;
+    }
+    
+    NXLogger *logger = [self loggerNamed:name];
+    
+    // Only fill an empty or outdated cache, so call sites alternating between names do not keep replacing it.
+    // The replaced entry is left alone, as other threads may still use it. It only happens once per registration.
+    
+    if (logger && (entry == NULL || entry->generation != generation)) {
+        NXLoggerCacheEntry *newEntry = malloc(sizeof(NXLoggerCacheEntry));
+        
+        newEntry->generation = generation;
+        newEntry->name = CFBridgingRetain([name copy]);
+        newEntry->logger = CFBridgingRetain(logger);
+        
+        if (!__atomic_compare_exchange_n((NXLoggerCacheEntry **)cache, &entry, newEntry, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            CFRelease(newEntry->name);
+            CFRelease(newEntry->logger);
+            free(newEntry);
+        }
+    }
+    
+    return logger;
+}
+
 #pragma mark - Other static methods
 
 + (void)registerLogger:(NXLogger *)logger {
     [[NXLogRegistry sharedInstance] registerLogger:logger];
 }
 
++ (void)setDefaultRateLimit:(double)rateLimit burst:(NSUInteger)burst {
+    atomic_store_explicit(&NXLoggerDefaultRateLimitBurst, MAX(burst, 1), memory_order_relaxed);
+    atomic_store_explicit(&NXLoggerDefaultRateLimitInterval, NXLoggerIntervalForRate(rateLimit), memory_order_relaxed);
+}
+
 #pragma mark - Designated initializer
 
 - (instancetype)initWithName:(NSString *)name target:(id<NXLogTarget>)target {
@@ -89,25 +295,118 @@
     self = [super init];
     if (self) {
         _name = name;
-        _targets = [NSMutableArray arrayWithObject:target];
+        _targets = target ? [NSMutableArray arrayWithObject:target] : [NSMutableArray new];
+        _observedFormatters = [NSSet new];
+        _planEpoch = [NXLogEpoch new];
+        _formatQueue = dispatch_queue_create("com.naxos-software.NXLogging.format", DISPATCH_QUEUE_SERIAL);
+        atomic_init(&_maxLogLevel, NXLogLevelInherit);
+        atomic_init(&_rateLimitInterval, NXLoggerRateLimitIntervalDefault);
+        atomic_init(&_rateLimitBurst, NXLoggerRateLimitBurstDefault);
+        if (target) {
+            [self _observeTarget:target];
+        }
+        [self _updatePlan];
+        
+        static dispatch_once_t registerOnce;
+        dispatch_once(&registerOnce, ^{
+            NXLoggerInstances = [NSHashTable weakObjectsHashTable];
+            atexit(_NXLoggerFlushAtExit);
+        });
+        @synchronized(NXLoggerInstances) {
+            [NXLoggerInstances addObject:self];
+        }
     }
     return self;
 }
 
+- (void)dealloc {
+    for (id<NXLogTarget> target in _targets) {
+        [self _unobserveTarget:target];
+    }
+    for (id<NXLogFormatter> formatter in _observedFormatters) {
+        [(NSObject *)formatter removeObserver:self forKeyPath:NSStringFromSelector(@selector(requiredInfo)) context:NXLoggerFormatterContext];
+    }
+    
+    [_planEpoch replaceObjectAtSlot:&_plan withObject:nil];
+    
+    void *rateLimiter = atomic_exchange(&_rateLimiter, NULL);
+    
+    if (rateLimiter) {
+        CFRelease(rateLimiter);
+    }
+}
+
 #pragma mark - Public API
 
+- (NSArray<id<NXLogTarget>> *)targets {
+    return [self _plan].targets;
+}
+
+- (NXLogLevel)maxLogLevel {
+    return atomic_load_explicit(&_maxLogLevel, memory_order_relaxed);
+}
+
+- (void)setMaxLogLevel:(NXLogLevel)maxLogLevel {
+    atomic_store_explicit(&_maxLogLevel, maxLogLevel, memory_order_relaxed);
+    [self _updateHierarchy];
+}
+
+- (NXLogLevel)effectiveMaxLogLevel {
+    return atomic_load_explicit(&_effectiveMaxLogLevel, memory_order_relaxed);
+}
+
+- (NXLogInfo)capturedInfo {
+    return atomic_load_explicit(&_capturedInfo, memory_order_relaxed);
+}
+
+- (double)rateLimit {
+    uint64_t interval = [self _rateLimitInterval];
+    
+    return interval ? (double)NSEC_PER_SEC / interval : 0;
+}
+
+- (void)setRateLimit:(double)rateLimit {
+    atomic_store_explicit(&_rateLimitInterval, NXLoggerIntervalForRate(rateLimit), memory_order_relaxed);
+}
+
+- (NSUInteger)rateLimitBurst {
+    return [self _rateLimitBurst];
+}
+
+- (void)setRateLimitBurst:(NSUInteger)rateLimitBurst {
+    atomic_store_explicit(&_rateLimitBurst, MAX(rateLimitBurst, 1), memory_order_relaxed);
+}
+
+- (NSUInteger)droppedCount {
+    return atomic_load_explicit(&_droppedCount, memory_order_relaxed);
+}
+
+- (NSUInteger)suppressedCount {
+    return atomic_load_explicit(&_suppressedCount, memory_order_relaxed);
+}
+
+- (BOOL)isEnabledForLevel:(NXLogLevel)level {
+    return level <= atomic_load_explicit(&_effectiveMaxLogLevel, memory_order_relaxed);
+}
+
 - (void)addLogTarget:(id<NXLogTarget>)target {
     @synchronized(_targets) {
         if (![_targets containsObject:target]) {
             [_targets addObject:target];
+            [self _observeTarget:target];
         }
     }
+    [self _updateHierarchy];
 }
 
 - (void)removeLogTarget:(id<NXLogTarget>)target {
     @synchronized(_targets) {
-        [_targets removeObject:target];
+        if ([_targets containsObject:target]) {
+            [self _unobserveTarget:target];
+            [_targets removeObject:target];
+        }
     }
+    [self _updateHierarchy];
 }
 
 - (void)log:(NXLogLevel)level info:(NSDictionary *)logInfo format:(NSString *)format, ... {
@@ -152,61 +451,389 @@
 
 - (void)log:(NXLogLevel)level info:(NSDictionary *)info error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
     
-    NSArray *targets;
+    [self _log:level site:NULL info:info error:error exception:exception format:format arguments:arguments];
+}
+
+- (void)log:(NXLogLevel)level site:(NXLogCallSite *)site format:(NSString *)format, ... {
     
-    @synchronized(_targets) {
-        targets = [NSArray arrayWithArray:_targets];
+    va_list args;
+    va_start(args, format);
+    
+    [self _log:level site:site info:nil error:nil exception:nil format:format arguments:args];
+    
+    va_end(args);
+}
+
+- (void)log:(NXLogLevel)level site:(NXLogCallSite *)site error:(NSError *)error format:(NSString *)format, ... {
+    
+    va_list args;
+    va_start(args, format);
+    
+    [self _log:level site:site info:nil error:error exception:nil format:format arguments:args];
+    
+    va_end(args);
+}
+
+- (void)log:(NXLogLevel)level site:(NXLogCallSite *)site exception:(NSException *)exception format:(NSString *)format, ... {
+    
+    va_list args;
+    va_start(args, format);
+    
+    [self _log:level site:site info:nil error:nil exception:exception format:format arguments:args];
+    
+    va_end(args);
+}
+
+- (void)log:(NXLogLevel)level site:(NXLogCallSite *)site error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
+    
+    [self _log:level site:site info:nil error:error exception:exception format:format arguments:arguments];
+}
+
+#pragma mark - Key-value observing
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSString *, id> *)change context:(void *)context {
+    if (context == NXLoggerTargetContext || context == NXLoggerFormatterContext) {
+        [self _updateHierarchy];
+    } else {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
     }
+}
+
+#pragma mark - Private methods
+
+- (void)_log:(NXLogLevel)level site:(NXLogCallSite *)site info:(NSDictionary *)info error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
     
-    NSMutableDictionary *messageCache = targets.count > 1 ? [NSMutableDictionary new] : nil;
-    NXLogClientInfo *client = nil;
+    // Bail out early, if none of the targets would log the message
     
-    // Log to each target ...
+    if (![self isEnabledForLevel:level]) {
+        return;
+    }
     
-    for (id<NXLogTarget> target in targets) {
+    // Drop messages exceeding the rate limit of their call site, before anything is formatted
+    
+    if (site) {
+        uint64_t interval = [self _rateLimitInterval];
         
-        // ... but only if the log level does not exceed the target's max log level
+        if (interval && ![self _admitCallSite:site level:level interval:interval]) {
+            return;
+        }
+    }
+    
+    // Suppress consecutive duplicates, which requires the message text
+    
+    if (_suppressesDuplicates) {
+        NSString *message = nil;
         
-        if (level <= target.maxLogLevel) {
-            
-            // Try to get the message from the cache
-            
-            NSString *formatKey = [NSString stringWithFormat:@"%p", target.logFormatter]; // identity
-            id message = messageCache[formatKey];
-            
-            // If we dont have the message yet ...
+        if (format) {
+            va_list args;
+            va_copy(args, arguments);
+            message = [[NSString alloc] initWithFormat:format arguments:args];
+            va_end(args);
+        }
+        
+        if ([self _isRepeatOfMessage:message site:site level:level error:error exception:exception]) {
+            return;
+        }
+        
+        // Do not format the message twice, unless variables in the format may need to be replaced before the arguments
+        
+        if (format && [format rangeOfString:@"$("].location == NSNotFound) {
+            _NXLogUnfiltered(self, level, site, info, error, exception, @"%@", message);
+            return;
+        }
+    }
+    
+    [self _logUnfiltered:level site:site info:info error:error exception:exception format:format arguments:arguments];
+}
+
+- (void)_logUnfiltered:(NXLogLevel)level site:(NXLogCallSite *)site info:(NSDictionary *)info error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
+    
+    NXLogTargetPlan *plan = [self _plan];
+    NXLogInfo capturedInfo = plan.requiredInfo;
+    
+    // In asynchronous mode only capture the arguments and leave the formatting to the format queue
+    
+    if (_asynchronousFormatting && site && site->cacheable) {
+        NXLogArguments *args = nil;
+        
+        // Capture from a copy, so the arguments can still be formatted synchronously, if need be
+        
+        if (format) {
+            va_list argsCopy;
+            va_copy(argsCopy, arguments);
+            args = [[NXLogArguments alloc] initWithFormat:format site:site arguments:argsCopy];
+            va_end(argsCopy);
+        }
+        
+        // Formats we cannot capture fall back to synchronous formatting, and so do formats with
+        // variables, as the formatter has to expand them before the arguments are substituted
+        
+        if (format == nil || (args && !args.containsVariables)) {
+            CFAbsoluteTime time = capturedInfo & NXLogInfoDate ? CFAbsoluteTimeGetCurrent() : 0;
             
-            if (message == nil) {
-                
-                // ... construct it by creating log client info (if not yet done), ...
+            dispatch_async(_formatQueue, ^{
+                NSDate *date = capturedInfo & NXLogInfoDate ? [NSDate dateWithTimeIntervalSinceReferenceDate:time] : nil;
+                NXLogClientInfo *client = [[NXLogClientInfo alloc] initWithCallSite:site capturedInfo:capturedInfo date:date];
                 
-                if (client == nil) {
-                    // Add some more info
-                    client = [[NXLogClientInfo alloc] initWithSourceCodeInfo:info];
+                if (args) {
+                    _NXLogToPlan(self, plan, level, client, error, exception, @"%@", args.message);
+                } else {
+                    _NXLogToPlan(self, plan, level, client, error, exception, nil);
                 }
+            });
+            return;
+        }
+    }
+    
+    // Variables of the format are expanded with the source code info and the date, even if no target captures them
+    
+    BOOL expandsVariables = format && site && [NXLogArguments formatContainsVariables:format site:site];
+    NXLogClientInfo *client = site ? [[NXLogClientInfo alloc] initWithCallSite:site capturedInfo:capturedInfo date:nil expandsVariables:expandsVariables] : [[NXLogClientInfo alloc] initWithSourceCodeInfo:info];
+    
+    [self _logToPlan:plan level:level client:client error:error exception:exception format:format arguments:arguments];
+}
 
-                // ... copying the variable argument list (because traversing it is destructive), ...
-                
-                va_list args;
-                if (arguments) {
-                    va_copy(args, arguments);
-                }
-                
-                // ... and formatting the message
-                
-                message = [target.logFormatter messageForLogger:self.name level:level client:client error:error exception:exception format:format arguments:args];
-                
-                // Cache the message for potential reuse
+- (void)_logToPlan:(NXLogTargetPlan *)plan level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
+    
+    NXLogPipeline *pipeline = [NXLogPipeline sharedInstance];
+    const NXLogTargetGroup *groups = plan.groups;
+    NSUInteger groupCount = plan.groupCount;
+    
+    // Log to each group of targets sharing a formatter, ...
+    
+    for (NSUInteger i = 0; i < groupCount; i++) {
+        const NXLogTargetGroup *group = &groups[i];
+        
+        // ... but only if the log level does not exceed the max log level of the group (groups are sorted by it)
+        
+        if (level > group->maxLogLevel) {
+            break;
+        }
+        
+        // Construct the message by copying the variable argument list (because traversing it is destructive), ...
+        
+        va_list args;
+        if (arguments) {
+            va_copy(args, arguments);
+        }
+        
+        // ... and formatting the message once for all targets of the group, as a record if the formatter supports it
+        
+        id message;
+        
+        if (group->producesRecords) {
+            message = [group->formatter recordForLogger:self.name level:level client:client error:error exception:exception format:format arguments:args];
+        } else {
+            message = [group->formatter messageForLogger:self.name level:level client:client error:error exception:exception format:format arguments:args];
+        }
+        
+        if (arguments) {
+            va_end(args);
+        }
+        
+        // Log the message to each target of the group that accepts the level (targets are sorted by it)
+        
+        for (NSUInteger j = 0; j < group->count && level <= group->entries[j].maxLogLevel; j++) {
+            [pipeline enqueueMessage:message level:level target:group->entries[j].target];
+        }
+    }
+}
+
+- (uint64_t)_rateLimitInterval {
+    uint64_t interval = atomic_load_explicit(&_rateLimitInterval, memory_order_relaxed);
+    
+    return interval == NXLoggerRateLimitIntervalDefault ? atomic_load_explicit(&NXLoggerDefaultRateLimitInterval, memory_order_relaxed) : interval;
+}
+
+- (NSUInteger)_rateLimitBurst {
+    NSUInteger burst = atomic_load_explicit(&_rateLimitBurst, memory_order_relaxed);
+    
+    return burst == NXLoggerRateLimitBurstDefault ? atomic_load_explicit(&NXLoggerDefaultRateLimitBurst, memory_order_relaxed) : burst;
+}
+
+- (NXLogRateLimiter *)_rateLimiter {
+    void *rateLimiter = atomic_load_explicit(&_rateLimiter, memory_order_acquire);
+    
+    // Created once on first use. The loser of a race releases its limiter.
+    
+    if (rateLimiter == NULL) {
+        void *newRateLimiter = (void *)CFBridgingRetain([[NXLogRateLimiter alloc] initWithCapacity:NXLoggerRateLimiterCapacity]);
+        
+        if (atomic_compare_exchange_strong_explicit(&_rateLimiter, &rateLimiter, newRateLimiter, memory_order_acq_rel, memory_order_acquire)) {
+            rateLimiter = newRateLimiter;
+            [self _startReporting];
+        } else {
+            CFRelease(newRateLimiter);
+        }
+    }
+    
+    return (__bridge NXLogRateLimiter *)rateLimiter;
+}
+
+- (BOOL)_admitCallSite:(NXLogCallSite *)site level:(NXLogLevel)level interval:(uint64_t)interval {
+    NSUInteger dropped;
+    
+    if (![[self _rateLimiter] admitCallSite:site interval:interval burst:[self _rateLimitBurst] dropped:&dropped]) {
+        atomic_fetch_add_explicit(&_droppedCount, 1, memory_order_relaxed);
+        return NO;
+    }
+    
+    // Report the messages dropped since the call site was last admitted
+    
+    if (dropped) {
+        _NXLogUnfiltered(self, level, site, nil, nil, nil, @"%lu messages of this call site were dropped by the rate limit", (unsigned long)dropped);
+    }
+    
+    return YES;
+}
+
+- (BOOL)_isRepeatOfMessage:(NSString *)message site:(NXLogCallSite *)site level:(NXLogLevel)level error:(NSError *)error exception:(NSException *)exception {
+    
+    // Messages with an error or an exception are never considered duplicates
+    
+    uint64_t hash = error || exception ? 0 : NXLoggerMessageHash(message, site, level);
+    uint64_t lastHash = atomic_exchange_explicit(&_lastMessageHash, hash, memory_order_relaxed);
+    
+    if (hash && hash == lastHash) {
+        atomic_store_explicit(&_repeatLevel, level, memory_order_relaxed);
+        if (atomic_fetch_add_explicit(&_repeatCount, 1, memory_order_relaxed) == 0) {
+            [self _startReporting];
+        }
+        atomic_fetch_add_explicit(&_suppressedCount, 1, memory_order_relaxed);
+        return YES;
+    }
+    
+    // The run of the last message ended, so report how often it was repeated
+    
+    [self _reportRepeats];
+    
+    return NO;
+}
+
+- (void)_reportRepeats {
+    NSUInteger repeats = atomic_load_explicit(&_repeatCount, memory_order_relaxed) ? atomic_exchange_explicit(&_repeatCount, 0, memory_order_relaxed) : 0;
+    
+    if (repeats) {
+        _NXLogUnfiltered(self, atomic_load_explicit(&_repeatLevel, memory_order_relaxed), NULL, nil, nil, nil, @"Last message repeated %lu times", (unsigned long)repeats);
+    }
+}
+
+// Wait until the messages formatted asynchronously so far have been handed to the targets
+- (void)_finishFormatting {
+    dispatch_sync(_formatQueue, ^{});
+}
 
-                messageCache[formatKey] = message;
+// Report the duplicates suppressed and the messages dropped, which no later message reported so far
+- (void)_reportCounts {
+    [self _reportRepeats];
+    
+    NXLogRateLimiter *rateLimiter = (__bridge NXLogRateLimiter *)atomic_load_explicit(&_rateLimiter, memory_order_acquire);
+    
+    [rateLimiter collectDroppedCounts:^(const char *file, NSInteger line, NSUInteger dropped) {
+        NSDictionary *info = @{@(NXLogInfoFile) : @(file), @(NXLogInfoLine) : @(line)};
+        
+        _NXLogUnfiltered(self, NXLogLevelWarning, NULL, info, nil, nil, @"%lu messages of this call site were dropped by the rate limit", (unsigned long)dropped);
+    }];
+}
+
+// Have the counts reported periodically. They are reported at exit in any case.
+- (void)_startReporting {
+    if (atomic_exchange(&_reporting, true)) {
+        return;
+    }
+    
+    static dispatch_source_t reportTimer = nil;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        NXLoggerReportingInstances = [NSHashTable weakObjectsHashTable];
+        
+        reportTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+        dispatch_source_set_event_handler(reportTimer, ^{
+            for (NXLogger *logger in _NXLoggerReportingLoggers()) {
+                [logger _reportCounts];
+            }
+        });
+        dispatch_source_set_timer(reportTimer, dispatch_time(DISPATCH_TIME_NOW, NXLoggerReportInterval), NXLoggerReportInterval, NXLoggerReportInterval / 10);
+        dispatch_resume(reportTimer);
+    });
+    
+    @synchronized(NXLoggerReportingInstances) {
+        [NXLoggerReportingInstances addObject:self];
+    }
+}
+
+- (NXLogTargetPlan *)_plan {
+    return [_planEpoch objectAtSlot:&_plan];
+}
+
+- (void)_observeTarget:(id<NXLogTarget>)target {
+    [(NSObject *)target addObserver:self forKeyPath:NSStringFromSelector(@selector(maxLogLevel)) options:0 context:NXLoggerTargetContext];
+    [(NSObject *)target addObserver:self forKeyPath:NSStringFromSelector(@selector(logFormatter)) options:0 context:NXLoggerTargetContext];
+}
+
+- (void)_unobserveTarget:(id<NXLogTarget>)target {
+    [(NSObject *)target removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxLogLevel)) context:NXLoggerTargetContext];
+    [(NSObject *)target removeObserver:self forKeyPath:NSStringFromSelector(@selector(logFormatter)) context:NXLoggerTargetContext];
+}
+
+- (NSArray<id<NXLogTarget>> *)_ownTargets {
+    @synchronized(_targets) {
+        return [_targets copy];
+    }
+}
+
+// Update the plan of the logger and of all registered loggers below it, which may inherit from it
+- (void)_updateHierarchy {
+    [self _updatePlan];
+    
+    for (NXLogger *descendant in [[NXLogRegistry sharedInstance] descendantsOfLoggerNamed:_name]) {
+        [descendant _updatePlan];
+    }
+}
+
+- (void)_updatePlan {
+    @synchronized(_targets) {
+        NSArray<id<NXLogTarget>> *targets = _targets;
+        NXLogLevel maxLogLevel = atomic_load_explicit(&_maxLogLevel, memory_order_relaxed);
+        
+        // Inherit what is not configured from the nearest ancestors configuring it. Locks are only
+        // nested from descendants to ancestors, so this cannot deadlock.
+        
+        NXLogRegistry *registry = [NXLogRegistry sharedInstance];
+        NXLogger *ancestor = self;
+        
+        while ((targets.count == 0 || maxLogLevel == NXLogLevelInherit) && (ancestor = [registry ancestorOfLoggerNamed:ancestor.name])) {
+            if (targets.count == 0) {
+                targets = [ancestor _ownTargets];
+            }
+            if (maxLogLevel == NXLogLevelInherit) {
+                maxLogLevel = ancestor.maxLogLevel;
+            }
+        }
+        
+        NXLogTargetPlan *plan = [[NXLogTargetPlan alloc] initWithTargets:targets];
+        NSSet<id<NXLogFormatter>> *formatters = plan.infoFormatters;
+        
+        // Keep track of changes to the info required by the formatters
+        
+        for (id<NXLogFormatter> formatter in _observedFormatters) {
+            if (![formatters containsObject:formatter]) {
+                [(NSObject *)formatter removeObserver:self forKeyPath:NSStringFromSelector(@selector(requiredInfo)) context:NXLoggerFormatterContext];
             }
-            
-            // Log the message to the target
-            
-            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
-                [target log:level message:message];
-            });
         }
+        for (id<NXLogFormatter> formatter in formatters) {
+            if (![_observedFormatters containsObject:formatter]) {
+                [(NSObject *)formatter addObserver:self forKeyPath:NSStringFromSelector(@selector(requiredInfo)) options:0 context:NXLoggerFormatterContext];
+            }
+        }
+        _observedFormatters = formatters;
+        
+        // Publish the new plan. The old one is released once no reader can be about to retain it.
+        
+        [_planEpoch replaceObjectAtSlot:&_plan withObject:plan];
+        
+        atomic_store_explicit(&_capturedInfo, plan.requiredInfo, memory_order_relaxed);
+        atomic_store_explicit(&_effectiveMaxLogLevel, maxLogLevel == NXLogLevelInherit ? plan.maxLogLevel : MIN(plan.maxLogLevel, maxLogLevel), memory_order_relaxed);
     }
 }
 
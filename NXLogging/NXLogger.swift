@@ -32,6 +32,38 @@
 
 import Foundation
 
+// MARK: - Compile-time level threshold
+
+/**
+ * The most verbose log level compiled into the log functions. Messages above it are dropped
+ * before the logger is even looked up. Choose it with a Swift compiler flag when building NXLogging,
+ * e.g. -DNX_LOG_COMPILE_MAX_LEVEL_NOTICE in "Other Swift Flags" of the Release configuration.
+ * Defaults to NXLogLevel.Any.
+ *
+ * The flag takes effect when NXLogging is compiled, not when the app is: Setting it in the app's
+ * target changes nothing. And as functions are not inlined across modules, the app still calls the
+ * log functions and keeps their messages in its binary, the threshold only saves evaluating them.
+ * To strip log statements from an app, wrap them in an #if on a flag of the app itself.
+ */
+#if NX_LOG_COMPILE_MAX_LEVEL_NONE
+public let NXLogCompileMaxLevel = NXLogLevel.None
+#elseif NX_LOG_COMPILE_MAX_LEVEL_ERROR
+public let NXLogCompileMaxLevel = NXLogLevel.Error
+#elseif NX_LOG_COMPILE_MAX_LEVEL_WARNING
+public let NXLogCompileMaxLevel = NXLogLevel.Warning
+#elseif NX_LOG_COMPILE_MAX_LEVEL_NOTICE
+public let NXLogCompileMaxLevel = NXLogLevel.Notice
+#elseif NX_LOG_COMPILE_MAX_LEVEL_INFO
+public let NXLogCompileMaxLevel = NXLogLevel.Info
+#else
+public let NXLogCompileMaxLevel = NXLogLevel.Any
+#endif
+
+/// True, if messages of the level are compiled in
+@inline(__always) private func isCompiledIn(level: NXLogLevel) -> Bool {
+    return level.rawValue <= NXLogCompileMaxLevel.rawValue
+}
+
 public extension NXLogger {
 
     // MARK: - Static convenience methods to log to a named logger
@@ -50,18 +82,46 @@ public extension NXLogger {
      * @param file The logging file (Usually omitted).
      * @param line The logging line number (Usually omitted).
      */
-    @nonobjc public class func log(level : NXLogLevel = NXLogLevel.Any, logger: String? = nil, error: ErrorType? = nil, exception: NSException? = nil, format: String? = nil, _ arguments: CVarArgType..., function: String = #function, file: String = #file, line: Int = #line, module : String? = nil) {
+    @nonobjc public class func log(level : NXLogLevel = NXLogLevel.Any, logger: String? = nil, error: ErrorType? = nil, exception: NSException? = nil, format: String? = nil, _ arguments: CVarArgType..., function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
         
         let level = NXLogger.levelFor(level, format: format, error : error, exception : exception)
+        
+        guard isCompiledIn(level) else {
+            return
+        }
+        
         let logger = logger == nil ? NXLogger.applicationLogger() : NXLogger(named: logger)
-        var info = [ NXLogInfo.Function.rawValue : function, NXLogInfo.File.rawValue : file, NXLogInfo.Line.rawValue : NSNumber(long: line) ]
-
-        if module != nil {
-            info.updateValue(module!, forKey: NXLogInfo.Module.rawValue)
+        
+        guard logger.isEnabledForLevel(level) else {
+            return
         }
         
-        withVaList(arguments) {
-            logger.log(level, info: info, error: error == nil ? nil : NSError(error!), exception: exception, format: format, arguments: $0)
+        withCallSite(function, file, line, module) { site in
+            withVaList(arguments) {
+                logger.log(level, site: site, error: error == nil ? nil : NSError(error!), exception: exception, format: format, arguments: $0)
+            }
+        }
+    }
+    
+    /// The same for function and file names, which are not literals. Their call sites cannot cache derived info.
+    @nonobjc public class func log(level : NXLogLevel = NXLogLevel.Any, logger: String? = nil, error: ErrorType? = nil, exception: NSException? = nil, format: String? = nil, _ arguments: CVarArgType..., function: String, file: String = #file, line: Int = #line, module : String? = nil) {
+        
+        let level = NXLogger.levelFor(level, format: format, error : error, exception : exception)
+        
+        guard isCompiledIn(level) else {
+            return
+        }
+        
+        let logger = logger == nil ? NXLogger.applicationLogger() : NXLogger(named: logger)
+        
+        guard logger.isEnabledForLevel(level) else {
+            return
+        }
+        
+        withCallSite(function, file, line, module) { site in
+            withVaList(arguments) {
+                logger.log(level, site: site, error: error == nil ? nil : NSError(error!), exception: exception, format: format, arguments: $0)
+            }
         }
     }
     
@@ -79,17 +139,34 @@ public extension NXLogger {
      * @param file The logging file (Usually omitted).
      * @param line The logging line number (Usually omitted).
      */
-    @nonobjc public func log(level : NXLogLevel = NXLogLevel.Any, error: ErrorType? = nil, exception: NSException? = nil, format: String? = nil, _ arguments: CVarArgType..., function: String = #function, file: String = #file, line: Int = #line, module : String? = nil) {
+    @nonobjc public func log(level : NXLogLevel = NXLogLevel.Any, error: ErrorType? = nil, exception: NSException? = nil, format: String? = nil, _ arguments: CVarArgType..., function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
         
         let level = NXLogger.levelFor(level, format: format, error : error, exception : exception)
-        var info = [ NXLogInfo.Function.rawValue : function, NXLogInfo.File.rawValue : file, NXLogInfo.Line.rawValue : NSNumber(long: line) ]
         
-        if module != nil {
-            info.updateValue(module!, forKey: NXLogInfo.Module.rawValue)
+        guard isCompiledIn(level) && isEnabledForLevel(level) else {
+            return
         }
-
-        withVaList(arguments) {
-            log(level, info: info, error: error == nil ? nil : NSError(error!), exception: exception, format: format, arguments: $0)
+        
+        withCallSite(function, file, line, module) { site in
+            withVaList(arguments) {
+                log(level, site: site, error: error == nil ? nil : NSError(error!), exception: exception, format: format, arguments: $0)
+            }
+        }
+    }
+    
+    /// The same for function and file names, which are not literals. Their call sites cannot cache derived info.
+    @nonobjc public func log(level : NXLogLevel = NXLogLevel.Any, error: ErrorType? = nil, exception: NSException? = nil, format: String? = nil, _ arguments: CVarArgType..., function: String, file: String = #file, line: Int = #line, module : String? = nil) {
+        
+        let level = NXLogger.levelFor(level, format: format, error : error, exception : exception)
+        
+        guard isCompiledIn(level) && isEnabledForLevel(level) else {
+            return
+        }
+        
+        withCallSite(function, file, line, module) { site in
+            withVaList(arguments) {
+                log(level, site: site, error: error == nil ? nil : NSError(error!), exception: exception, format: format, arguments: $0)
+            }
         }
     }
     
@@ -112,84 +189,345 @@ public extension NXLogger {
     }
 }
 
+// MARK: - Call site
+
+/**
+ * Call a closure with a call site for the given source code location
+ *
+ * @param function The logging function name. Must be a string literal such as #function.
+ * @param file The logging file. Must be a string literal such as #file.
+ * @param line The logging line number.
+ * @param module The module or nil.
+ * @param body The closure to call with the call site.
+ */
+private func withCallSite<Result>(function: StaticString, _ file: StaticString, _ line: Int, _ module: String?, @noescape _ body: UnsafeMutablePointer<NXLogCallSite> -> Result) -> Result {
+    return withCallSite(UnsafePointer<Int8>(function.utf8Start), UnsafePointer<Int8>(file.utf8Start), line, module, body)
+}
+
+/**
+ * Call a closure with a call site for the given source code location, whose names need not be literals
+ *
+ * @param function The logging function name.
+ * @param file The logging file.
+ * @param line The logging line number.
+ * @param module The module or nil.
+ * @param body The closure to call with the call site.
+ */
+private func withCallSite<Result>(function: String, _ file: String, _ line: Int, _ module: String?, @noescape _ body: UnsafeMutablePointer<NXLogCallSite> -> Result) -> Result {
+    return function.withCString { cFunction in
+        file.withCString { cFile in
+            withCallSite(cFunction, cFile, line, module, body)
+        }
+    }
+}
+
+private func withCallSite<Result>(function: UnsafePointer<Int8>, _ file: UnsafePointer<Int8>, _ line: Int, _ module: String?, @noescape _ body: UnsafeMutablePointer<NXLogCallSite> -> Result) -> Result {
+    
+    // The call site only lives as long as the call, so it must not cache derived info
+    
+    var site = NXLogCallSite()
+    
+    site.function = function
+    site.file = file
+    site.line = line
+    
+    if let module = module {
+        return module.withCString { cModule in
+            site.module = cModule
+            return withUnsafeMutablePointer(&site, body)
+        }
+    }
+    
+    return withUnsafeMutablePointer(&site, body)
+}
+
 // MARK: - Global methods for compatibility with the corresponding Objective-C macros
 
-public func NXLog(level : NXLogLevel, _ format: String?, _ arguments: CVarArgType..., function: String = #function, file: String = #file, line: Int = #line, module : String? = nil) {
+public func NXLog(level : NXLogLevel, _ format: String?, _ arguments: CVarArgType..., function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
     
-    var info = [ NXLogInfo.Function.rawValue : function, NXLogInfo.File.rawValue : file, NXLogInfo.Line.rawValue : NSNumber(long: line) ]
+    guard isCompiledIn(level) else {
+        return
+    }
     
-    if module != nil {
-        info.updateValue(module!, forKey: NXLogInfo.Module.rawValue)
+    let logger = NXLogger.applicationLogger()
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
     }
     
-    withVaList(arguments) {
-        NXLogger.applicationLogger().log(level, info: info, error: nil, exception: nil, format: format, arguments: $0)
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: nil, exception: nil, format: format, arguments: $0)
+        }
     }
 }
 
-public func NXLogError(level : NXLogLevel, _ error: ErrorType, _ format: String?, _ arguments: CVarArgType..., function: String = #function, file: String = #file, line: Int = #line, module : String? = nil) {
+/// The same for function and file names, which are not literals. Their call sites cannot cache derived info.
+public func NXLog(level : NXLogLevel, _ format: String?, _ arguments: CVarArgType..., function: String, file: String = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
     
-    var info = [ NXLogInfo.Function.rawValue : function, NXLogInfo.File.rawValue : file, NXLogInfo.Line.rawValue : NSNumber(long: line) ]
+    let logger = NXLogger.applicationLogger()
     
-    if module != nil {
-        info.updateValue(module!, forKey: NXLogInfo.Module.rawValue)
+    guard logger.isEnabledForLevel(level) else {
+        return
     }
     
-    withVaList(arguments) {
-        NXLogger.applicationLogger().log(level, info: info, error: NSError(error), exception: nil, format: format, arguments: $0)
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: nil, exception: nil, format: format, arguments: $0)
+        }
     }
 }
 
-public func NXLogException(level : NXLogLevel, _ exception: NSException, _ format: String?, _ arguments: CVarArgType..., function: String = #function, file: String = #file, line: Int = #line, module : String? = nil) {
+public func NXLogError(level : NXLogLevel, _ error: ErrorType, _ format: String?, _ arguments: CVarArgType..., function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
     
-    var info = [ NXLogInfo.Function.rawValue : function, NXLogInfo.File.rawValue : file, NXLogInfo.Line.rawValue : NSNumber(long: line) ]
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    let logger = NXLogger.applicationLogger()
     
-    if module != nil {
-        info.updateValue(module!, forKey: NXLogInfo.Module.rawValue)
+    guard logger.isEnabledForLevel(level) else {
+        return
     }
     
-    withVaList(arguments) {
-        NXLogger.applicationLogger().log(level, info: info, error: nil, exception: exception, format: format, arguments: $0)
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: NSError(error), exception: nil, format: format, arguments: $0)
+        }
     }
 }
 
-public func NXLogTo(logger : String, _ level : NXLogLevel, _ format: String?, _ arguments: CVarArgType..., function: String = #function, file: String = #file, line: Int = #line, module : String? = nil) {
+/// The same for function and file names, which are not literals. Their call sites cannot cache derived info.
+public func NXLogError(level : NXLogLevel, _ error: ErrorType, _ format: String?, _ arguments: CVarArgType..., function: String, file: String = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
     
-    var info = [ NXLogInfo.Function.rawValue : function, NXLogInfo.File.rawValue : file, NXLogInfo.Line.rawValue : NSNumber(long: line) ]
+    let logger = NXLogger.applicationLogger()
     
-    if module != nil {
-        info.updateValue(module!, forKey: NXLogInfo.Module.rawValue)
+    guard logger.isEnabledForLevel(level) else {
+        return
     }
     
-    withVaList(arguments) {
-        NXLogger(named: logger).log(level, info: info, error: nil, exception: nil, format: format, arguments: $0)
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: NSError(error), exception: nil, format: format, arguments: $0)
+        }
     }
 }
 
-public func NXLogErrorTo(logger : String, _ level : NXLogLevel, _ error: ErrorType, _ format: String?, _ arguments: CVarArgType..., function: String = #function, file: String = #file, line: Int = #line, module : String? = nil) {
+public func NXLogException(level : NXLogLevel, _ exception: NSException, _ format: String?, _ arguments: CVarArgType..., function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
     
-    var info = [ NXLogInfo.Function.rawValue : function, NXLogInfo.File.rawValue : file, NXLogInfo.Line.rawValue : NSNumber(long: line) ]
+    let logger = NXLogger.applicationLogger()
     
-    if module != nil {
-        info.updateValue(module!, forKey: NXLogInfo.Module.rawValue)
+    guard logger.isEnabledForLevel(level) else {
+        return
     }
     
-    withVaList(arguments) {
-        NXLogger(named: logger).log(level, info: info, error: NSError(error), exception: nil, format: format, arguments: $0)
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: nil, exception: exception, format: format, arguments: $0)
+        }
     }
 }
 
-public func NXLogExceptionTo(logger : String, _ level : NXLogLevel, _ exception: NSException, _ format: String?, _ arguments: CVarArgType..., function: String = #function, file: String = #file, line: Int = #line, module : String? = nil) {
+/// The same for function and file names, which are not literals. Their call sites cannot cache derived info.
+public func NXLogException(level : NXLogLevel, _ exception: NSException, _ format: String?, _ arguments: CVarArgType..., function: String, file: String = #file, line: Int = #line, module : String? = nil) {
     
-    var info = [ NXLogInfo.Function.rawValue : function, NXLogInfo.File.rawValue : file, NXLogInfo.Line.rawValue : NSNumber(long: line) ]
+    guard isCompiledIn(level) else {
+        return
+    }
     
-    if module != nil {
-        info.updateValue(module!, forKey: NXLogInfo.Module.rawValue)
+    let logger = NXLogger.applicationLogger()
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
     }
     
-    withVaList(arguments) {
-        NXLogger(named: logger).log(level, info: info, error: nil, exception: exception, format: format, arguments: $0)
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: nil, exception: exception, format: format, arguments: $0)
+        }
     }
 }
 
+public func NXLogTo(logger : String, _ level : NXLogLevel, _ format: String?, _ arguments: CVarArgType..., function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    let logger = NXLogger(named: logger)
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
+    }
+    
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: nil, exception: nil, format: format, arguments: $0)
+        }
+    }
+}
+
+/// The same for function and file names, which are not literals. Their call sites cannot cache derived info.
+public func NXLogTo(logger : String, _ level : NXLogLevel, _ format: String?, _ arguments: CVarArgType..., function: String, file: String = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    let logger = NXLogger(named: logger)
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
+    }
+    
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: nil, exception: nil, format: format, arguments: $0)
+        }
+    }
+}
+
+public func NXLogErrorTo(logger : String, _ level : NXLogLevel, _ error: ErrorType, _ format: String?, _ arguments: CVarArgType..., function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    let logger = NXLogger(named: logger)
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
+    }
+    
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: NSError(error), exception: nil, format: format, arguments: $0)
+        }
+    }
+}
+
+/// The same for function and file names, which are not literals. Their call sites cannot cache derived info.
+public func NXLogErrorTo(logger : String, _ level : NXLogLevel, _ error: ErrorType, _ format: String?, _ arguments: CVarArgType..., function: String, file: String = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    let logger = NXLogger(named: logger)
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
+    }
+    
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: NSError(error), exception: nil, format: format, arguments: $0)
+        }
+    }
+}
+
+public func NXLogExceptionTo(logger : String, _ level : NXLogLevel, _ exception: NSException, _ format: String?, _ arguments: CVarArgType..., function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    let logger = NXLogger(named: logger)
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
+    }
+    
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: nil, exception: exception, format: format, arguments: $0)
+        }
+    }
+}
+
+/// The same for function and file names, which are not literals. Their call sites cannot cache derived info.
+public func NXLogExceptionTo(logger : String, _ level : NXLogLevel, _ exception: NSException, _ format: String?, _ arguments: CVarArgType..., function: String, file: String = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    let logger = NXLogger(named: logger)
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
+    }
+    
+    withCallSite(function, file, line, module) { site in
+        withVaList(arguments) {
+            logger.log(level, site: site, error: nil, exception: exception, format: format, arguments: $0)
+        }
+    }
+}
+
+// MARK: - Global methods with a lazily evaluated message
+
+/**
+ * Log a message with the given log level using the application logger. The message is only
+ * evaluated if the level is compiled in (see NXLogCompileMaxLevel) and the logger accepts it,
+ * so string interpolation in the message costs nothing otherwise:
+ *
+ *     NXLogMessage(.Debug, "Cache hit for \(key) after \(elapsed) ms")
+ *
+ * @param level The log level.
+ * @param message The message.
+ */
+@inline(__always) public func NXLogMessage(level : NXLogLevel, @autoclosure _ message: () -> String, function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    logMessage(NXLogger.applicationLogger(), level, message, function, file, line, module)
+}
+
+/**
+ * Log a message with the given log level using the named logger. The message is only
+ * evaluated if the level is compiled in (see NXLogCompileMaxLevel) and the logger accepts it.
+ *
+ * @param logger The name of the logger.
+ * @param level The log level.
+ * @param message The message.
+ */
+@inline(__always) public func NXLogMessageTo(logger : String, _ level : NXLogLevel, @autoclosure _ message: () -> String, function: StaticString = #function, file: StaticString = #file, line: Int = #line, module : String? = nil) {
+    
+    guard isCompiledIn(level) else {
+        return
+    }
+    
+    logMessage(NXLogger(named: logger), level, message, function, file, line, module)
+}
 
+private func logMessage(logger: NXLogger, _ level: NXLogLevel, @noescape _ message: () -> String, _ function: StaticString, _ file: StaticString, _ line: Int, _ module: String?) {
+    
+    guard logger.isEnabledForLevel(level) else {
+        return
+    }
+    
+    // Pass the message as an argument, so percent signs in it are taken literally
+    
+    let text = message() as NSString
+    
+    withCallSite(function, file, line, module) { site in
+        withVaList([text]) {
+            logger.log(level, site: site, error: nil, exception: nil, format: "%@", arguments: $0)
+        }
+    }
+}
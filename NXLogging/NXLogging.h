@@ -47,9 +47,15 @@ FOUNDATION_EXPORT const unsigned char NXLoggingVersionString[];
 
 #import <NXLogging/NXLogger.h>
 #import <NXLogging/NXLogTypes.h>
+#import <NXLogging/NXLogPipeline.h>
+#import <NXLogging/NXLogRecord.h>
+#import <NXLogging/NXLogConfiguration.h>
 #import <NXLogging/NXSystemLogTarget.h>
+#import <NXLogging/NXLinuxSystemLogTarget.h>
 #import <NXLogging/NXConsoleLogTarget.h>
 #import <NXLogging/NXFileLogTarget.h>
+#import <NXLogging/NXNetworkLogTarget.h>
+#import <NXLogging/NXSpillLogTarget.h>
 #import <NXLogging/NXSystemLogFormatter.h>
 #import <NXLogging/NXDebugLogFormatter.h>
 #import <NXLogging/NXJSONLogFormatter.h>
@@ -32,6 +32,16 @@
 
 #import <Foundation/Foundation.h>
 
+/// The escape sequences used to color text
+typedef NS_ENUM(NSInteger, NXTextColorMode) {
+    /// The sequences of the XcodeColors plugin for the Xcode console
+    NXTextColorModeXcodeColors,
+    /// ANSI sequences selecting one of 256 colors, understood by most terminals
+    NXTextColorModeANSI256,
+    /// ANSI sequences with 24 bit RGB colors, understood by terminals supporting true color
+    NXTextColorModeANSI24Bit,
+};
+
 @interface NXTextColor : NSObject
 
 @property (nonatomic, readonly) float red;
@@ -44,6 +54,22 @@
 
 - (NSString *)colorizeText:(NSString *)text;
 
+/**
+ * The escape sequence switching to the color
+ *
+ * @param mode (input) The kind of escape sequence
+ * @result The escape sequence
+ */
+- (NSString *)escapeSequenceForMode:(NXTextColorMode)mode;
+
+/**
+ * The escape sequence switching back to the default color
+ *
+ * @param mode (input) The kind of escape sequence
+ * @result The escape sequence
+ */
++ (NSString *)resetSequenceForMode:(NXTextColorMode)mode;
+
 #pragma mark - Unavailable methods
 
 + (id)new NS_UNAVAILABLE;
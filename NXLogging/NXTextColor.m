@@ -32,6 +32,11 @@
 
 #import "NXTextColor.h"
 
+// Scale a color component in the range [0, 1] to [0, max]
+static int _NXColorComponent(float value, int max) {
+    return (int)lroundf(fminf(fmaxf(value, 0.f), 1.f) * max);
+}
+
 @implementation NXTextColor
 
 + (instancetype)colorWithRed:(float)red green:(float)green blue:(float)blue {
@@ -53,7 +58,23 @@
 }
 
 - (NSString *)colorizeText:(NSString *)text {
-    return [NSString stringWithFormat:@"\033[fg%@;%@\033[fg;", self, text];
+    return [NSString stringWithFormat:@"%@%@%@", [self escapeSequenceForMode:NXTextColorModeXcodeColors], text, [self.class resetSequenceForMode:NXTextColorModeXcodeColors]];
+}
+
+- (NSString *)escapeSequenceForMode:(NXTextColorMode)mode {
+    switch (mode) {
+        case NXTextColorModeANSI24Bit:
+            return [NSString stringWithFormat:@"\033[38;2;%d;%d;%dm", _NXColorComponent(_red, 255), _NXColorComponent(_green, 255), _NXColorComponent(_blue, 255)];
+        case NXTextColorModeANSI256:
+            // The 6x6x6 color cube of the 256 color palette
+            return [NSString stringWithFormat:@"\033[38;5;%dm", 16 + 36 * _NXColorComponent(_red, 5) + 6 * _NXColorComponent(_green, 5) + _NXColorComponent(_blue, 5)];
+        default:
+            return [NSString stringWithFormat:@"\033[fg%@;", self];
+    }
+}
+
++ (NSString *)resetSequenceForMode:(NXTextColorMode)mode {
+    return mode == NXTextColorModeXcodeColors ? @"\033[fg;" : @"\033[0m";
 }
 
 @end
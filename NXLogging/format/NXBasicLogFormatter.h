@@ -33,6 +33,13 @@
 #import <Foundation/Foundation.h>
 #import "NXLogFormatter.h"
 
+/// The pattern of NXBasicLogFormatter, e.g. "2016-02-22 17:27:33 Naxos iPad(iPad4,2 iPhone OS 9.2.1) Sample[4783] <Notice>: com.naxos-software.Sample[Module] -[Controller viewDidLoad](Controller.m:49) - Message"
+FOUNDATION_EXPORT NSString * const NXLogPatternBasic;
+/// The pattern equivalent to the info shown by NXDebugLogFormatter, e.g. "2016-02-22 17:27:33 <Notice>: com.naxos-software.Sample -[Controller viewDidLoad](Controller.m:49) - Message"
+FOUNDATION_EXPORT NSString * const NXLogPatternDebug;
+/// The pattern equivalent to the info shown by NXSystemLogFormatter, e.g. "com.naxos-software.Sample -[Controller viewDidLoad](Controller.m:49) - Message"
+FOUNDATION_EXPORT NSString * const NXLogPatternSystem;
+
 /**
  A basic configurable log formatter.
  Serves as a basis for most log formatters.
@@ -46,8 +53,37 @@
 @property (atomic) NSDateFormatter *dateFormatter;
 
 /// The bit mask representing the info to be excluded from the log message. Defaults to NXLogInfoNone.
+/// Hidden info is not captured by the logger, so it will not be substituted for variables in the message either.
 @property (atomic) NXLogInfo hiddenInfo;
 
+/// The bit mask representing the info included in the log message, i.e. the complement of hiddenInfo.
+@property (atomic, readonly) NXLogInfo requiredInfo;
+
+/**
+ * The pattern the log messages are rendered with. Defaults to NXLogPatternBasic.
+ * The pattern is compiled once, when it is set. Info hidden with hiddenInfo renders empty.
+ *
+ * Conversions (empty if the info is hidden or not available):
+ * %d date, %h device name, %M device model, %S system name, %V system version,
+ * %P process name, %i process id, %p level, %c logger name, %o module,
+ * %f function, %F file, %L line, %m message, %e error trace, %x exception trace.
+ *
+ * Other constructs:
+ * %% a percent sign, %n a newline,
+ * %{pattern} a group, which scopes separators,
+ * %sep{text} a separator: The text is appended before the next output of the group, unless the group has no output yet,
+ * %notEmpty{pattern} the pattern, if none of the conversions directly contained in it is empty,
+ * %ifAny{conversions}{pattern}{pattern} the first pattern, if any of the conversions is not empty, else the optional second one.
+ */
+@property (atomic, copy) NSString *pattern;
+
+/**
+ * If YES, variables like $(line) are replaced in the format string of a log statement, before its arguments
+ * are substituted, and the rendered message is not scanned for variables afterwards. Hence, argument text
+ * containing "$(" is taken literally. Defaults to NO, which replaces the variables in the rendered message.
+ */
+@property (atomic) BOOL expandsVariablesInFormat;
+
 /// The minimum log level from which to include call stack symbols, when logging exceptions. Defaults to NXLogLevelError.
 @property (atomic) NXLogLevel exceptionSymbolsThreshold;
 
@@ -82,4 +118,16 @@
  */
 - (BOOL)isHiddenInfo:(NXLogInfo)info;
 
+#pragma mark - Method to format dates
+/// @name Format dates
+
+/**
+ * Format a date with the date formatter. Common date formats are rendered
+ * without involving the date formatter, but with the identical result.
+ *
+ * @param date The date
+ * @return The formatted date
+ */
+- (NSString *)stringFromDate:(NSDate *)date;
+
 @end
@@ -33,6 +33,37 @@
 #import "NXBasicLogFormatter.h"
 #import "NSError+NXLogging.h"
 #import "NSException+NXLogging.h"
+#import "NXLogTimestampRenderer.h"
+#import "NXLogPatternLayout.h"
+
+// 1st part:
+// 2016-02-22 17:27:33 Naxos iPad #7(iPad4,2 iPhone OS 9.2.1) AirIDSample[4783] <Notice>:
+// date       time     device        model   system    sver   process     pid    level
+#define NX_LOG_PATTERN_DATE_DEVICE_PROCESS_LEVEL \
+    @"%{%d%sep{ }%h%ifAny{%M%S}{%ifAny{%h}{(}{%sep{ }}%{%M%sep{ }%notEmpty{%S%notEmpty{ %V}}}%ifAny{%h}{)}}%sep{ }%notEmpty{%P%notEmpty{[%i]}}%sep{ }%notEmpty{<%p>}}"
+#define NX_LOG_PATTERN_DATE_LEVEL \
+    @"%{%d%sep{ }%notEmpty{<%p>}}"
+
+// 2nd part:
+// com.naxos-software.AirIDSample [StartPageControl didEnterPage:ofDocument:](StartPageControl.m:49)
+// name                           function                                    file               line
+#define NX_LOG_PATTERN_LOCATION \
+    @"%{%c%ifAny{%c}{%notEmpty{[%o]}}{%o}%sep{ }%f%notEmpty{%ifAny{%c%f}{%sep{}(}{%sep{ }}%F%notEmpty{:%L}%ifAny{%c%f}{)}}}"
+
+// The message, error and exception following the info
+#define NX_LOG_PATTERN_CONTENT \
+    @"%sep{ - }%m%sep{%n}%e%sep{%n}%x"
+
+NSString * const NXLogPatternBasic = @"%{" NX_LOG_PATTERN_DATE_DEVICE_PROCESS_LEVEL @"%sep{: }" NX_LOG_PATTERN_LOCATION @"}" NX_LOG_PATTERN_CONTENT;
+NSString * const NXLogPatternDebug = @"%{" NX_LOG_PATTERN_DATE_LEVEL @"%sep{: }" NX_LOG_PATTERN_LOCATION @"}" NX_LOG_PATTERN_CONTENT;
+NSString * const NXLogPatternSystem = @"%{" NX_LOG_PATTERN_LOCATION @"}" NX_LOG_PATTERN_CONTENT;
+
+@interface NXBasicLogFormatter ()
+
+@property (atomic) NXLogTimestampRenderer *timestampRenderer;
+@property (atomic) NXLogPatternLayout *layout;
+
+@end
 
 @implementation NXBasicLogFormatter
 
@@ -52,6 +83,7 @@
         _dateFormatter = [NSDateFormatter new]; // Beware: Only thread-safe from iOS 7 upwards
         [_dateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
         _exceptionSymbolsThreshold = NXLogLevelError;
+        self.pattern = NXLogPatternBasic;
     }
     return self;
 }
@@ -60,53 +92,116 @@
 
 - (NSString *)messageForLogger:(NSString *)loggerName level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
     
-    NSMutableString *message = [NSMutableString new];
-    NSString *info = [self _logInfoString:loggerName level:level client:client];
+    NXLogInfo info = ~self.hiddenInfo;
+    NXLogPatternLayout *layout = self.layout;
+    
+    BOOL expandsFormat = self.expandsVariablesInFormat;
+    
+    // The arguments cannot be captured by the block
+    
     NSString *msg = nil;
-    NSError *err = [self isHiddenInfo:NXLogInfoError] ? nil : error;
-    NSException *exc = [self isHiddenInfo:NXLogInfoException] ? nil : exception;
     
-    if (![self isHiddenInfo:NXLogInfoMessage] && format.length) {
-        msg = [[NSString alloc] initWithFormat:format arguments:arguments];
-        if (msg.length && info.length) {
-            info = [info stringByAppendingString:@" - "];
-        }
-    }
-
-    if (info.length) {
-        [message appendString:info];
-    }
-    if (msg.length) {
-        [message appendString:msg];
+    if (info & layout.usedInfo & NXLogInfoMessage && format.length) {
+        msg = [[NSString alloc] initWithFormat:expandsFormat && client ? [client formatByReplacingVariablesInFormat:format] : format arguments:arguments];
     }
-    if (err) {
-        if (message.length) {
-            [message appendString:@"\n"];
+    
+    NSString *message = [layout renderWithValues:^id(NXLogPatternConversion conversion) {
+        
+        // The content, ...
+        
+        switch (conversion) {
+            case NXLogPatternConversionMessage:
+                return msg;
+            case NXLogPatternConversionError:
+                return info & NXLogInfoError ? error.logTrace : nil;
+            case NXLogPatternConversionException:
+                return info & NXLogInfoException ? [self _exceptionTrace:exception level:level] : nil;
+            default:
+                break;
         }
-        [message appendString:err.logTrace];
-    }
-    if (exc) {
-        if (message.length) {
-            [message appendString:@"\n"];
+        
+        // ... and the info about the client
+        
+        if (client == nil) {
+            return nil;
         }
-        BOOL includeSymbols = level <= _exceptionSymbolsThreshold;
-        [message appendString:[exc logTrace:includeSymbols]];
-        if (!includeSymbols) {
-            if (_exceptionSymbolsThreshold == NXLogLevelNone) {
-                [message appendFormat:@"\n   >> Enable call stack symbols with the exceptionSymbolsThreshold property of the log formatter <<"];
-            } else {
-                [message appendFormat:@"\n   >> Log with severity %@ or higher to enable call stack symbols <<", [self.class levelName:_exceptionSymbolsThreshold]];
-            }
+        
+        switch (conversion) {
+            case NXLogPatternConversionDate:
+                return info & NXLogInfoDate && client.date ? [self stringFromDate:client.date] : nil;
+            case NXLogPatternConversionDeviceName:
+                return info & NXLogInfoDeviceName ? client.deviceName : nil;
+            case NXLogPatternConversionDeviceModel:
+                return info & NXLogInfoDeviceModel ? client.deviceModel : nil;
+            case NXLogPatternConversionSystemName:
+                return info & NXLogInfoSystemName ? client.systemName : nil;
+            case NXLogPatternConversionSystemVersion:
+                return info & NXLogInfoSystemVersion ? client.systemVersion : nil;
+            case NXLogPatternConversionProcessName:
+                return info & NXLogInfoProcessName ? client.processName : nil;
+            case NXLogPatternConversionProcessID:
+                return info & NXLogInfoProcessID ? client.processID : nil;
+            case NXLogPatternConversionLevel:
+                return info & NXLogInfoLevel ? [self.class levelName:level] : nil;
+            case NXLogPatternConversionLoggerName:
+                return info & NXLogInfoLoggerName ? loggerName : nil;
+            case NXLogPatternConversionModule:
+                return info & NXLogInfoModule ? client.module : nil;
+            case NXLogPatternConversionFunction:
+                return info & NXLogInfoFunction ? client.methodName : nil;
+            case NXLogPatternConversionFile:
+                return info & NXLogInfoFile ? client.fileName : nil;
+            case NXLogPatternConversionLine:
+                return info & NXLogInfoLine ? client.line : nil;
+            default:
+                return nil;
         }
-    }
+    }];
     
-    return [client stringByReplacingVariablesInString:message];
+    return expandsFormat ? message : [client stringByReplacingVariablesInString:message];
+}
+
+- (NXLogRecord *)recordForLogger:(NSString *)loggerName level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
+    
+    id message = [self messageForLogger:loggerName level:level client:client error:error exception:exception format:format arguments:arguments];
+    
+    return [[NXLogRecord alloc] initWithMessage:message level:level client:client loggerName:loggerName];
+}
+
+- (NSString *)pattern {
+    return self.layout.pattern;
+}
+
+- (void)setPattern:(NSString *)pattern {
+    self.layout = [[NXLogPatternLayout alloc] initWithPattern:pattern];
 }
 
 - (BOOL)isHiddenInfo:(NXLogInfo)info {
     return _hiddenInfo & info;
 }
 
+- (NXLogInfo)requiredInfo {
+    return ~self.hiddenInfo;
+}
+
++ (NSSet<NSString *> *)keyPathsForValuesAffectingRequiredInfo {
+    return [NSSet setWithObject:NSStringFromSelector(@selector(hiddenInfo))];
+}
+
+- (NSString *)stringFromDate:(NSDate *)date {
+    NSDateFormatter *dateFormatter = self.dateFormatter;
+    NXLogTimestampRenderer *renderer = self.timestampRenderer;
+    
+    // The date formatter may have been replaced or changed in place
+    
+    if (![renderer isValidForDateFormatter:dateFormatter]) {
+        renderer = [[NXLogTimestampRenderer alloc] initWithDateFormatter:dateFormatter];
+        self.timestampRenderer = renderer;
+    }
+    
+    return [renderer stringFromDate:date];
+}
+
 + (NSString *)levelName:(NXLogLevel)level {
     switch (level) {
         case NXLogLevelEmergency:
@@ -132,146 +227,24 @@
 
 #pragma mark - Private methods
 
-// 1st part:
-// 2016-02-22 17:27:33 Naxos iPad #7(iPad4,2 iPhone OS 9.2.1) AirIDSample[4783] <Notice>:
-// date       time     device        model   system    sver   process     pid    level
-
-// 2nd part:
-// com.naxos-software.AirIDSample [StartPageControl didEnterPage:ofDocument:](StartPageControl.m:49)
-// name                           function                                    file               line
-
-- (NSString *)_logInfoString:(NSString *)loggerName level:(NXLogLevel)level client:(NXLogClientInfo *)client {
-    NSMutableString *infoString = [NSMutableString new];
+- (NSString *)_exceptionTrace:(NSException *)exception level:(NXLogLevel)level {
+    if (exception == nil) {
+        return nil;
+    }
     
-    if (client) {
-        NXLogInfo info = ~self.hiddenInfo;
-        
-        NSString *name = info & NXLogInfoLoggerName && loggerName.length ? loggerName : nil;
-        NSString *levelName = info & NXLogInfoLevel ? [self.class levelName:level] : nil;
-        NSDate *date = info & NXLogInfoDate && client.date ? client.date : nil;
-        NSString *device = info & NXLogInfoDeviceName && client.deviceName.length ? client.deviceName : nil;
-        NSString *model = info & NXLogInfoDeviceModel && client.deviceModel.length ? client.deviceModel : nil;
-        NSString *system = info & NXLogInfoSystemName && client.systemName.length ? client.systemName : nil;
-        NSString *systemVersion = info & NXLogInfoSystemVersion && client.systemVersion.length ? client.systemVersion : nil;
-        NSString *process = info & NXLogInfoProcessName && client.processName.length ? client.processName : nil;
-        NSNumber *pid = info & NXLogInfoProcessID && client.processID ? client.processID : nil;
-        NSString *function = info & NXLogInfoFunction && client.function.length ? client.function : nil;
-        NSString *file = info & NXLogInfoFile && client.file.length ? client.file : nil;
-        NSNumber *line = info & NXLogInfoLine && client.line ? client.line : nil;
-        NSString *module = info & NXLogInfoModule && client.module.length ? client.module : nil;
-        
-        // 1st part
-        
-        if (date) {
-            NSString *d = [self.dateFormatter stringFromDate:date];
-            [infoString appendString:d];
-        }
-        
-        if (device) {
-            if (infoString.length) {
-                [infoString appendString:@" "];
-            }
-            [infoString appendFormat:@"%@", device];
-        }
-
-        if (model || system) {
-            if (device) {
-                [infoString appendString:@"("];
-            } else if (infoString.length) {
-                [infoString appendString:@" "];
-            }
-            if (model) {
-                [infoString appendString:model];
-            }
-            if (system) {
-                if (model) {
-                    [infoString appendString:@" "];
-                }
-                [infoString appendString:system];
-                if (systemVersion) {
-                    [infoString appendString:@" "];
-                    [infoString appendString:systemVersion];
-                }
-            }
-            if (device) {
-                [infoString appendString:@")"];
-            }
-        }
-        
-        if (process) {
-            if (infoString.length) {
-                [infoString appendString:@" "];
-            }
-            [infoString appendFormat:@"%@", process];
-            if (pid) {
-                [infoString appendFormat:@"[%@]", pid];
-            }
-        }
-                
-        if (levelName) {
-            if (infoString.length) {
-                [infoString appendString:@" "];
-            }
-            [infoString appendFormat:@"<%@>", levelName];
-        }
-
-        // 2nd part
-
-        NSMutableString *infoString2 = [NSMutableString new];
-        
-        if (name) {
-            [infoString2 appendString:loggerName];
-        }
-        
-        if (module) {
-            if (name) {
-                [infoString2 appendString:@"["];
-            }
-            [infoString2 appendString:module];
-            if (name) {
-                [infoString2 appendString:@"]"];
-            }
-        }
-        
-        if (function) {
-            if (infoString2.length) {
-                [infoString2 appendString:@" "];
-            }
-            NSArray *comps = [function componentsSeparatedByCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"[]"]];
-            
-            if (comps.count >= 2) {
-                function = [NSString stringWithFormat:@"[%@]", [comps objectAtIndex:1]];
-            }
-            
-            [infoString2 appendFormat:@"%@", function];
-        }
-        
-        if (file) {
-            if (function || name) {
-                [infoString2 appendString:@"("];
-            } else if (infoString2.length) {
-                [infoString2 appendString:@" "];
-            }
-
-            [infoString2 appendString:file.lastPathComponent];
-            if (line) {
-                [infoString2 appendFormat:@":%@", line];
-            }
-            if (function || name) {
-                [infoString2 appendString:@")"];
-            }
-        }
-        
-        // Concatenate 1st and 2nd part
-        
-        if (infoString.length && infoString2.length) {
-            [infoString appendString:@": "];
+    NSMutableString *trace = [NSMutableString new];
+    BOOL includeSymbols = level <= _exceptionSymbolsThreshold;
+    
+    [trace appendString:[exception logTrace:includeSymbols]];
+    if (!includeSymbols) {
+        if (_exceptionSymbolsThreshold == NXLogLevelNone) {
+            [trace appendFormat:@"\n   >> Enable call stack symbols with the exceptionSymbolsThreshold property of the log formatter <<"];
+        } else {
+            [trace appendFormat:@"\n   >> Log with severity %@ or higher to enable call stack symbols <<", [self.class levelName:_exceptionSymbolsThreshold]];
         }
-
-        [infoString appendString:infoString2];
     }
     
-    return infoString;
+    return trace;
 }
 
 @end
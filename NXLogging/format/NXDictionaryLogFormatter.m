@@ -72,14 +72,14 @@
         dict[@"exception"] = [self _dictionaryFromException:exception];
     if (info & NXLogInfoFunction && client.function.length)
         dict[@"function"] = client.function;
-    if (info & NXLogInfoFile && client.file.length)
-        dict[@"file"] = client.file.lastPathComponent;
+    if (info & NXLogInfoFile && client.fileName.length)
+        dict[@"file"] = client.fileName;
     if (info & NXLogInfoLine && client.line)
         dict[@"line"] = client.line;
     if (info & NXLogInfoModule && client.module.length)
         dict[@"module"] = client.module;
     if (info & NXLogInfoDate && client.date)
-        dict[@"date"] = [self.dateFormatter stringFromDate:client.date];
+        dict[@"date"] = [self stringFromDate:client.date];
     if (info & NXLogInfoProcessName && client.processName.length)
         dict[@"processName"] = client.processName;
     if (info & NXLogInfoProcessID && client.processID)
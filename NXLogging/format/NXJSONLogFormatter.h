@@ -35,13 +35,17 @@
 
 /**
  * A JSON log formatter.
+ * Unless prettyPrint is set, each log entry is rendered as a single line of JSON with a fixed key order.
+ * It is written directly into a UTF-8 buffer, which is reused by the thread, without building a dictionary
+ * first. Nested errors and exceptions are written the same way. Strings are scanned for characters
+ * needing escapes 16 or 32 bytes at a time, where the CPU supports it.
  */
 @interface NXJSONLogFormatter : NXDictionaryLogFormatter
 
 /// @name Properties
 
 /**
- * YES for pretty JSON output. Defaults to NO.
+ * YES for pretty JSON output, which is rendered via the dictionary of NXDictionaryLogFormatter. Defaults to NO.
  */
 @property (atomic) BOOL prettyPrint;
 
@@ -31,6 +31,319 @@
 // -----------------------------------------------------------------------------
 
 #import "NXJSONLogFormatter.h"
+#import "NSException+NXLogging.h"
+#import <pthread.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#import <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
+/// A growable UTF-8 byte buffer
+typedef struct _NXJSONBuffer {
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+} NXJSONBuffer;
+
+/// The buffers a thread encodes its records with: the record itself and a scratch buffer for string conversions
+typedef struct _NXJSONWriter {
+    NXJSONBuffer record;
+    NXJSONBuffer scratch;
+} NXJSONWriter;
+
+static pthread_key_t NXJSONWriterKey;
+
+static void _NXJSONFreeWriter(void *ptr) {
+    NXJSONWriter *writer = ptr;
+    
+    free(writer->record.bytes);
+    free(writer->scratch.bytes);
+    free(writer);
+}
+
+// Take the writer of the current thread. A nested call on the same thread gets a writer of its own.
+static NXJSONWriter *_NXJSONTakeWriter(void) {
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        pthread_key_create(&NXJSONWriterKey, _NXJSONFreeWriter);
+    });
+    
+    NXJSONWriter *writer = pthread_getspecific(NXJSONWriterKey);
+    
+    if (writer) {
+        pthread_setspecific(NXJSONWriterKey, NULL);
+    } else {
+        writer = calloc(1, sizeof(NXJSONWriter));
+    }
+    
+    writer->record.length = 0;
+    
+    return writer;
+}
+
+// Give the writer back to the current thread for reuse
+static void _NXJSONReturnWriter(NXJSONWriter *writer) {
+    if (pthread_getspecific(NXJSONWriterKey)) {
+        _NXJSONFreeWriter(writer);
+    } else {
+        pthread_setspecific(NXJSONWriterKey, writer);
+    }
+}
+
+static inline void _NXJSONReserve(NXJSONBuffer *buffer, size_t length) {
+    if (buffer->length + length > buffer->capacity) {
+        size_t capacity = MAX(buffer->capacity * 2, MAX(buffer->length + length, (size_t)1024));
+        uint8_t *bytes = realloc(buffer->bytes, capacity);
+        
+        if (bytes == NULL) {
+            [NSException raise:NSMallocException format:@"Unable to grow the JSON buffer to %zu bytes", capacity];
+        }
+        
+        buffer->bytes = bytes;
+        buffer->capacity = capacity;
+    }
+}
+
+static inline void _NXJSONAppend(NXJSONBuffer *buffer, const void *bytes, size_t length) {
+    _NXJSONReserve(buffer, length);
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+static inline void _NXJSONAppendByte(NXJSONBuffer *buffer, uint8_t byte) {
+    _NXJSONReserve(buffer, 1);
+    buffer->bytes[buffer->length++] = byte;
+}
+
+// Find the first byte that needs to be escaped in a JSON string: a quote, a backslash or a control character
+static size_t _NXJSONScan(const uint8_t *bytes, size_t length) {
+    size_t i = 0;
+    
+#if defined(__AVX2__)
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+    
+    for (; i + 32 <= length; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(bytes + i));
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                                          _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+        
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i quote16 = _mm_set1_epi8('"');
+    const __m128i backslash16 = _mm_set1_epi8('\\');
+    const __m128i control16 = _mm_set1_epi8(0x1f);
+    
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote16), _mm_cmpeq_epi8(chunk, backslash16)),
+                                       _mm_cmpeq_epi8(_mm_max_epu8(chunk, control16), control16));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+        
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t quote16 = vdupq_n_u8('"');
+    const uint8x16_t backslash16 = vdupq_n_u8('\\');
+    const uint8x16_t control16 = vdupq_n_u8(0x1f);
+    
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t chunk = vld1q_u8(bytes + i);
+        uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote16), vceqq_u8(chunk, backslash16)), vcleq_u8(chunk, control16));
+        
+        if (vmaxvq_u8(special)) {
+            break; // The scalar loop below finds the byte within this chunk
+        }
+    }
+#endif
+    
+    for (; i < length; i++) {
+        uint8_t c = bytes[i];
+        
+        if (c == '"' || c == '\\' || c < 0x20) {
+            return i;
+        }
+    }
+    
+    return length;
+}
+
+static void _NXJSONAppendEscaped(NXJSONBuffer *buffer, const uint8_t *bytes, size_t length) {
+    static const char hex[] = "0123456789abcdef";
+    
+    _NXJSONReserve(buffer, length + 2);
+    buffer->bytes[buffer->length++] = '"';
+    
+    while (length) {
+        
+        // Copy the run of bytes that can be taken as they are ...
+        
+        size_t run = _NXJSONScan(bytes, length);
+        
+        _NXJSONAppend(buffer, bytes, run);
+        
+        if (run == length) {
+            break;
+        }
+        
+        // ... and escape the byte that ends it
+        
+        uint8_t c = bytes[run];
+        char escape[6] = { '\\', 0 };
+        size_t escapeLength = 2;
+        
+        switch (c) {
+            case '"':  escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            default:
+                memcpy(escape, "\\u00", 4);
+                escape[4] = hex[c >> 4];
+                escape[5] = hex[c & 0xf];
+                escapeLength = 6;
+                break;
+        }
+        
+        _NXJSONAppend(buffer, escape, escapeLength);
+        
+        bytes += run + 1;
+        length -= run + 1;
+    }
+    
+    _NXJSONAppendByte(buffer, '"');
+}
+
+static void _NXJSONAppendString(NXJSONWriter *writer, NSString *string) {
+    const char *utf8 = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    
+    if (utf8) {
+        _NXJSONAppendEscaped(&writer->record, (const uint8_t *)utf8, strlen(utf8));
+        return;
+    }
+    
+    // Convert the string into the scratch buffer, as the escaped string is not known to be shorter
+    
+    NSUInteger maxLength = [string maxLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger usedLength = 0;
+    
+    writer->scratch.length = 0;
+    _NXJSONReserve(&writer->scratch, maxLength);
+    
+    [string getBytes:writer->scratch.bytes
+           maxLength:maxLength
+          usedLength:&usedLength
+            encoding:NSUTF8StringEncoding
+             options:NSStringEncodingConversionAllowLossy
+               range:NSMakeRange(0, string.length)
+      remainingRange:NULL];
+    
+    _NXJSONAppendEscaped(&writer->record, writer->scratch.bytes, usedLength);
+}
+
+static void _NXJSONAppendInteger(NXJSONBuffer *buffer, long long value) {
+    char digits[24];
+    int length = snprintf(digits, sizeof(digits), "%lld", value);
+    
+    _NXJSONAppend(buffer, digits, (size_t)MAX(length, 0));
+}
+
+// Append a key, preceded by a comma unless it is the first one of its object
+static void _NXJSONAppendKey(NXJSONBuffer *buffer, const char *key, BOOL *first) {
+    size_t length = strlen(key);
+    
+    _NXJSONReserve(buffer, length + 4);
+    if (!*first) {
+        buffer->bytes[buffer->length++] = ',';
+    }
+    buffer->bytes[buffer->length++] = '"';
+    memcpy(buffer->bytes + buffer->length, key, length);
+    buffer->length += length;
+    buffer->bytes[buffer->length++] = '"';
+    buffer->bytes[buffer->length++] = ':';
+    *first = NO;
+}
+
+static void _NXJSONAppendStringMember(NXJSONWriter *writer, const char *key, NSString *value, BOOL *first) {
+    _NXJSONAppendKey(&writer->record, key, first);
+    _NXJSONAppendString(writer, value);
+}
+
+static void _NXJSONAppendIntegerMember(NXJSONWriter *writer, const char *key, long long value, BOOL *first) {
+    _NXJSONAppendKey(&writer->record, key, first);
+    _NXJSONAppendInteger(&writer->record, value);
+}
+
+static void _NXJSONAppendError(NXJSONWriter *writer, NSError *error) {
+    NSString *desc = error.localizedDescription;
+    NSString *reason = error.userInfo[NSLocalizedFailureReasonErrorKey];
+    NSString *suggestion = error.userInfo[NSLocalizedRecoverySuggestionErrorKey];
+    NSString *domain = error.domain;
+    NSError *underlyingError = error.userInfo[NSUnderlyingErrorKey];
+    BOOL first = YES;
+    
+    _NXJSONAppendByte(&writer->record, '{');
+    _NXJSONAppendIntegerMember(writer, "code", error.code, &first);
+    if (domain.length)
+        _NXJSONAppendStringMember(writer, "domain", domain, &first);
+    if (desc.length)
+        _NXJSONAppendStringMember(writer, "description", desc, &first);
+    if ([reason isKindOfClass:NSString.class] && reason.length)
+        _NXJSONAppendStringMember(writer, "reason", reason, &first);
+    if ([suggestion isKindOfClass:NSString.class] && suggestion.length)
+        _NXJSONAppendStringMember(writer, "suggestion", suggestion, &first);
+    if ([underlyingError isKindOfClass:NSError.class]) {
+        _NXJSONAppendKey(&writer->record, "underlyingError", &first);
+        _NXJSONAppendError(writer, underlyingError);
+    }
+    _NXJSONAppendByte(&writer->record, '}');
+}
+
+static void _NXJSONAppendException(NXJSONWriter *writer, NSException *exception) {
+    NSString *name = exception.name;
+    NSString *reason = exception.reason;
+    NSException *cause = exception.cause;
+    NSArray<NSString *> *stackSymbols = exception.callStackSymbols;
+    BOOL first = YES;
+    
+    _NXJSONAppendByte(&writer->record, '{');
+    if (name.length)
+        _NXJSONAppendStringMember(writer, "name", name, &first);
+    if (reason.length)
+        _NXJSONAppendStringMember(writer, "reason", reason, &first);
+    if (stackSymbols) {
+        BOOL firstSymbol = YES;
+        
+        _NXJSONAppendKey(&writer->record, "symbols", &first);
+        _NXJSONAppendByte(&writer->record, '[');
+        for (NSString *symbol in stackSymbols) {
+            if (!firstSymbol) {
+                _NXJSONAppendByte(&writer->record, ',');
+            }
+            _NXJSONAppendString(writer, symbol);
+            firstSymbol = NO;
+        }
+        _NXJSONAppendByte(&writer->record, ']');
+    }
+    if (cause) {
+        _NXJSONAppendKey(&writer->record, "cause", &first);
+        _NXJSONAppendException(writer, cause);
+    }
+    _NXJSONAppendByte(&writer->record, '}');
+}
 
 @implementation NXJSONLogFormatter
 
@@ -46,10 +359,14 @@
 
 - (NSString *)messageForLogger:(NSString *)loggerName level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
     
+    if (!_prettyPrint) {
+        return [[self _lineForLogger:loggerName level:level client:client error:error exception:exception format:format arguments:arguments] message];
+    }
+    
     NSDictionary *dict = [super messageForLogger:loggerName level:level client:client error:error exception:exception format:format arguments:arguments];
 
     NSData *jsonData = [NSJSONSerialization dataWithJSONObject:dict
-                                                       options:_prettyPrint ? NSJSONWritingPrettyPrinted : 0
+                                                       options:NSJSONWritingPrettyPrinted
                                                          error:nil];
     
     if (jsonData) {
@@ -59,4 +376,89 @@
     }
 }
 
+- (NXLogRecord *)recordForLogger:(NSString *)loggerName level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
+    
+    if (!_prettyPrint) {
+        return [self _lineForLogger:loggerName level:level client:client error:error exception:exception format:format arguments:arguments];
+    }
+    
+    return [super recordForLogger:loggerName level:level client:client error:error exception:exception format:format arguments:arguments];
+}
+
+#pragma mark - Private methods
+
+- (NXLogRecord *)_lineForLogger:(NSString *)loggerName level:(NXLogLevel)level client:(NXLogClientInfo *)client error:(NSError *)error exception:(NSException *)exception format:(NSString *)format arguments:(va_list)arguments {
+    
+    NSString *levelName = [self.class levelName:level];
+    NXLogInfo info = ~self.hiddenInfo;
+    
+    // Render everything that may call back into logging before the writer is taken
+    
+    NSString *message = info & NXLogInfoMessage && format.length ? [[NSString alloc] initWithFormat:format arguments:arguments] : nil;
+    NSString *date = info & NXLogInfoDate && client.date ? [self stringFromDate:client.date] : nil;
+    
+    NXJSONWriter *writer = _NXJSONTakeWriter();
+    char *line = NULL;
+    NSUInteger length = 0;
+    BOOL first = YES;
+    
+    @try {
+        _NXJSONAppendByte(&writer->record, '{');
+        if (date.length)
+            _NXJSONAppendStringMember(writer, "date", date, &first);
+        if (info & NXLogInfoLevel && levelName.length)
+            _NXJSONAppendStringMember(writer, "logLevel", levelName, &first);
+        if (info & NXLogInfoLoggerName && loggerName.length)
+            _NXJSONAppendStringMember(writer, "loggerName", loggerName, &first);
+        if (message.length)
+            _NXJSONAppendStringMember(writer, "message", message, &first);
+        if (info & NXLogInfoError && error) {
+            _NXJSONAppendKey(&writer->record, "error", &first);
+            _NXJSONAppendError(writer, error);
+        }
+        if (info & NXLogInfoException && exception) {
+            _NXJSONAppendKey(&writer->record, "exception", &first);
+            _NXJSONAppendException(writer, exception);
+        }
+        if (info & NXLogInfoFunction && client.function.length)
+            _NXJSONAppendStringMember(writer, "function", client.function, &first);
+        if (info & NXLogInfoFile && client.fileName.length)
+            _NXJSONAppendStringMember(writer, "file", client.fileName, &first);
+        if (info & NXLogInfoLine && client.line)
+            _NXJSONAppendIntegerMember(writer, "line", client.line.longLongValue, &first);
+        if (info & NXLogInfoModule && client.module.length)
+            _NXJSONAppendStringMember(writer, "module", client.module, &first);
+        if (info & NXLogInfoProcessName && client.processName.length)
+            _NXJSONAppendStringMember(writer, "processName", client.processName, &first);
+        if (info & NXLogInfoProcessID && client.processID)
+            _NXJSONAppendIntegerMember(writer, "processID", client.processID.longLongValue, &first);
+        if (info & NXLogInfoDeviceName && client.deviceName.length)
+            _NXJSONAppendStringMember(writer, "deviceName", client.deviceName, &first);
+        if (info & NXLogInfoDeviceModel && client.deviceModel.length)
+            _NXJSONAppendStringMember(writer, "deviceModel", client.deviceModel, &first);
+        if (info & NXLogInfoSystemName && client.systemName.length)
+            _NXJSONAppendStringMember(writer, "systemName", client.systemName, &first);
+        if (info & NXLogInfoSystemVersion && client.systemVersion.length)
+            _NXJSONAppendStringMember(writer, "systemVersion", client.systemVersion, &first);
+        _NXJSONAppendByte(&writer->record, '}');
+        
+        // Hand a copy of exactly the record's size to the record, and keep the buffer for the next one
+        
+        length = writer->record.length;
+        line = malloc(length);
+        if (line) {
+            memcpy(line, writer->record.bytes, length);
+        }
+    }
+    @finally {
+        _NXJSONReturnWriter(writer);
+    }
+    
+    if (line == NULL) {
+        return [[NXLogRecord alloc] initWithMessage:@"{ \"error\" : \"unable to serialize this message to JSON\" }" level:level client:client loggerName:loggerName];
+    }
+    
+    return [[NXLogRecord alloc] initWithBytesNoCopy:line length:length level:level client:client loggerName:loggerName];
+}
+
 @end
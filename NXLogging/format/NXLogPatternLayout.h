@@ -0,0 +1,100 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTypes.h"
+
+/// The values a pattern can refer to
+typedef NS_ENUM(NSUInteger, NXLogPatternConversion) {
+    NXLogPatternConversionDate,          // %d
+    NXLogPatternConversionDeviceName,    // %h
+    NXLogPatternConversionDeviceModel,   // %M
+    NXLogPatternConversionSystemName,    // %S
+    NXLogPatternConversionSystemVersion, // %V
+    NXLogPatternConversionProcessName,   // %P
+    NXLogPatternConversionProcessID,     // %i
+    NXLogPatternConversionLevel,         // %p
+    NXLogPatternConversionLoggerName,    // %c
+    NXLogPatternConversionModule,        // %o
+    NXLogPatternConversionFunction,      // %f
+    NXLogPatternConversionFile,          // %F
+    NXLogPatternConversionLine,          // %L
+    NXLogPatternConversionMessage,       // %m
+    NXLogPatternConversionError,         // %e
+    NXLogPatternConversionException,     // %x
+    NXLogPatternConversionCount
+};
+
+/**
+ * Provides the value of a conversion: A string, a number or nil.
+ * Called at most once per conversion and rendering.
+ */
+typedef id (^NXLogPatternValues)(NXLogPatternConversion conversion);
+
+/**
+ * A pattern compiled into a flat program, which renders log messages
+ * into a UTF-8 buffer. See -[NXBasicLogFormatter pattern] for the syntax.
+ */
+@interface NXLogPatternLayout : NSObject
+
+#pragma mark - Properties
+
+/// The pattern
+@property (nonatomic, readonly) NSString *pattern;
+/// The info the pattern refers to
+@property (nonatomic, readonly) NXLogInfo usedInfo;
+
+#pragma mark - Designated initializer
+
+/**
+ * Compile a pattern. Raises an NSInvalidArgumentException if the pattern is malformed.
+ *
+ * @param pattern (input) The pattern
+ */
+- (instancetype)initWithPattern:(NSString *)pattern NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Rendering
+
+/**
+ * Render the pattern
+ *
+ * @param values (input) Provides the values of the conversions
+ * @result The rendered string
+ */
+- (NSString *)renderWithValues:(NXLogPatternValues)values;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
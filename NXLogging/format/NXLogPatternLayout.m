@@ -0,0 +1,431 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogPatternLayout.h"
+
+// The maximum nesting of groups
+#define NXLogPatternMaxDepth 16
+
+typedef NS_ENUM(uint8_t, NXLogPatternOpcode) {
+    NXLogPatternOpcodeLiteral,    // Append a literal
+    NXLogPatternOpcodeConversion, // Append a value
+    NXLogPatternOpcodeGroupBegin, // Open a scope for separators
+    NXLogPatternOpcodeGroupEnd,   // Close the scope
+    NXLogPatternOpcodeSeparator,  // Append a literal before the next output, if the group has output already
+    NXLogPatternOpcodeTestAll,    // Jump, unless all values of the mask are non-empty
+    NXLogPatternOpcodeTestAny,    // Jump, unless any value of the mask is non-empty
+    NXLogPatternOpcodeJump,       // Jump
+};
+
+typedef struct _NXLogPatternOp {
+    NXLogPatternOpcode opcode;
+    uint32_t mask;      // The conversions to test
+    NSUInteger operand; // The conversion or the jump target
+    NSUInteger offset;  // The offset of the literal
+    NSUInteger length;  // The length of the literal
+} NXLogPatternOp;
+
+typedef struct _NXLogPatternGroup {
+    BOOL hasOutput;
+    BOOL pending;
+    NSUInteger offset; // The separator literal
+    NSUInteger length;
+} NXLogPatternGroup;
+
+typedef struct _NXLogPatternBuffer {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+    char storage[512];
+} NXLogPatternBuffer;
+
+static NXLogInfo NXLogPatternConversionInfo[NXLogPatternConversionCount] = {
+    NXLogInfoDate, NXLogInfoDeviceName, NXLogInfoDeviceModel, NXLogInfoSystemName, NXLogInfoSystemVersion,
+    NXLogInfoProcessName, NXLogInfoProcessID, NXLogInfoLevel, NXLogInfoLoggerName, NXLogInfoModule,
+    NXLogInfoFunction, NXLogInfoFile, NXLogInfoLine, NXLogInfoMessage, NXLogInfoError, NXLogInfoException
+};
+
+static void _NXLogPatternAppend(NXLogPatternBuffer *buffer, const char *bytes, size_t length) {
+    if (buffer->length + length > buffer->capacity) {
+        size_t capacity = MAX(buffer->capacity * 2, buffer->length + length);
+        
+        if (buffer->bytes == buffer->storage) {
+            buffer->bytes = malloc(capacity);
+            memcpy(buffer->bytes, buffer->storage, buffer->length);
+        } else {
+            buffer->bytes = reallocf(buffer->bytes, capacity);
+        }
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+// Append output, preceded by the pending separators of the groups that have output already
+static void _NXLogPatternEmit(NXLogPatternBuffer *buffer, NXLogPatternGroup *groups, NSUInteger depth, const char *literals, const char *bytes, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    
+    for (NSUInteger i = 0; i <= depth; i++) {
+        if (groups[i].pending) {
+            if (groups[i].hasOutput) {
+                _NXLogPatternAppend(buffer, literals + groups[i].offset, groups[i].length);
+            }
+            groups[i].pending = NO;
+        }
+    }
+    
+    _NXLogPatternAppend(buffer, bytes, length);
+    
+    for (NSUInteger i = 0; i <= depth; i++) {
+        groups[i].hasOutput = YES;
+    }
+}
+
+// Get a value, asking the provider only once
+static id _NXLogPatternValue(NXLogPatternValues values, __strong id *cache, uint32_t *computed, NSUInteger conversion) {
+    if (!(*computed & (1 << conversion))) {
+        cache[conversion] = values(conversion);
+        *computed |= 1 << conversion;
+    }
+    
+    id value = cache[conversion];
+    
+    return [value isKindOfClass:NSString.class] && [value length] == 0 ? nil : value;
+}
+
+@implementation NXLogPatternLayout {
+    NXLogPatternOp *_ops;
+    NSUInteger _opCount;
+    NSUInteger _opCapacity;
+    NSMutableData *_literals;
+}
+
+#pragma mark - Designated initializer
+
+- (instancetype)initWithPattern:(NSString *)pattern {
+    self = [super init];
+    if (self) {
+        _pattern = [pattern copy];
+        _literals = [NSMutableData new];
+        
+        NSUInteger length = _pattern.length;
+        unichar *chars = malloc(MAX(length, 1) * sizeof(unichar));
+        NSUInteger index = 0;
+        
+        [_pattern getCharacters:chars range:NSMakeRange(0, length)];
+        
+        @try {
+            [self _compileCharacters:chars length:length index:&index depth:0 closing:NO mask:NULL];
+        } @finally {
+            free(chars);
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_ops);
+}
+
+#pragma mark - Rendering
+
+- (NSString *)renderWithValues:(NXLogPatternValues)values {
+    __strong id cache[NXLogPatternConversionCount];
+    uint32_t computed = 0;
+    NXLogPatternGroup groups[NXLogPatternMaxDepth + 1];
+    NSUInteger depth = 0;
+    NXLogPatternBuffer buffer;
+    const char *literals = _literals.bytes;
+    
+    buffer.bytes = buffer.storage;
+    buffer.length = 0;
+    buffer.capacity = sizeof(buffer.storage);
+    groups[0] = (NXLogPatternGroup){ NO, NO, 0, 0 };
+    
+    for (NSUInteger pc = 0; pc < _opCount;) {
+        const NXLogPatternOp *op = &_ops[pc++];
+        
+        switch (op->opcode) {
+            case NXLogPatternOpcodeLiteral:
+                _NXLogPatternEmit(&buffer, groups, depth, literals, literals + op->offset, op->length);
+                break;
+                
+            case NXLogPatternOpcodeConversion: {
+                id value = _NXLogPatternValue(values, cache, &computed, op->operand);
+                
+                if ([value isKindOfClass:NSNumber.class]) {
+                    char number[24];
+                    int length = snprintf(number, sizeof(number), "%lld", [value longLongValue]);
+                    
+                    _NXLogPatternEmit(&buffer, groups, depth, literals, number, length);
+                } else if (value) {
+                    NSString *string = [value isKindOfClass:NSString.class] ? value : [value description];
+                    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8) ?: string.UTF8String;
+                    
+                    _NXLogPatternEmit(&buffer, groups, depth, literals, bytes, bytes ? strlen(bytes) : 0);
+                }
+                break;
+            }
+                
+            case NXLogPatternOpcodeGroupBegin:
+                groups[++depth] = (NXLogPatternGroup){ NO, NO, 0, 0 };
+                break;
+                
+            case NXLogPatternOpcodeGroupEnd:
+                depth--;
+                break;
+                
+            case NXLogPatternOpcodeSeparator:
+                groups[depth].pending = YES;
+                groups[depth].offset = op->offset;
+                groups[depth].length = op->length;
+                break;
+                
+            case NXLogPatternOpcodeTestAll:
+            case NXLogPatternOpcodeTestAny: {
+                BOOL all = YES;
+                BOOL any = NO;
+                
+                for (NSUInteger conversion = 0; conversion < NXLogPatternConversionCount; conversion++) {
+                    if (op->mask & (1 << conversion)) {
+                        BOOL empty = _NXLogPatternValue(values, cache, &computed, conversion) == nil;
+                        
+                        all = all && !empty;
+                        any = any || !empty;
+                    }
+                }
+                
+                if (op->opcode == NXLogPatternOpcodeTestAll ? !all : !any) {
+                    pc = op->operand;
+                }
+                break;
+            }
+                
+            case NXLogPatternOpcodeJump:
+                pc = op->operand;
+                break;
+        }
+    }
+    
+    NSString *string = [[NSString alloc] initWithBytes:buffer.bytes length:buffer.length encoding:NSUTF8StringEncoding];
+    
+    if (buffer.bytes != buffer.storage) {
+        free(buffer.bytes);
+    }
+    
+    return string;
+}
+
+#pragma mark - Private methods
+
+- (NSUInteger)_addOp:(NXLogPatternOpcode)opcode operand:(NSUInteger)operand {
+    if (_opCount == _opCapacity) {
+        _opCapacity = MAX(_opCapacity * 2, 16);
+        _ops = reallocf(_ops, _opCapacity * sizeof(NXLogPatternOp));
+    }
+    _ops[_opCount] = (NXLogPatternOp){ opcode, 0, operand, 0, 0 };
+    
+    return _opCount++;
+}
+
+- (NSUInteger)_addLiteral:(NSMutableString *)literal opcode:(NXLogPatternOpcode)opcode {
+    NSData *data = [literal dataUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger index = [self _addOp:opcode operand:0];
+    
+    _ops[index].offset = _literals.length;
+    _ops[index].length = data.length;
+    [_literals appendData:data];
+    [literal setString:@""];
+    
+    return index;
+}
+
+- (BOOL)_consume:(NSString *)prefix characters:(const unichar *)chars length:(NSUInteger)length index:(NSUInteger *)index {
+    NSUInteger prefixLength = prefix.length;
+    
+    if (*index + prefixLength > length) {
+        return NO;
+    }
+    for (NSUInteger i = 0; i < prefixLength; i++) {
+        if (chars[*index + i] != [prefix characterAtIndex:i]) {
+            return NO;
+        }
+    }
+    *index += prefixLength;
+    
+    return YES;
+}
+
+- (void)_compileCharacters:(const unichar *)chars length:(NSUInteger)length index:(NSUInteger *)index depth:(NSUInteger)depth closing:(BOOL)closing mask:(uint32_t *)mask {
+    NSMutableString *literal = [NSMutableString new];
+    
+    while (*index < length) {
+        unichar c = chars[(*index)++];
+        
+        if (c == '}' && closing) {
+            if (literal.length) {
+                [self _addLiteral:literal opcode:NXLogPatternOpcodeLiteral];
+            }
+            return;
+        }
+        
+        if (c != '%') {
+            [literal appendFormat:@"%C", c];
+            continue;
+        }
+        
+        // An escaped % is part of the literal
+        
+        if ([self _consume:@"%" characters:chars length:length index:index]) {
+            [literal appendString:@"%"];
+            continue;
+        }
+        
+        if (literal.length) {
+            [self _addLiteral:literal opcode:NXLogPatternOpcodeLiteral];
+        }
+        
+        if ([self _consume:@"{" characters:chars length:length index:index]) {
+            
+            // %{pattern}
+            
+            if (depth == NXLogPatternMaxDepth) {
+                [NSException raise:NSInvalidArgumentException format:@"Groups nested too deeply in pattern %@", _pattern];
+            }
+            [self _addOp:NXLogPatternOpcodeGroupBegin operand:0];
+            [self _compileCharacters:chars length:length index:index depth:depth + 1 closing:YES mask:NULL];
+            [self _addOp:NXLogPatternOpcodeGroupEnd operand:0];
+            
+        } else if ([self _consume:@"sep{" characters:chars length:length index:index]) {
+            
+            // %sep{literal}
+            
+            while (*index < length && chars[*index] != '}') {
+                if ([self _consume:@"%%" characters:chars length:length index:index]) {
+                    [literal appendString:@"%"];
+                } else if ([self _consume:@"%n" characters:chars length:length index:index]) {
+                    [literal appendString:@"\n"];
+                } else {
+                    [literal appendFormat:@"%C", chars[(*index)++]];
+                }
+            }
+            if (![self _consume:@"}" characters:chars length:length index:index]) {
+                [NSException raise:NSInvalidArgumentException format:@"Missing } in pattern %@", _pattern];
+            }
+            [self _addLiteral:literal opcode:NXLogPatternOpcodeSeparator];
+            
+        } else if ([self _consume:@"notEmpty{" characters:chars length:length index:index]) {
+            
+            // %notEmpty{pattern}
+            
+            uint32_t tested = 0;
+            NSUInteger test = [self _addOp:NXLogPatternOpcodeTestAll operand:0];
+            
+            [self _compileCharacters:chars length:length index:index depth:depth closing:YES mask:&tested];
+            _ops[test].mask = tested;
+            _ops[test].operand = _opCount;
+            
+        } else if ([self _consume:@"ifAny{" characters:chars length:length index:index]) {
+            
+            // %ifAny{conversions}{pattern}{pattern}
+            
+            uint32_t tested = 0;
+            
+            while (*index < length && chars[*index] != '}') {
+                if (chars[(*index)++] != '%' || *index == length) {
+                    [NSException raise:NSInvalidArgumentException format:@"Expected conversions after %%ifAny in pattern %@", _pattern];
+                }
+                tested |= 1 << [self _conversionForCharacter:chars[(*index)++]];
+            }
+            if (![self _consume:@"}{" characters:chars length:length index:index]) {
+                [NSException raise:NSInvalidArgumentException format:@"Missing }{ after %%ifAny in pattern %@", _pattern];
+            }
+            
+            NSUInteger test = [self _addOp:NXLogPatternOpcodeTestAny operand:0];
+            
+            _ops[test].mask = tested;
+            [self _compileCharacters:chars length:length index:index depth:depth closing:YES mask:NULL];
+            
+            if ([self _consume:@"{" characters:chars length:length index:index]) {
+                NSUInteger jump = [self _addOp:NXLogPatternOpcodeJump operand:0];
+                
+                _ops[test].operand = _opCount;
+                [self _compileCharacters:chars length:length index:index depth:depth closing:YES mask:NULL];
+                _ops[jump].operand = _opCount;
+            } else {
+                _ops[test].operand = _opCount;
+            }
+            
+        } else if ([self _consume:@"n" characters:chars length:length index:index]) {
+            [literal appendString:@"\n"];
+            
+        } else if (*index < length) {
+            
+            // %X
+            
+            NXLogPatternConversion conversion = [self _conversionForCharacter:chars[(*index)++]];
+            
+            [self _addOp:NXLogPatternOpcodeConversion operand:conversion];
+            
+            if (mask) {
+                *mask |= 1 << conversion;
+            }
+        } else {
+            [NSException raise:NSInvalidArgumentException format:@"Dangling %% in pattern %@", _pattern];
+        }
+    }
+    
+    if (closing) {
+        [NSException raise:NSInvalidArgumentException format:@"Missing } in pattern %@", _pattern];
+    }
+    if (literal.length) {
+        [self _addLiteral:literal opcode:NXLogPatternOpcodeLiteral];
+    }
+}
+
+- (NXLogPatternConversion)_conversionForCharacter:(unichar)c {
+    static const char *characters = "dhMSVPipcofFLmex";
+    
+    for (NXLogPatternConversion conversion = 0; conversion < NXLogPatternConversionCount; conversion++) {
+        if (characters[conversion] == c) {
+            _usedInfo |= NXLogPatternConversionInfo[conversion];
+            return conversion;
+        }
+    }
+    
+    [NSException raise:NSInvalidArgumentException format:@"Unknown conversion %%%C in pattern %@", c, _pattern];
+    return 0;
+}
+
+@end
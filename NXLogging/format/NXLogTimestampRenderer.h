@@ -0,0 +1,88 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A fast replacement for -[NSDateFormatter stringFromDate:] for the date formats
+ * used by the log formatters: "yyyy-MM-dd HH:mm:ss" with a space or a quoted 'T'
+ * between date and time, optionally followed by ".SSS" and one of "Z", "ZZ" or "ZZZ".
+ * Each thread converts the time to its date and time fields and renders them only
+ * once per second; within the second only the milliseconds and the zone offset are
+ * appended. The output matches the date formatter byte for byte (see the unit tests).
+ * Date formatters with any other date format, a calendar other than the Gregorian or
+ * a locale with digits other than ASCII are used as they are, and so are dates before
+ * the start of the Gregorian calendar.
+ */
+@interface NXLogTimestampRenderer : NSObject
+
+#pragma mark - Properties
+
+/// The date formatter the renderer replaces
+@property (nonatomic, readonly) NSDateFormatter *dateFormatter;
+/// YES, if the renderer renders the dates itself, NO if it uses the date formatter
+@property (nonatomic, readonly, getter=isFast) BOOL fast;
+
+#pragma mark - Designated initializer
+
+/**
+ * Create a renderer for a date formatter
+ *
+ * @param dateFormatter (input) The date formatter
+ */
+- (instancetype)initWithDateFormatter:(NSDateFormatter *)dateFormatter NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Rendering
+
+/**
+ * Test whether the renderer still reflects a date formatter. Date formatters can be changed
+ * in place, so this checks the identity, the date format and the time zone of the formatter.
+ *
+ * @param dateFormatter (input) The date formatter
+ * @result YES, if the renderer can be used in place of the date formatter
+ */
+- (BOOL)isValidForDateFormatter:(NSDateFormatter *)dateFormatter;
+
+/**
+ * Render a date
+ *
+ * @param date (input) The date
+ * @result The date as the date formatter would render it
+ */
+- (NSString *)stringFromDate:(NSDate *)date;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
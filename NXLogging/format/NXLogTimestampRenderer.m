@@ -0,0 +1,203 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogTimestampRenderer.h"
+#import <stdatomic.h>
+#import <time.h>
+
+/// The date and time fields of a second, rendered as "yyyy-MM-dd HH:mm:ss", together with the zone offset
+typedef struct _NXLogTimestampCache {
+    uint64_t rendererID;
+    long long second;
+    NSInteger offset;
+    size_t length;
+    char prefix[32];
+} NXLogTimestampCache;
+
+// The first second of the Gregorian calendar (1582-10-15 UTC). The date formatter renders earlier dates in the Julian calendar.
+static const long long NXLogTimestampGregorianStart = -12219292800LL;
+
+static __thread NXLogTimestampCache NXLogTimestampThreadCache;
+static _Atomic(uint64_t) NXLogTimestampRendererCount;
+
+// Parse the supported date formats
+static BOOL _NXLogParseDateFormat(NSString *format, char *separator, BOOL *milliseconds, BOOL *zone) {
+    NSString *rest;
+    
+    if ([format hasPrefix:@"yyyy-MM-dd HH:mm:ss"]) {
+        *separator = ' ';
+        rest = [format substringFromIndex:19];
+    } else if ([format hasPrefix:@"yyyy-MM-dd'T'HH:mm:ss"]) {
+        *separator = 'T';
+        rest = [format substringFromIndex:21];
+    } else {
+        return NO;
+    }
+    
+    *milliseconds = [rest hasPrefix:@".SSS"];
+    
+    if (*milliseconds) {
+        rest = [rest substringFromIndex:4];
+    }
+    
+    *zone = rest.length > 0;
+    
+    return !*zone || [rest isEqualToString:@"Z"] || [rest isEqualToString:@"ZZ"] || [rest isEqualToString:@"ZZZ"];
+}
+
+// Test whether a date formatter renders the fields of a date like the renderer: in the Gregorian calendar with ASCII digits
+static BOOL _NXLogIsGregorianWithASCIIDigits(NSDateFormatter *dateFormatter) {
+    NSCalendar *calendar = dateFormatter.calendar;
+    NSLocale *locale = dateFormatter.locale ?: [NSLocale currentLocale];
+    
+    if (calendar && ![calendar.calendarIdentifier isEqualToString:NSCalendarIdentifierGregorian]) {
+        return NO;
+    }
+    
+    // The locale determines the numbering system, which is not exposed otherwise
+    
+    NSNumberFormatter *numberFormatter = [NSNumberFormatter new];
+    
+    numberFormatter.locale = locale;
+    numberFormatter.numberStyle = NSNumberFormatterNoStyle;
+    
+    return [[numberFormatter stringFromNumber:@1234567890] isEqualToString:@"1234567890"];
+}
+
+@implementation NXLogTimestampRenderer {
+    uint64_t _rendererID;
+    NSString *_dateFormat;
+    NSTimeZone *_timeZone;
+    char _separator;
+    BOOL _milliseconds;
+    BOOL _zone;
+}
+
+#pragma mark - Designated initializer
+
+- (instancetype)initWithDateFormatter:(NSDateFormatter *)dateFormatter {
+    self = [super init];
+    if (self) {
+        _dateFormatter = dateFormatter;
+        _dateFormat = [dateFormatter.dateFormat copy];
+        _timeZone = dateFormatter.timeZone ?: [NSTimeZone defaultTimeZone];
+        _rendererID = atomic_fetch_add(&NXLogTimestampRendererCount, 1) + 1;
+        _fast = _NXLogParseDateFormat(_dateFormat, &_separator, &_milliseconds, &_zone) && _NXLogIsGregorianWithASCIIDigits(dateFormatter);
+    }
+    return self;
+}
+
+#pragma mark - Rendering
+
+- (BOOL)isValidForDateFormatter:(NSDateFormatter *)dateFormatter {
+    if (dateFormatter != _dateFormatter) {
+        return NO;
+    }
+    
+    NSString *dateFormat = dateFormatter.dateFormat;
+    
+    return (dateFormat == _dateFormat || [dateFormat isEqualToString:_dateFormat]) && [dateFormatter.timeZone ?: [NSTimeZone defaultTimeZone] isEqual:_timeZone];
+}
+
+- (NSString *)stringFromDate:(NSDate *)date {
+    if (!_fast) {
+        return [_dateFormatter stringFromDate:date];
+    }
+    
+    // Split the date into seconds and milliseconds the way the date formatter does
+    
+    long long millis = (long long)floor((date.timeIntervalSinceReferenceDate + NSTimeIntervalSince1970) * 1000.0);
+    long long second = millis >= 0 ? millis / 1000 : -((999 - millis) / 1000);
+    int milliseconds = (int)(millis - second * 1000);
+    
+    if (second < NXLogTimestampGregorianStart) {
+        return [_dateFormatter stringFromDate:date];
+    }
+    
+    // Render the date and time fields once per second
+    
+    NXLogTimestampCache *cache = &NXLogTimestampThreadCache;
+    
+    if (cache->rendererID != _rendererID || cache->second != second) {
+        NSInteger offset = [_timeZone secondsFromGMTForDate:[NSDate dateWithTimeIntervalSince1970:second]];
+        time_t local = (time_t)(second + offset);
+        struct tm fields;
+        
+        gmtime_r(&local, &fields);
+        
+        int length = snprintf(cache->prefix, sizeof(cache->prefix), "%04d-%02d-%02d %02d:%02d:%02d",
+                              fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday, fields.tm_hour, fields.tm_min, fields.tm_sec);
+        
+        cache->length = (size_t)MAX(length, 0);
+        cache->offset = offset;
+        cache->second = second;
+        cache->rendererID = _rendererID;
+    }
+    
+    // Append the changing parts
+    
+    char buffer[sizeof(cache->prefix) + 16];
+    size_t length = cache->length;
+    
+    memcpy(buffer, cache->prefix, length);
+    buffer[length - 9] = _separator;
+    
+    if (_milliseconds) {
+        buffer[length++] = '.';
+        buffer[length++] = '0' + milliseconds / 100;
+        buffer[length++] = '0' + milliseconds / 10 % 10;
+        buffer[length++] = '0' + milliseconds % 10;
+    }
+    
+    if (_zone) {
+        NSInteger offset = cache->offset;
+        NSInteger seconds = offset < 0 ? -offset : offset;
+        NSInteger minutes = seconds / 60;
+        
+        buffer[length++] = offset < 0 ? '-' : '+';
+        buffer[length++] = '0' + minutes / 600;
+        buffer[length++] = '0' + minutes / 60 % 10;
+        buffer[length++] = '0' + minutes % 60 / 10;
+        buffer[length++] = '0' + minutes % 10;
+        
+        // Like the date formatter append the seconds of offsets, which are not whole minutes, e.g. of local mean times
+        
+        if (seconds % 60) {
+            buffer[length++] = '0' + seconds % 60 / 10;
+            buffer[length++] = '0' + seconds % 10;
+        }
+    }
+    
+    return [[NSString alloc] initWithBytes:buffer length:length encoding:NSASCIIStringEncoding];
+}
+
+@end
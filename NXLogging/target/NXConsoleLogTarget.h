@@ -35,7 +35,10 @@
 #import "NXTextColor.h"
 
 /**
- * A log target for output on standard error for debug purposes.
+ * A log target for output on standard output, e.g. for debug purposes or in containers.
+ * Messages are collected in a buffer, which is written with a single write(2),
+ * when it is full, after the flushInterval or when a message of flushLevel or more severe
+ * is logged. Output with printf or NSLog may thus appear out of order with the log messages.
  * Since every logger created withe one of the static initializers
  * of the logger class uses the same instance of NXConsoleLogTarget,
  * you can adjust the level of log output of your application
@@ -46,10 +49,25 @@
 
 /**
  * Set to YES to enable colors on the console output.
- * In the Xcode console you will need the assistance of the XcodeColors plugin.
+ * Colors are only output to a terminal, not when standard output is redirected to a file or a pipe,
+ * except in XcodeColors mode. In the Xcode console you will need the assistance of the XcodeColors plugin.
  */
 @property (atomic) BOOL colorsEnabled;
 
+/**
+ * The escape sequences used for colors. Defaults to NXTextColorModeXcodeColors, if the XcodeColors
+ * plugin is enabled, NXTextColorModeANSI24Bit, if the terminal announces true color support
+ * with COLORTERM, and NXTextColorModeANSI256 otherwise.
+ */
+@property (atomic) NXTextColorMode colorMode;
+
+/// The number of bytes collected before they are written in one go. Defaults to 64 KiB.
+@property (atomic) NSUInteger bufferSize;
+/// The maximum time collected messages wait before they are written. 0 writes every message right away. Defaults to 0.1 seconds.
+@property (nonatomic) NSTimeInterval flushInterval;
+/// Messages of this level or more severe are written immediately, together with the messages collected before. Defaults to NXLogLevelError.
+@property (atomic) NXLogLevel flushLevel;
+
 #pragma mark - Static singleton initializer
 /// @name Static initializers
 
@@ -76,6 +94,11 @@
 
 - (NXTextColor *)colorForLogLevel:(NXLogLevel)level;
 
+/**
+ * Write all collected messages. The shared instance is flushed when the process exits.
+ */
+- (void)flush;
+
 #pragma mark - Unavailable methods
 
 + (id)new NS_UNAVAILABLE;
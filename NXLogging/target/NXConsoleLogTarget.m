@@ -32,13 +32,40 @@
 
 #import "NXConsoleLogTarget.h"
 #import "NXDebugLogFormatter.h"
+#import <pthread.h>
+#import <unistd.h>
+#import <errno.h>
+
+/// The number of log levels from NXLogLevelEmergency to NXLogLevelDebug
+#define NX_CONSOLE_LEVEL_COUNT (NXLogLevelDebug - NXLogLevelEmergency + 1)
+
+/// An escape sequence rendered to UTF-8
+typedef struct _NXConsoleEscape {
+    char bytes[32];
+    size_t length;
+} NXConsoleEscape;
+
+// Flush the shared instance, when the process exits
+static void _NXConsoleLogTargetFlushAtExit(void) {
+    [[NXConsoleLogTarget sharedInstance] flush];
+}
 
 @implementation NXConsoleLogTarget {
-    NSMutableDictionary<NSNumber *, NXTextColor *> *_logLevelColors;
+    NSMutableDictionary<NSNumber *, NXTextColor *> *_logLevelColors; // Only accessed while locked
+    NXConsoleEscape _colorEscapes[NX_CONSOLE_LEVEL_COUNT]; // The escape sequence for each level, only accessed while locked
+    NXConsoleEscape _resetEscape; // Only accessed while locked
+    BOOL _isTerminal;
+    BOOL _overridesLogMessage;
+    pthread_mutex_t _bufferLock;
+    char *_buffer; // Collects the messages until they are flushed, only accessed while locked
+    NSUInteger _bufferLength;
+    NSUInteger _bufferCapacity;
+    dispatch_source_t _flushTimer;
 }
 
 @synthesize maxLogLevel = _maxLogLevel;
 @synthesize logFormatter = _logFormatter;
+@synthesize colorMode = _colorMode;
 
 + (instancetype)sharedInstance {
     NSAssert(self == NXConsoleLogTarget.class, @"A subclass of this singleton needs its own sharedInstance!");
@@ -46,6 +73,7 @@
     static dispatch_once_t initOnce;
     dispatch_once(&initOnce, ^{
         sharedInstance = [[self alloc] initWithFormatter:[NXDebugLogFormatter sharedInstance]];
+        atexit(_NXConsoleLogTargetFlushAtExit);
     });
     return sharedInstance;
 }
@@ -55,6 +83,10 @@
     if (self) {
         _maxLogLevel = NXLogLevelDebug;
         _logFormatter = formatter;
+        _overridesLogMessage = NXLogTargetOverridesLogMessage(self, NXConsoleLogTarget.class);
+        _isTerminal = isatty(STDOUT_FILENO);
+        _bufferSize = 64 * 1024;
+        _flushLevel = NXLogLevelError;
         _logLevelColors = [@{@(NXLogLevelEmergency) : [NXTextColor colorWithRed:222 / 255.f
                                                                           green: 26 / 255.f
                                                                            blue: 22 / 255.f],
@@ -79,35 +111,204 @@
                              @(NXLogLevelDebug)     : [NXTextColor colorWithRed:  0 / 255.f
                                                                           green:116 / 255.f
                                                                            blue:  0 / 255.f]} mutableCopy];
+        pthread_mutex_init(&_bufferLock, NULL);
+        
+        // Pick the escape sequences the console most likely understands
+        
+        NSDictionary *environment = [NSProcessInfo processInfo].environment;
+        NSString *colorTerm = environment[@"COLORTERM"];
+        
+        if ([environment[@"XcodeColors"] isEqualToString:@"YES"]) {
+            _colorMode = NXTextColorModeXcodeColors;
+        } else if ([colorTerm isEqualToString:@"truecolor"] || [colorTerm isEqualToString:@"24bit"]) {
+            _colorMode = NXTextColorModeANSI24Bit;
+        } else {
+            _colorMode = NXTextColorModeANSI256;
+        }
+        [self _renderEscapes];
+        
+        // Flush periodically, so messages don't linger in the buffer when logging is slow
+        
+        __weak NXConsoleLogTarget *weakSelf = self;
+        
+        _flushTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+        dispatch_source_set_event_handler(_flushTimer, ^{
+            [weakSelf flush];
+        });
+        self.flushInterval = 0.1;
+        dispatch_resume(_flushTimer);
     }
     return self;
 }
 
+- (void)dealloc {
+    dispatch_source_cancel(_flushTimer);
+    [self _flushBuffer];
+    free(_buffer);
+    pthread_mutex_destroy(&_bufferLock);
+}
+
+- (void)setFlushInterval:(NSTimeInterval)flushInterval {
+    _flushInterval = MAX(flushInterval, 0);
+    
+    // With an interval of 0 every message is written right away, so the timer has nothing to do
+    
+    if (_flushInterval == 0) {
+        dispatch_source_set_timer(_flushTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        return;
+    }
+    
+    uint64_t interval = (uint64_t)(_flushInterval * NSEC_PER_SEC);
+    
+    dispatch_source_set_timer(_flushTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+}
+
+- (NXTextColorMode)colorMode {
+    pthread_mutex_lock(&_bufferLock);
+    NXTextColorMode colorMode = _colorMode;
+    pthread_mutex_unlock(&_bufferLock);
+    
+    return colorMode;
+}
+
+- (void)setColorMode:(NXTextColorMode)colorMode {
+    pthread_mutex_lock(&_bufferLock);
+    _colorMode = colorMode;
+    [self _renderEscapes];
+    pthread_mutex_unlock(&_bufferLock);
+}
+
 - (void)setColor:(NXTextColor *)color forLoglevel:(NXLogLevel)level {
+    pthread_mutex_lock(&_bufferLock);
     if (color) {
         _logLevelColors[@(level)] = color;
     } else {
         [_logLevelColors removeObjectForKey:@(level)];
     }
+    [self _renderEscapes];
+    pthread_mutex_unlock(&_bufferLock);
 }
 
 - (NXTextColor *)colorForLogLevel:(NXLogLevel)level {
-    return _logLevelColors[@(level)];
+    pthread_mutex_lock(&_bufferLock);
+    NXTextColor *color = _logLevelColors[@(level)];
+    pthread_mutex_unlock(&_bufferLock);
+    
+    return color;
 }
 
 - (void)log:(NXLogLevel)level message:(id)message {
+    NXLogRecord *record = [[NXLogRecord alloc] initWithMessage:message level:level client:nil loggerName:nil];
+    
+    [self _logBytes:record.bytes length:record.length level:level];
+}
+
+- (void)logRecord:(NXLogRecord *)record {
+    if (_overridesLogMessage) {
+        [self log:record.level message:record.message];
+    } else {
+        [self _logBytes:record.bytes length:record.length level:record.level];
+    }
+}
 
-    NSString *msg = [NSString stringWithFormat:@"%@", message];
+- (void)flush {
+    pthread_mutex_lock(&_bufferLock);
+    [self _flushBuffer];
+    pthread_mutex_unlock(&_bufferLock);
+}
+
+#pragma mark - Private methods
+
+- (void)_logBytes:(const char *)bytes length:(NSUInteger)length level:(NXLogLevel)level {
     
-    if (_colorsEnabled) {
-        NXTextColor *color = _logLevelColors[@(level)];
+    // Colors are only used where they can be displayed: On a terminal or in the Xcode console with XcodeColors
+    
+    BOOL colorsEnabled = self.colorsEnabled;
+    
+    pthread_mutex_lock(&_bufferLock);
+    
+    const NXConsoleEscape *color = NULL;
+    
+    if (colorsEnabled && (_isTerminal || _colorMode == NXTextColorModeXcodeColors) && level >= NXLogLevelEmergency && level <= NXLogLevelDebug) {
+        color = &_colorEscapes[level - NXLogLevelEmergency];
+        color = color->length ? color : NULL;
+    }
+    
+    NSUInteger maxLength = length + 1 + (color ? color->length + _resetEscape.length : 0);
+    
+    // Make room for the message, flushing the buffer if necessary
+    
+    NSUInteger bufferSize = MAX(self.bufferSize, 1);
+    
+    if (_bufferLength + maxLength > _bufferCapacity) {
+        [self _flushBuffer];
+        
+        if (maxLength > _bufferCapacity) {
+            _bufferCapacity = MAX(bufferSize, maxLength);
+            _buffer = reallocf(_buffer, _bufferCapacity);
+        }
+    }
+    
+    // Copy the message into the buffer, enclosed in the escape sequences, and terminate the line
+    
+    if (color) {
+        memcpy(_buffer + _bufferLength, color->bytes, color->length);
+        _bufferLength += color->length;
+    }
+    
+    memcpy(_buffer + _bufferLength, bytes, length);
+    _bufferLength += length;
+    
+    if (color) {
+        memcpy(_buffer + _bufferLength, _resetEscape.bytes, _resetEscape.length);
+        _bufferLength += _resetEscape.length;
+    }
+    
+    _buffer[_bufferLength++] = '\n';
+    
+    if (_bufferLength >= bufferSize || level <= self.flushLevel || _flushInterval == 0) {
+        [self _flushBuffer];
+    }
+    
+    pthread_mutex_unlock(&_bufferLock);
+}
+
+- (void)_flushBuffer {
+    const char *bytes = _buffer;
+    NSUInteger remaining = _bufferLength;
+    
+    while (remaining) {
+        ssize_t written = write(STDOUT_FILENO, bytes, remaining);
         
-        if (color) {
-            msg = [color colorizeText:msg];
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break; // Give up on the rest of the batch rather than failing the logging thread
         }
+        bytes += written;
+        remaining -= written;
     }
     
-    fprintf(stdout, "%s\n", [msg UTF8String]);
+    _bufferLength = 0;
+}
+
+// Render the escape sequences of all levels, must be called while locked
+- (void)_renderEscapes {
+    for (NXLogLevel level = NXLogLevelEmergency; level <= NXLogLevelDebug; level++) {
+        NXTextColor *color = _logLevelColors[@(level)];
+        
+        [self.class _renderEscape:color ? [color escapeSequenceForMode:_colorMode] : nil into:&_colorEscapes[level - NXLogLevelEmergency]];
+    }
+    [self.class _renderEscape:[NXTextColor resetSequenceForMode:_colorMode] into:&_resetEscape];
+}
+
++ (void)_renderEscape:(NSString *)sequence into:(NXConsoleEscape *)escape {
+    NSUInteger length = 0;
+    
+    [sequence getBytes:escape->bytes maxLength:sizeof(escape->bytes) usedLength:&length encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, sequence.length) remainingRange:NULL];
+    
+    escape->length = length;
 }
 
 @end
@@ -45,6 +45,19 @@
 @property (atomic) NSUInteger maxNumberOfFiles;
 @property (nonatomic, readonly) NSString *filePath;
 @property (nonatomic, readonly) NSArray<NSString *> *fileNamesHistory;
+/// The number of bytes collected before they are written to the file in one go. Defaults to 64 KiB.
+@property (atomic) NSUInteger bufferSize;
+/// The maximum time collected messages wait before they are written to the file. 0 writes every message right away. Defaults to 1 second.
+@property (nonatomic) NSTimeInterval flushInterval;
+/**
+ * Set to YES to write messages straight into log files mapped into memory instead of buffering them.
+ * Each file is preallocated to maxSize (or 16 MB if maxSize is 0) and rolled over when it is full.
+ * Messages are in the file as soon as they are logged, even if the process crashes.
+ * Must be set before the first message is logged. Defaults to NO.
+ */
+@property (atomic) BOOL memoryMapped;
+/// Set to YES to compress rolled over files with gzip in the background. Defaults to NO.
+@property (atomic) BOOL compressesRolledFiles;
 
 #pragma mark - Static singleton initializer
 /// @name Static initializers
@@ -67,6 +80,14 @@
  */
 - (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter file:(NSString *)path NS_DESIGNATED_INITIALIZER;
 
+#pragma mark - Writing
+/// @name Writing
+
+/**
+ * Write all collected messages to the file.
+ */
+- (void)flush;
+
 #pragma mark - Unavailable methods
 
 + (id)new NS_UNAVAILABLE;
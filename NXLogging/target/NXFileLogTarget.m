@@ -32,17 +32,86 @@
 
 #import "NXFileLogTarget.h"
 #import "NXDebugLogFormatter.h"
+#import "NXLogFileCompressor.h"
+#import "NXLogEpoch.h"
+#import <pthread.h>
+#import <unistd.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <stdatomic.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+
+// The file targets alive, to be flushed when the process exits
+static NSHashTable<NXFileLogTarget *> *NXFileLogTargetInstances = nil;
+
+// Flush all file targets, when the process exits
+static void _NXFileLogTargetFlushAtExit(void) {
+    NSArray<NXFileLogTarget *> *targets;
+    
+    @synchronized(NXFileLogTargetInstances) {
+        targets = NXFileLogTargetInstances.allObjects;
+    }
+    
+    for (NXFileLogTarget *target in targets) {
+        [target flush];
+    }
+}
+
+// The size of a memory mapped segment, if there is no max size
+static const size_t NXFileLogTargetDefaultSegmentSize = 16 * 1024 * 1024;
+
+/// A log file mapped into memory. Writers reserve space by advancing the offset.
+typedef struct _NXLogSegment {
+    char *base;
+    size_t capacity;
+    int fd;
+    CFAbsoluteTime creationTime;
+    uint64_t serial; // Identifies the segment, even after its memory was reused
+    _Atomic(size_t) offset;
+    _Atomic(size_t) end; // The start of the first reservation that did not fit
+    _Atomic(NSUInteger) writers; // The number of writers copying into the mapping
+} NXLogSegment;
+
+// Make sure the blocks of the file are allocated, so writing to the mapping cannot fail with SIGBUS
+static int _NXPreallocate(int fd, off_t size) {
+#ifdef __APPLE__
+    fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, size, 0 };
+    
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        fcntl(fd, F_PREALLOCATE, &store);
+    }
+    return ftruncate(fd, size);
+#else
+    return posix_fallocate(fd, 0, size);
+#endif
+}
 
 @interface NXFileLogTarget ()
 
 @property (atomic) NSFileHandle *fileHandle;
+@property (atomic) NSFileHandle *nextFileHandle;
 
 @end
 
 @implementation NXFileLogTarget {
-    NSMutableArray *_fileNamesHistory;
+    NSMutableArray *_fileNamesHistory; // Only accessed while synchronized
+    NSString *_nextFilePath;
+    BOOL _nextFileInUse; // YES, while messages are logged to the next file under its temporary name, only accessed on the rollover queue
+    dispatch_queue_t _rolloverQueue; // Prepares the next file and archives rolled over files
     NSDate *_currentFileCreationDate;
-    NSOperationQueue *_writeQueue;
+    unsigned long long _fileSize; // The size of the current file, tracked instead of asking the file handle
+    pthread_mutex_t _bufferLock;
+    char *_buffer; // Collects the messages until they are flushed, only accessed while locked
+    NSUInteger _bufferLength;
+    NSUInteger _bufferCapacity;
+    dispatch_source_t _flushTimer;
+    pthread_mutex_t _segmentLock; // Serializes opening and rolling over segments
+    _Atomic(NXLogSegment *) _segment;
+    NXLogEpoch *_segmentEpoch; // Covers loading the segment and registering as its writer
+    uint64_t _segmentSerial; // The serial of the last segment opened, only accessed while locked
+    BOOL _overridesLogMessage;
 }
 
 @synthesize maxLogLevel = _maxLogLevel;
@@ -72,28 +141,318 @@
         _logFormatter = formatter;
         _filePath = path;
         _fileNamesHistory = [self _createHistory];
-        _writeQueue = [NSOperationQueue new];
-        _writeQueue.maxConcurrentOperationCount = 1; // Force serialization on the file
+        _nextFilePath = [[path stringByDeletingLastPathComponent] stringByAppendingPathComponent:[NSString stringWithFormat:@".%@.next", path.lastPathComponent]];
+        _rolloverQueue = dispatch_queue_create("com.naxos-software.NXLogging.rollover", DISPATCH_QUEUE_SERIAL);
+        _bufferSize = 64 * 1024;
+        _overridesLogMessage = NXLogTargetOverridesLogMessage(self, NXFileLogTarget.class);
+        pthread_mutex_init(&_bufferLock, NULL);
+        pthread_mutex_init(&_segmentLock, NULL);
+        _segmentEpoch = [NXLogEpoch new];
+        
+        // Flush periodically, so messages don't linger in the buffer when logging is slow
+        
+        __weak NXFileLogTarget *weakSelf = self;
+        
+        _flushTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+        dispatch_source_set_event_handler(_flushTimer, ^{
+            [weakSelf flush];
+        });
+        self.flushInterval = 1;
+        dispatch_resume(_flushTimer);
+        
+        // Flush when the process exits, so the messages still in the buffer are not lost
+        
+        static dispatch_once_t registerOnce;
+        dispatch_once(&registerOnce, ^{
+            NXFileLogTargetInstances = [NSHashTable weakObjectsHashTable];
+            atexit(_NXFileLogTargetFlushAtExit);
+        });
+        @synchronized(NXFileLogTargetInstances) {
+            [NXFileLogTargetInstances addObject:self];
+        }
     }
     return self;
 }
 
 - (void)dealloc {
+    dispatch_source_cancel(_flushTimer);
+    [self _flushBuffer];
     [self _closeFile];
+    free(_buffer);
+    
+    if (self.nextFileHandle) {
+        [self.nextFileHandle closeFile];
+        [[NSFileManager defaultManager] removeItemAtPath:_nextFilePath error:nil];
+    }
+    pthread_mutex_destroy(&_bufferLock);
+    
+    NXLogSegment *segment = atomic_load(&_segment);
+    
+    if (segment) {
+        [self _closeSegment:segment];
+        free(segment);
+    }
+    pthread_mutex_destroy(&_segmentLock);
+}
+
+- (void)setFlushInterval:(NSTimeInterval)flushInterval {
+    _flushInterval = MAX(flushInterval, 0);
+    
+    // With an interval of 0 every message is written right away, so the timer has nothing to do
+    
+    if (_flushInterval == 0) {
+        dispatch_source_set_timer(_flushTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        return;
+    }
+    
+    uint64_t interval = (uint64_t)(_flushInterval * NSEC_PER_SEC);
+    
+    dispatch_source_set_timer(_flushTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+}
+
+- (NSArray<NSString *> *)fileNamesHistory {
+    @synchronized(_fileNamesHistory) {
+        return [_fileNamesHistory copy];
+    }
 }
 
 - (void)log:(NXLogLevel)level message:(id)message {
+    [self _logRecord:[[NXLogRecord alloc] initWithMessage:message level:level client:nil loggerName:nil]];
+}
+
+- (void)logRecord:(NXLogRecord *)record {
+    if (_overridesLogMessage) {
+        [self log:record.level message:record.message];
+    } else {
+        [self _logRecord:record];
+    }
+}
+
+- (void)flush {
+    pthread_mutex_lock(&_bufferLock);
+    [self _flushBuffer];
+    pthread_mutex_unlock(&_bufferLock);
+}
+
+#pragma mark - Private methods for writing records
+
+- (void)_logRecord:(NXLogRecord *)record {
+    const char *bytes = record.bytes;
+    NSUInteger length = record.length;
+    
+    if (self.memoryMapped) {
+        [self _logMapped:bytes length:length];
+        return;
+    }
     
-    NSString *msg = [NSString stringWithFormat:@"%@\n", message];
+    NSUInteger maxLength = length + 1;
     
-    // Put the write op into a queue and let it do the job for us
-    [_writeQueue addOperationWithBlock:^{
-        [[self _currentFileHandle] writeData:[msg dataUsingEncoding:NSUTF8StringEncoding]];
-    }];
+    pthread_mutex_lock(&_bufferLock);
+    
+    // Make room for the message, flushing the buffer if necessary
+    
+    NSUInteger bufferSize = MAX(self.bufferSize, 1);
+    
+    if (_bufferLength + maxLength > _bufferCapacity) {
+        [self _flushBuffer];
+        
+        if (maxLength > _bufferCapacity) {
+            _bufferCapacity = MAX(bufferSize, maxLength);
+            _buffer = reallocf(_buffer, _bufferCapacity);
+        }
+    }
+    
+    // Copy the message into the buffer and terminate the line
+    
+    memcpy(_buffer + _bufferLength, bytes, length);
+    
+    _bufferLength += length;
+    _buffer[_bufferLength++] = '\n';
+    
+    if (_bufferLength >= bufferSize || _flushInterval == 0) {
+        [self _flushBuffer];
+    }
+    
+    pthread_mutex_unlock(&_bufferLock);
+}
+
+#pragma mark - Private methods for memory mapped files
+
+- (void)_logMapped:(const char *)bytes length:(size_t)length {
+    size_t recordLength = length + 1;
+    
+    for (;;) {
+        
+        // Register as writer of the current segment. Within the read section of the epoch the segment cannot
+        // be freed before the registration, and afterwards not before the writer has unregistered.
+        
+        NSUInteger token = [_segmentEpoch enter];
+        NXLogSegment *segment = atomic_load(&_segment);
+        uint64_t serial = 0;
+        
+        if (segment) {
+            atomic_fetch_add(&segment->writers, 1);
+        }
+        
+        [_segmentEpoch leave:token];
+        
+        if (segment) {
+            serial = segment->serial;
+            
+            // Make sure the segment was not replaced in the meantime
+            
+            if (segment == atomic_load(&_segment) && (_maxAge == 0 || CFAbsoluteTimeGetCurrent() - segment->creationTime <= _maxAge)) {
+                
+                // Records that can never fit are dropped
+                
+                if (recordLength > segment->capacity) {
+                    atomic_fetch_sub(&segment->writers, 1);
+                    return;
+                }
+                
+                size_t start = atomic_fetch_add(&segment->offset, recordLength);
+                
+                if (start + recordLength <= segment->capacity) {
+                    memcpy(segment->base + start, bytes, length);
+                    segment->base[start + length] = '\n';
+                    
+                    atomic_fetch_sub(&segment->writers, 1);
+                    return;
+                }
+                
+                // The segment is full: Remember where its content ends
+                
+                size_t end = atomic_load(&segment->end);
+                
+                while (start < end && !atomic_compare_exchange_weak(&segment->end, &end, start));
+            }
+            
+            atomic_fetch_sub(&segment->writers, 1);
+        }
+        
+        // Open the first segment or roll over to a new one, unless another writer did so already
+        
+        NSException *exception = nil;
+        
+        pthread_mutex_lock(&_segmentLock);
+        
+        // The segment may have been freed since, so compare serials instead of addresses
+        
+        segment = atomic_load(&_segment);
+        
+        if ((segment ? segment->serial : 0) == serial) {
+            if (segment) {
+                atomic_store(&_segment, NULL);
+                
+                // Once all writers that may have loaded the segment have registered, wait for
+                // those still copying into it. Nobody can access the segment afterwards.
+                
+                [_segmentEpoch synchronize];
+                
+                while (atomic_load(&segment->writers)) {
+                    sched_yield();
+                }
+                
+                [self _closeSegment:segment];
+                [self _rollOver];
+                free(segment);
+            }
+            atomic_store(&_segment, [self _openSegment:&exception]);
+        }
+        
+        pthread_mutex_unlock(&_segmentLock);
+        
+        [exception raise];
+    }
+}
+
+// Open the current file as segment, or return NULL and the exception to raise once the segment lock is released
+- (NXLogSegment *)_openSegment:(NSException **)exception {
+    NSFileManager *fmgr = [NSFileManager defaultManager];
+    
+    if ([fmgr fileExistsAtPath:_filePath]) {
+        _currentFileCreationDate = [fmgr attributesOfItemAtPath:_filePath error:nil].fileCreationDate ?: [NSDate new];
+    } else {
+        _currentFileCreationDate = [NSDate new];
+    }
+    
+    int fd = open(_filePath.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        *exception = [NSException exceptionWithName:@"FileNotWritableException" reason:[NSString stringWithFormat:@"Unable to write to file at path %@", _filePath] userInfo:nil];
+        return NULL;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    size_t capacity = MAX(_maxSize ? (size_t)_maxSize : NXFileLogTargetDefaultSegmentSize, size);
+    char *base = _NXPreallocate(fd, capacity) == 0 ? mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    
+    if (base == MAP_FAILED) {
+        close(fd);
+        *exception = [NSException exceptionWithName:@"FileMappingFailedException" reason:[NSString stringWithFormat:@"Unable to map file at path %@", _filePath] userInfo:nil];
+        return NULL;
+    }
+    
+    // Continue after the content of the file, skipping the preallocated space a crashed process may have left behind
+    
+    while (size && base[size - 1] == 0) {
+        size--;
+    }
+    
+    NXLogSegment *segment = calloc(1, sizeof(NXLogSegment));
+    
+    segment->base = base;
+    segment->capacity = capacity;
+    segment->fd = fd;
+    segment->creationTime = _currentFileCreationDate.timeIntervalSinceReferenceDate;
+    segment->serial = ++_segmentSerial;
+    atomic_init(&segment->offset, size);
+    atomic_init(&segment->end, SIZE_MAX);
+    
+    return segment;
+}
+
+- (void)_closeSegment:(NXLogSegment *)segment {
+    size_t used = MIN(MIN(atomic_load(&segment->offset), atomic_load(&segment->end)), segment->capacity);
+    
+    munmap(segment->base, segment->capacity);
+    ftruncate(segment->fd, used);
+    close(segment->fd);
 }
 
 #pragma mark - Private methods
 
+/// Write the buffer to the file. Must be called while locked.
+- (void)_flushBuffer {
+    if (_bufferLength == 0) {
+        return;
+    }
+    
+    int fd = [self _currentFileHandle].fileDescriptor;
+    const char *bytes = _buffer;
+    NSUInteger remaining = _bufferLength;
+    
+    while (remaining) {
+        ssize_t written = write(fd, bytes, remaining);
+        
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break; // Give up on the rest of the batch rather than failing the logging thread
+        }
+        bytes += written;
+        remaining -= written;
+        _fileSize += written;
+    }
+    
+    _bufferLength = 0;
+}
+
 - (NSFileHandle *)_currentFileHandle {
     
     [self _rollOverIfNeeded];
@@ -102,6 +461,12 @@
         NSFileManager *fmgr = [NSFileManager defaultManager];
         BOOL isDir;
         
+        // Finish a rollover interrupted before, so the messages logged to the next file are neither lost nor overwritten
+        
+        dispatch_sync(_rolloverQueue, ^{
+            [self _recoverNextFile];
+        });
+        
         if ([fmgr fileExistsAtPath:_filePath isDirectory:&isDir]) {
             if (isDir) {
                 [NSException raise:@"FileIsDirectoryException" format:@"Expected a file, but found a directory %@", _filePath];
@@ -123,7 +488,15 @@
         if (self.fileHandle == nil) {
             [NSException raise:@"FileNotWritableException" format:@"Unable to create handle for file at path %@", _filePath];
         }
-        [self.fileHandle seekToEndOfFile];
+        _fileSize = [self.fileHandle seekToEndOfFile];
+        
+        // Have the next file ready, when it is time to roll over
+        
+        if (_maxAge || _maxSize) {
+            dispatch_async(_rolloverQueue, ^{
+                [self _prepareNextFile];
+            });
+        }
     }
     
     return self.fileHandle;
@@ -142,39 +515,134 @@
         */
         
         NSDate *creationDate = _currentFileCreationDate;
-        unsigned long long size = self.fileHandle.offsetInFile;
+        unsigned long long size = _fileSize;
         
         if (_maxSize && size >= _maxSize) {
-            [self _rollOver];
+            [self _switchToNextFile];
         } else if (_maxAge && -[creationDate timeIntervalSinceNow] > _maxAge) {
-            [self _rollOver];
+            [self _switchToNextFile];
+        }
+    }
+}
+
+/// Continue logging to the prepared next file and leave renaming and purging to the rollover queue
+- (void)_switchToNextFile {
+    NSFileHandle *oldHandle = self.fileHandle;
+    NSFileHandle *nextHandle = self.nextFileHandle;
+    
+    // If the next file is not ready yet, wait for it
+    
+    if (nextHandle == nil) {
+        dispatch_sync(_rolloverQueue, ^{
+            [self _prepareNextFile];
+        });
+        nextHandle = self.nextFileHandle;
+    }
+    
+    if (nextHandle == nil) {
+        [self _rollOver];
+        return;
+    }
+    
+    NSDate *date = [NSDate new];
+    
+    self.nextFileHandle = nil;
+    self.fileHandle = nextHandle;
+    _fileSize = 0;
+    _currentFileCreationDate = date;
+    
+    dispatch_async(_rolloverQueue, ^{
+        [oldHandle closeFile];
+        
+        // Give the file we are logging to its proper name, unless the old file could not be archived and would be overwritten.
+        // Then keep logging under the temporary name, until the next file is recovered when the file is opened again.
+        
+        if ([self _archiveFileWithDate:date] || ![[NSFileManager defaultManager] fileExistsAtPath:_filePath]) {
+            rename(_nextFilePath.fileSystemRepresentation, _filePath.fileSystemRepresentation);
+        } else {
+            _nextFileInUse = YES;
         }
+        
+        [self _prepareNextFile];
+    });
+}
+
+/// Create the next file. Must be called on the rollover queue.
+- (void)_prepareNextFile {
+    if (self.nextFileHandle || _nextFileInUse) {
+        return;
+    }
+    
+    NSFileManager *fmgr = [NSFileManager defaultManager];
+    
+    if ([fmgr createFileAtPath:_nextFilePath contents:NULL attributes:@{}]) {
+        self.nextFileHandle = [NSFileHandle fileHandleForWritingAtPath:_nextFilePath];
+    }
+}
+
+/// Give a next file, which messages were logged to, the name of the log file after archiving the old file,
+/// e.g. if the process exited in the middle of a rollover. Must be called on the rollover queue.
+- (void)_recoverNextFile {
+    if (self.nextFileHandle) {
+        return; // Prepared, but not logged to yet
+    }
+    
+    NSFileManager *fmgr = [NSFileManager defaultManager];
+    NSDictionary *meta = [fmgr attributesOfItemAtPath:_nextFilePath error:nil];
+    
+    if (meta == nil) {
+        _nextFileInUse = NO;
+        return;
+    }
+    
+    if (meta.fileSize == 0) {
+        [fmgr removeItemAtPath:_nextFilePath error:nil];
+        _nextFileInUse = NO;
+        return;
+    }
+    
+    NSDate *date = meta.fileCreationDate ?: meta.fileModificationDate ?: [NSDate new];
+    
+    if ([fmgr fileExistsAtPath:_filePath] && ![self _archiveFileWithDate:date]) {
+        _nextFileInUse = YES; // Keep it, until the old file can be archived
+        return;
     }
+    
+    _nextFileInUse = rename(_nextFilePath.fileSystemRepresentation, _filePath.fileSystemRepresentation) != 0;
 }
 
 - (BOOL)_rollOver {
+    [self _closeFile];
+    
+    return [self _archiveFileWithDate:[NSDate new]];
+}
+
+/// Rename the log file to its archive name and purge the oldest archived files if necessary
+- (BOOL)_archiveFileWithDate:(NSDate *)date {
     NSString *path = _filePath;
     NSString *ext = [path pathExtension];
     NSFileManager *fmgr = [NSFileManager defaultManager];
     NSError *error;
-    NSDateFormatter *dateFormatter = [NSDateFormatter new];
-
-    [dateFormatter setDateFormat:@"yyyy-MM-dd_HH-mm-ss_SSS"];
     
     if (ext.length) {
         path = [path stringByDeletingPathExtension];
     }
 
-    path = [path stringByAppendingFormat:@"-%@", [dateFormatter stringFromDate:[NSDate new]]];
+    path = [path stringByAppendingFormat:@"-%@", [[NXFileLogTarget _archiveDateFormatter] stringFromDate:date]];
     
     if (ext.length) {
         path = [path stringByAppendingPathExtension:ext];
     }
 
-    [self _closeFile];
-        
-    if ([fmgr moveItemAtPath:_filePath toPath:path error:&error]) {
-        [_fileNamesHistory addObject:path.lastPathComponent];
+    if (![fmgr moveItemAtPath:_filePath toPath:path error:&error]) {
+        //NSLog(@"Unable to rollover log file: %@", error);
+        return NO;
+    }
+    
+    NSString *name = path.lastPathComponent;
+    
+    @synchronized(_fileNamesHistory) {
+        [_fileNamesHistory addObject:name];
         
         // NSLog(@"Rolled over log file %@", _filePath.lastPathComponent);
 
@@ -190,12 +658,41 @@
             
             [_fileNamesHistory removeObjectAtIndex:0];
         }
-        return YES;
-    //} else {
-        //NSLog(@"Unable to rollover log file: %@", error);
     }
     
-    return NO;
+    if (self.compressesRolledFiles) {
+        [[NXLogFileCompressor sharedInstance] compressFileAtPath:path completion:^(NSString *compressedPath) {
+            if (compressedPath) {
+                [self _replaceHistoryName:name withName:compressedPath.lastPathComponent];
+            }
+        }];
+    }
+    
+    return YES;
+}
+
+/// Account for a compressed file in the history. If the file was purged in the meantime, the compressed file goes too.
+- (void)_replaceHistoryName:(NSString *)name withName:(NSString *)compressedName {
+    @synchronized(_fileNamesHistory) {
+        NSUInteger index = [_fileNamesHistory indexOfObject:name];
+        
+        if (index != NSNotFound) {
+            _fileNamesHistory[index] = compressedName;
+            return;
+        }
+    }
+    
+    [[NSFileManager defaultManager] removeItemAtPath:[[_filePath stringByDeletingLastPathComponent] stringByAppendingPathComponent:compressedName] error:nil];
+}
+
++ (NSDateFormatter *)_archiveDateFormatter {
+    static NSDateFormatter *dateFormatter = nil;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        dateFormatter = [NSDateFormatter new];
+        [dateFormatter setDateFormat:@"yyyy-MM-dd_HH-mm-ss_SSS"];
+    });
+    return dateFormatter;
 }
 
 - (BOOL)_createFile {
@@ -211,6 +708,7 @@
 - (void)_closeFile {
     [self.fileHandle closeFile];
     self.fileHandle = nil;
+    _fileSize = 0;
 }
 
 - (NSMutableArray<NSString *> *)_createHistory {
@@ -222,12 +720,14 @@
     NSArray *files = [fmgr contentsOfDirectoryAtPath:[_filePath stringByDeletingLastPathComponent] error:&error];
     NSMutableArray<NSString *> *fileNames = [NSMutableArray new];
     
+    NSString *compressedExt = [ext stringByAppendingPathExtension:@"gz"];
+    
     baseName = [baseName stringByAppendingString:@"-"];
     
     for (NSString *path in files) {
         NSString *name = path.lastPathComponent;
         
-        if ([name hasPrefix:baseName] && [name hasSuffix:ext]) {
+        if ([name hasPrefix:baseName] && ([name hasSuffix:ext] || [name hasSuffix:compressedExt])) {
             [fileNames addObject:name];
         }
     }
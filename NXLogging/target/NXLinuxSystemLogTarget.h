@@ -0,0 +1,118 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTarget.h"
+
+#if defined(__linux__)
+
+/// The protocol spoken to the system log daemon
+typedef NS_ENUM(NSInteger, NXLinuxSystemLogTransport) {
+    /// RFC 5424 messages sent to the syslog socket /dev/log
+    NXLinuxSystemLogTransportSyslog,
+    /// The native protocol of systemd-journald, with structured fields
+    NXLinuxSystemLogTransportJournal,
+};
+
+/**
+ * The counterpart of NXSystemLogTarget on Linux, where the Apple System Log is not available.
+ * Messages are sent as datagrams to the Unix socket of the system log daemon. They are collected
+ * and sent in batches with a single sendmmsg(2), when the batch is full, after the flushInterval
+ * or when a message of flushLevel or more severe is logged.
+ * With the journal transport, the info captured about the log client is sent as structured fields:
+ * CODE_FILE, CODE_LINE, CODE_FUNC, NX_MODULE and NX_LOGGER_NAME besides MESSAGE and PRIORITY.
+ * Entries too large for a datagram are passed to journald in a sealed memory file descriptor.
+ */
+@interface NXLinuxSystemLogTarget : NSObject <NXLogTarget>
+
+#pragma mark - Properties
+/// @name Properties
+
+/// The protocol spoken to the daemon
+@property (nonatomic, readonly) NXLinuxSystemLogTransport transport;
+/// The path of the daemon's socket
+@property (nonatomic, readonly) NSString *socketPath;
+/// The syslog facility, e.g. LOG_USER (the default) or LOG_LOCAL0
+@property (atomic) int facility;
+/// The maximum number of messages collected before they are sent in one go. Defaults to 64.
+@property (atomic) NSUInteger batchSize;
+/// The maximum time collected messages wait before they are sent. 0 sends every message right away. Defaults to 0.1 seconds.
+@property (nonatomic) NSTimeInterval flushInterval;
+/// Messages of this level or more severe are sent immediately, together with the messages collected before. Defaults to NXLogLevelError.
+@property (atomic) NXLogLevel flushLevel;
+
+#pragma mark - Static singleton initializer
+/// @name Static initializers
+
+/**
+ * Get the singleton instance of the system log target initialized with the singleton instance
+ * of the NXSystemLogFormatter. It speaks to journald, if it is running, and to syslog otherwise.
+ * @result The instance
+ */
++ (instancetype)sharedInstance;
+
+#pragma mark - Initializers
+/// @name Initializers
+
+/**
+ * Create a target for the default socket of the transport: /dev/log for syslog
+ * and /run/systemd/journal/socket for the journal
+ *
+ * @param formatter The log formatter
+ * @param transport The protocol spoken to the daemon
+ */
+- (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter transport:(NXLinuxSystemLogTransport)transport;
+
+/**
+ * The designated initializer
+ *
+ * @param formatter The log formatter
+ * @param transport The protocol spoken to the daemon
+ * @param socketPath The path of the daemon's Unix datagram socket
+ */
+- (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter transport:(NXLinuxSystemLogTransport)transport socketPath:(NSString *)socketPath NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Public methods
+
+/**
+ * Send all collected messages.
+ */
+- (void)flush;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
+
+#endif
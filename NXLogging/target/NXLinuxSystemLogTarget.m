@@ -0,0 +1,547 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#if defined(__linux__)
+
+#define _GNU_SOURCE
+#import "NXLinuxSystemLogTarget.h"
+#import "NXSystemLogFormatter.h"
+#import <pthread.h>
+#import <unistd.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <syslog.h>
+#import <time.h>
+#import <sys/mman.h>
+#import <sys/socket.h>
+#import <sys/un.h>
+
+// Journal entries larger than this are passed in a memory file descriptor instead of a datagram
+static const size_t NXJournalMaxDatagramSize = 128 * 1024;
+
+/// A growable byte buffer
+typedef struct _NXSyslogBuffer {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+    BOOL failed; // Set, if the buffer could not be grown. Nothing is appended anymore then.
+} NXSyslogBuffer;
+
+/// A datagram in the batch, given by its range in the batch's buffer
+typedef struct _NXSyslogDatagram {
+    size_t offset;
+    size_t length;
+} NXSyslogDatagram;
+
+// Grow a memory block. If that fails, the block is left as it is and NO is returned.
+static BOOL _NXSyslogGrow(void **ptr, size_t size) {
+    void *grown = realloc(*ptr, size);
+    
+    if (grown == NULL) {
+        return NO;
+    }
+    
+    *ptr = grown;
+    return YES;
+}
+
+static void _NXSyslogAppend(NXSyslogBuffer *buffer, const void *bytes, size_t length) {
+    if (buffer->failed) {
+        return;
+    }
+    if (buffer->length + length > buffer->capacity) {
+        size_t capacity = MAX(buffer->capacity * 2, MAX(buffer->length + length, (size_t)4096));
+        
+        if (!_NXSyslogGrow((void **)&buffer->bytes, capacity)) {
+            buffer->failed = YES;
+            return;
+        }
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+static void _NXSyslogAppendString(NXSyslogBuffer *buffer, const char *string) {
+    _NXSyslogAppend(buffer, string, strlen(string));
+}
+
+// Append a field of a journal entry. Values containing a line feed are framed with their length.
+static void _NXJournalAppendField(NXSyslogBuffer *buffer, const char *key, const char *value, size_t length) {
+    _NXSyslogAppendString(buffer, key);
+    
+    if (memchr(value, '\n', length)) {
+        uint64_t size = length;
+        uint8_t littleEndian[8];
+        
+        for (int i = 0; i < 8; i++) {
+            littleEndian[i] = (uint8_t)(size >> (8 * i));
+        }
+        _NXSyslogAppend(buffer, "\n", 1);
+        _NXSyslogAppend(buffer, littleEndian, sizeof(littleEndian));
+    } else {
+        _NXSyslogAppend(buffer, "=", 1);
+    }
+    
+    _NXSyslogAppend(buffer, value, length);
+    _NXSyslogAppend(buffer, "\n", 1);
+}
+
+// Pass a journal entry in a sealed memory file, as journald requires for entries exceeding a datagram
+static BOOL _NXJournalSendInMemoryFile(int sock, const char *bytes, size_t length) {
+    int fd = memfd_create("nxlogging-journal", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    
+    if (fd < 0) {
+        return NO;
+    }
+    
+    size_t offset = 0;
+    
+    while (offset < length) {
+        ssize_t written = write(fd, bytes + offset, length - offset);
+        
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return NO;
+        }
+        offset += written;
+    }
+    
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+        close(fd);
+        return NO;
+    }
+    
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr header;
+    
+    memset(&header, 0, sizeof(header));
+    memset(control, 0, sizeof(control));
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header);
+    
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    
+    ssize_t sent;
+    
+    do {
+        sent = sendmsg(sock, &header, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    
+    close(fd);
+    
+    return sent >= 0;
+}
+
+// Send the datagrams of a batch with as few calls as possible. Returns NO, if the connection is lost.
+static BOOL _NXSyslogSendBatch(int sock, BOOL journal, const NXSyslogBuffer *buffer, const NXSyslogDatagram *datagrams, size_t count, struct mmsghdr *messages, struct iovec *iovecs) {
+    for (size_t i = 0; i < count; i++) {
+        iovecs[i].iov_base = buffer->bytes + datagrams[i].offset;
+        iovecs[i].iov_len = datagrams[i].length;
+        memset(&messages[i], 0, sizeof(struct mmsghdr));
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    
+    size_t i = 0;
+    
+    while (i < count) {
+        
+        // Oversized journal entries go in a memory file, ...
+        
+        if (journal && datagrams[i].length > NXJournalMaxDatagramSize) {
+            _NXJournalSendInMemoryFile(sock, iovecs[i].iov_base, iovecs[i].iov_len);
+            i++;
+            continue;
+        }
+        
+        // ... all others are sent up to the next oversized one in one go
+        
+        size_t run = 1;
+        
+        while (i + run < count && !(journal && datagrams[i + run].length > NXJournalMaxDatagramSize)) {
+            run++;
+        }
+        
+        int sent = sendmmsg(sock, &messages[i], (unsigned int)MIN(run, (size_t)UINT_MAX), MSG_NOSIGNAL);
+        
+        if (sent > 0) {
+            i += sent;
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else if (sent < 0 && errno == EMSGSIZE) {
+            
+            // The datagram exceeds the socket's limit: Journald takes it in a memory file, syslog entries are dropped
+            
+            if (journal) {
+                _NXJournalSendInMemoryFile(sock, iovecs[i].iov_base, iovecs[i].iov_len);
+            }
+            i++;
+        } else if (sent < 0 && (errno == ECONNREFUSED || errno == ENOTCONN || errno == ENOENT || errno == EPIPE || errno == EBADF)) {
+            return NO;
+        } else {
+            i++; // Drop the datagram rather than retrying forever
+        }
+    }
+    
+    return YES;
+}
+
+// Send the messages of the shared instance, when the process exits
+static void _NXLinuxSystemLogTargetFlushAtExit(void) {
+    [[NXLinuxSystemLogTarget sharedInstance] flush];
+}
+
+// Map the log levels to syslog severities the way NXSystemLogTarget maps them to ASL levels
+static int _NXSyslogSeverity(NXLogLevel level) {
+    switch (level) {
+        case NXLogLevelDebug:
+            return LOG_DEBUG;
+        case NXLogLevelInfo:
+            return LOG_INFO;
+        case NXLogLevelNotice:
+            return LOG_NOTICE;
+        case NXLogLevelWarning:
+            return LOG_WARNING;
+        case NXLogLevelError:
+            return LOG_ERR;
+        case NXLogLevelCritical:
+            return LOG_CRIT;
+        case NXLogLevelAlert:
+            return LOG_ALERT;
+        case NXLogLevelEmergency:
+            return LOG_EMERG;
+        default:
+            return LOG_NOTICE;
+    }
+}
+
+@implementation NXLinuxSystemLogTarget {
+    BOOL _overridesLogMessage;
+    NSData *_header; // The part of each datagram that does not change: HOSTNAME APP-NAME PROCID or the journal's identifier fields
+    pthread_mutex_t _batchLock;
+    int _socket; // Only accessed while locked, -1 if not connected
+    NXSyslogBuffer _buffer; // The datagrams of the batch, only accessed while locked
+    NXSyslogDatagram *_datagrams; // Only accessed while locked
+    size_t _count;
+    size_t _capacity;
+    struct mmsghdr *_messages; // Only accessed while locked
+    struct iovec *_iovecs; // Only accessed while locked
+    dispatch_source_t _flushTimer;
+}
+
+@synthesize maxLogLevel = _maxLogLevel;
+@synthesize logFormatter = _logFormatter;
+
++ (instancetype)sharedInstance {
+    NSAssert(self == NXLinuxSystemLogTarget.class, @"A subclass of this singleton needs its own sharedInstance!");
+    static id sharedInstance = nil;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        BOOL journal = access("/run/systemd/journal/socket", W_OK) == 0;
+        
+        sharedInstance = [[self alloc] initWithFormatter:[NXSystemLogFormatter sharedInstance]
+                                               transport:journal ? NXLinuxSystemLogTransportJournal : NXLinuxSystemLogTransportSyslog];
+        atexit(_NXLinuxSystemLogTargetFlushAtExit);
+    });
+    return sharedInstance;
+}
+
+- (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter transport:(NXLinuxSystemLogTransport)transport {
+    NSString *socketPath = transport == NXLinuxSystemLogTransportJournal ? @"/run/systemd/journal/socket" : @"/dev/log";
+    
+    return [self initWithFormatter:formatter transport:transport socketPath:socketPath];
+}
+
+- (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter transport:(NXLinuxSystemLogTransport)transport socketPath:(NSString *)socketPath {
+    self = [super init];
+    if (self) {
+        _logFormatter = formatter;
+        _transport = transport;
+        _socketPath = [socketPath copy];
+        _facility = LOG_USER;
+        _batchSize = 64;
+        _flushLevel = NXLogLevelError;
+        _socket = -1;
+        _overridesLogMessage = NXLogTargetOverridesLogMessage(self, NXLinuxSystemLogTarget.class);
+        pthread_mutex_init(&_batchLock, NULL);
+        
+        // Render the unchanging part of the datagrams once
+        
+        NSString *processName = [NSProcessInfo processInfo].processName;
+        int processID = getpid();
+        
+        if (transport == NXLinuxSystemLogTransportJournal) {
+            NXSyslogBuffer header = { NULL, 0, 0, NO };
+            NSString *pid = [NSString stringWithFormat:@"%d", processID];
+            
+            _NXJournalAppendField(&header, "SYSLOG_IDENTIFIER", processName.UTF8String, strlen(processName.UTF8String));
+            _NXJournalAppendField(&header, "SYSLOG_PID", pid.UTF8String, strlen(pid.UTF8String));
+            if (header.failed) {
+                free(header.bytes);
+                [NSException raise:NSMallocException format:@"Unable to allocate the journal header"];
+            }
+            _header = [NSData dataWithBytesNoCopy:header.bytes length:header.length freeWhenDone:YES];
+        } else {
+            char hostName[256] = "-";
+            
+            gethostname(hostName, sizeof(hostName) - 1);
+            
+            // APP-NAME must not contain spaces
+            
+            NSString *appName = [processName stringByReplacingOccurrencesOfString:@" " withString:@"_"];
+            
+            _header = [[NSString stringWithFormat:@" %s %@ %d - - ", hostName[0] ? hostName : "-", appName.length ? appName : @"-", processID] dataUsingEncoding:NSUTF8StringEncoding];
+        }
+        
+        // Flush periodically, so messages don't linger in the batch when logging is slow
+        
+        __weak NXLinuxSystemLogTarget *weakSelf = self;
+        
+        _flushTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+        dispatch_source_set_event_handler(_flushTimer, ^{
+            [weakSelf flush];
+        });
+        self.flushInterval = 0.1;
+        dispatch_resume(_flushTimer);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    dispatch_source_cancel(_flushTimer);
+    [self _flushBatch];
+    if (_socket >= 0) {
+        close(_socket);
+    }
+    free(_buffer.bytes);
+    free(_datagrams);
+    free(_messages);
+    free(_iovecs);
+    pthread_mutex_destroy(&_batchLock);
+}
+
+- (void)setFlushInterval:(NSTimeInterval)flushInterval {
+    _flushInterval = MAX(flushInterval, 0);
+    
+    // With an interval of 0 every message is sent right away, so the timer has nothing to do
+    
+    if (_flushInterval == 0) {
+        dispatch_source_set_timer(_flushTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        return;
+    }
+    
+    uint64_t interval = (uint64_t)(_flushInterval * NSEC_PER_SEC);
+    
+    dispatch_source_set_timer(_flushTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+}
+
+- (void)log:(NXLogLevel)level message:(id)message {
+    [self _logRecord:[[NXLogRecord alloc] initWithMessage:message level:level client:nil loggerName:nil]];
+}
+
+- (void)logRecord:(NXLogRecord *)record {
+    if (_overridesLogMessage) {
+        [self log:record.level message:record.message];
+    } else {
+        [self _logRecord:record];
+    }
+}
+
+- (void)flush {
+    pthread_mutex_lock(&_batchLock);
+    [self _flushBatch];
+    pthread_mutex_unlock(&_batchLock);
+}
+
+#pragma mark - Private methods
+
+- (void)_logRecord:(NXLogRecord *)record {
+    NXLogLevel level = record.level;
+    int priority = self.facility | _NXSyslogSeverity(level);
+    
+    pthread_mutex_lock(&_batchLock);
+    
+    BOOL appended = [self _appendRecord:record priority:priority];
+    
+    if (appended && (_count >= self.batchSize || level <= self.flushLevel || _flushInterval == 0)) {
+        [self _flushBatch];
+    }
+    
+    pthread_mutex_unlock(&_batchLock);
+    
+    // The batch is still intact, only the record is lost
+    
+    if (!appended) {
+        [NSException raise:NSMallocException format:@"Unable to grow the syslog batch"];
+    }
+}
+
+// Append a datagram for the record to the batch. Returns NO and leaves the batch as it was, if it could not be grown.
+- (BOOL)_appendRecord:(NXLogRecord *)record priority:(int)priority {
+    if (_count == _capacity) {
+        size_t capacity = MAX(_capacity * 2, MAX(self.batchSize, (NSUInteger)1));
+        
+        // Arrays grown before a failure are just larger than needed
+        
+        if (!_NXSyslogGrow((void **)&_datagrams, capacity * sizeof(NXSyslogDatagram)) ||
+            !_NXSyslogGrow((void **)&_messages, capacity * sizeof(struct mmsghdr)) ||
+            !_NXSyslogGrow((void **)&_iovecs, capacity * sizeof(struct iovec))) {
+            return NO;
+        }
+        _capacity = capacity;
+    }
+    
+    size_t offset = _buffer.length;
+    
+    if (_transport == NXLinuxSystemLogTransportJournal) {
+        [self _appendJournalEntry:record priority:priority];
+    } else {
+        [self _appendSyslogMessage:record priority:priority];
+    }
+    
+    if (_buffer.failed) {
+        _buffer.failed = NO;
+        _buffer.length = offset;
+        return NO;
+    }
+    
+    _datagrams[_count].offset = offset;
+    _datagrams[_count].length = _buffer.length - offset;
+    _count++;
+    
+    return YES;
+}
+
+// <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA MSG
+- (void)_appendSyslogMessage:(NXLogRecord *)record priority:(int)priority {
+    NSTimeInterval time = (record.date ?: [NSDate date]).timeIntervalSince1970;
+    time_t seconds = (time_t)floor(time);
+    struct tm fields;
+    char prefix[64];
+    
+    gmtime_r(&seconds, &fields);
+    
+    int length = snprintf(prefix, sizeof(prefix), "<%d>1 %04d-%02d-%02dT%02d:%02d:%02d.%06dZ", priority,
+                          fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday, fields.tm_hour, fields.tm_min, fields.tm_sec,
+                          MIN((int)((time - seconds) * 1000000), 999999));
+    
+    _NXSyslogAppend(&_buffer, prefix, (size_t)MAX(length, 0));
+    _NXSyslogAppend(&_buffer, _header.bytes, _header.length);
+    _NXSyslogAppend(&_buffer, record.bytes, record.length);
+}
+
+- (void)_appendJournalEntry:(NXLogRecord *)record priority:(int)priority {
+    NXLogClientInfo *client = record.client;
+    char number[24];
+    
+    snprintf(number, sizeof(number), "%d", priority & LOG_PRIMASK);
+    _NXJournalAppendField(&_buffer, "PRIORITY", number, strlen(number));
+    snprintf(number, sizeof(number), "%d", priority >> 3);
+    _NXJournalAppendField(&_buffer, "SYSLOG_FACILITY", number, strlen(number));
+    _NXSyslogAppend(&_buffer, _header.bytes, _header.length);
+    _NXJournalAppendField(&_buffer, "MESSAGE", record.bytes, record.length);
+    
+    // The info captured for the formatters as structured fields
+    
+    [self _appendJournalField:"CODE_FILE" value:client.file];
+    [self _appendJournalField:"CODE_LINE" value:client.line.stringValue];
+    [self _appendJournalField:"CODE_FUNC" value:client.function];
+    [self _appendJournalField:"NX_MODULE" value:client.module];
+    [self _appendJournalField:"NX_LOGGER_NAME" value:record.loggerName];
+}
+
+- (void)_appendJournalField:(const char *)key value:(NSString *)value {
+    const char *utf8 = value.UTF8String;
+    
+    if (utf8 && utf8[0]) {
+        _NXJournalAppendField(&_buffer, key, utf8, strlen(utf8));
+    }
+}
+
+- (void)_flushBatch {
+    if (_count == 0) {
+        return;
+    }
+    
+    if (_socket < 0) {
+        [self _connect];
+    }
+    
+    // Without a daemon, the batch is dropped. Reconnect with the next batch, if the daemon was restarted.
+    
+    if (_socket >= 0 && !_NXSyslogSendBatch(_socket, _transport == NXLinuxSystemLogTransportJournal, &_buffer, _datagrams, _count, _messages, _iovecs)) {
+        close(_socket);
+        _socket = -1;
+    }
+    
+    _count = 0;
+    _buffer.length = 0;
+}
+
+- (void)_connect {
+    struct sockaddr_un address;
+    const char *path = _socketPath.fileSystemRepresentation;
+    
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    
+    if (path == NULL || strlen(path) >= sizeof(address.sun_path)) {
+        return;
+    }
+    strcpy(address.sun_path, path);
+    
+    int sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    
+    if (sock < 0) {
+        return;
+    }
+    
+    if (connect(sock, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(sock);
+        return;
+    }
+    
+    _socket = sock;
+}
+
+@end
+
+#endif
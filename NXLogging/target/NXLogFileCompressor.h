@@ -0,0 +1,76 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A singleton compressing rolled over log files with gzip in the background.
+ * Files are compressed one at a time. Each file is split into blocks, which
+ * are compressed in parallel into independent gzip members, so the result is
+ * a regular gzip file. The number of blocks compressed at the same time is
+ * bounded and the work runs with background priority, so compression never
+ * competes with the application for more than a share of the CPU.
+ */
+@interface NXLogFileCompressor : NSObject
+
+#pragma mark - Static singleton initializer
+
+/**
+ * Get the instance of this singleton.
+ *
+ * @result The instance
+ */
++ (instancetype)sharedInstance;
+
+#pragma mark - Properties
+
+/// The maximum number of blocks compressed at the same time. Defaults to half the number of processors.
+@property (nonatomic, readonly) NSUInteger maxConcurrentBlocks;
+/// The size of the blocks compressed independently. Defaults to 1 MB.
+@property (atomic) NSUInteger blockSize;
+
+#pragma mark - Compression
+
+/**
+ * Compress a file in the background. The file is replaced by a file with the extension gz.
+ *
+ * @param path (input) The path of the file
+ * @param completion (input) Called on a background queue with the path of the compressed file, or nil if compression failed
+ */
+- (void)compressFileAtPath:(NSString *)path completion:(void (^)(NSString *compressedPath))completion;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
@@ -0,0 +1,166 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXLogFileCompressor.h"
+#import <zlib.h>
+
+@implementation NXLogFileCompressor {
+    dispatch_queue_t _fileQueue; // Compresses one file after the other
+}
+
+#pragma mark - Static singleton initializer
+
++ (instancetype)sharedInstance {
+    NSAssert(self == NXLogFileCompressor.class, @"A subclass of this singleton needs its own sharedInstance!");
+    static id sharedInstance = nil;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        sharedInstance = [[self alloc] init];
+    });
+    return sharedInstance;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _maxConcurrentBlocks = MAX([NSProcessInfo processInfo].activeProcessorCount / 2, 1);
+        _blockSize = 1024 * 1024;
+        _fileQueue = dispatch_queue_create("com.naxos-software.NXLogging.compression", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_fileQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+    }
+    return self;
+}
+
+#pragma mark - Compression
+
+- (void)compressFileAtPath:(NSString *)path completion:(void (^)(NSString *compressedPath))completion {
+    dispatch_async(_fileQueue, ^{
+        NSString *compressedPath = [self _compressFileAtPath:path];
+        
+        if (completion) {
+            completion(compressedPath);
+        }
+    });
+}
+
+#pragma mark - Private methods
+
+- (NSString *)_compressFileAtPath:(NSString *)path {
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    
+    if (data == nil) {
+        return nil;
+    }
+    
+    // Compress the blocks in parallel, each worker taking every workerCount-th block, ...
+    
+    NSUInteger blockSize = MAX(self.blockSize, 64 * 1024);
+    NSUInteger blockCount = MAX((data.length + blockSize - 1) / blockSize, 1);
+    NSMutableArray *members = [NSMutableArray arrayWithCapacity:blockCount];
+    
+    for (NSUInteger i = 0; i < blockCount; i++) {
+        [members addObject:[NSNull null]];
+    }
+    
+    NSUInteger workerCount = MIN(_maxConcurrentBlocks, blockCount);
+    
+    dispatch_apply(workerCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^(size_t worker) {
+        for (NSUInteger i = worker; i < blockCount; i += workerCount) {
+            NSUInteger location = i * blockSize;
+            NSUInteger length = MIN(blockSize, data.length - location);
+            NSData *member = [NXLogFileCompressor _gzipBytes:(const Bytef *)data.bytes + location length:length];
+            
+            @synchronized(members) {
+                members[i] = member ?: [NSNull null];
+            }
+        }
+    });
+    
+    // ... and write them in order to a temporary file, which replaces the original when complete
+    
+    NSString *compressedPath = [path stringByAppendingPathExtension:@"gz"];
+    NSString *temporaryPath = [compressedPath stringByAppendingPathExtension:@"tmp"];
+    NSFileManager *fmgr = [NSFileManager defaultManager];
+    
+    if (![fmgr createFileAtPath:temporaryPath contents:NULL attributes:@{}]) {
+        return nil;
+    }
+    
+    NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:temporaryPath];
+    BOOL complete = handle != nil;
+    
+    for (id member in members) {
+        if (!complete || member == [NSNull null]) {
+            complete = NO;
+            break;
+        }
+        [handle writeData:member];
+    }
+    
+    [handle closeFile];
+    
+    if (!complete || ![fmgr moveItemAtPath:temporaryPath toPath:compressedPath error:nil]) {
+        [fmgr removeItemAtPath:temporaryPath error:nil];
+        return nil;
+    }
+    
+    [fmgr removeItemAtPath:path error:nil];
+    
+    return compressedPath;
+}
+
+/// Compress bytes into a complete gzip member
++ (NSData *)_gzipBytes:(const Bytef *)bytes length:(NSUInteger)length {
+    z_stream stream = { 0 };
+    
+    // A window size of 15 + 16 makes zlib write a gzip header and trailer
+    
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nil;
+    }
+    
+    NSMutableData *member = [NSMutableData dataWithLength:deflateBound(&stream, length) + 32];
+    
+    stream.next_in = (Bytef *)bytes;
+    stream.avail_in = (uInt)length;
+    stream.next_out = member.mutableBytes;
+    stream.avail_out = (uInt)member.length;
+    
+    int result = deflate(&stream, Z_FINISH);
+    
+    member.length = stream.total_out;
+    deflateEnd(&stream);
+    
+    return result == Z_STREAM_END ? member : nil;
+}
+
+@end
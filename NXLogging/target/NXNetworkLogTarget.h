@@ -0,0 +1,116 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTarget.h"
+
+/// The transport protocol
+typedef NS_ENUM(NSInteger, NXNetworkLogTransport) {
+    /// A TCP connection, records are framed according to the framing property
+    NXNetworkLogTransportTCP,
+    /// UDP, each record is sent in a datagram of its own
+    NXNetworkLogTransportUDP,
+};
+
+/// How records are delimited on a TCP connection
+typedef NS_ENUM(NSInteger, NXNetworkLogFraming) {
+    /// Each record is terminated by a line feed
+    NXNetworkLogFramingNewline,
+    /// Each record is preceded by its length in bytes and a space (octet counting as in RFC 6587)
+    NXNetworkLogFramingOctetCounting,
+    /// Each record is terminated by a null byte, as GELF over TCP requires
+    NXNetworkLogFramingNull,
+    /// Null bytes for GELF, line feeds for all other formats
+    NXNetworkLogFramingAutomatic,
+};
+
+/// What is sent for a record
+typedef NS_ENUM(NSInteger, NXNetworkLogFormat) {
+    /// The message as the formatter rendered it
+    NXNetworkLogFormatPlain,
+    /// The message with an RFC 5424 syslog header
+    NXNetworkLogFormatSyslog,
+    /// A GELF 1.1 JSON object with the message as short_message and the captured source code info as additional fields
+    NXNetworkLogFormatGELF,
+};
+
+/**
+ * A log target sending the log messages to a collector over the network, e.g. Logstash, Graylog or a syslog server.
+ * Logging never blocks: Messages are only appended to a queue, which is sent by a single background queue shared
+ * by all network targets, using non-blocking sockets and writing as many queued messages at once as possible.
+ * While the collector is unavailable, the target reconnects with exponential backoff and keeps up to queueCapacity
+ * bytes of messages. Further messages are dropped and counted, and a message reporting the number of dropped
+ * messages is sent, when the connection is established again.
+ */
+@interface NXNetworkLogTarget : NSObject <NXLogTarget>
+
+#pragma mark - Properties
+/// @name Properties
+
+/// The host name or address of the collector
+@property (nonatomic, readonly) NSString *host;
+/// The port of the collector
+@property (nonatomic, readonly) uint16_t port;
+/// The transport protocol
+@property (nonatomic, readonly) NXNetworkLogTransport transport;
+/// How records are delimited on a TCP connection. Defaults to NXNetworkLogFramingAutomatic.
+@property (atomic) NXNetworkLogFraming framing;
+/// What is sent for a record. Defaults to NXNetworkLogFormatPlain.
+@property (atomic) NXNetworkLogFormat format;
+/// The maximum number of bytes waiting to be sent. Defaults to 4 MiB.
+@property (atomic) NSUInteger queueCapacity;
+/// The maximum delay between two attempts to connect. Defaults to 30 seconds.
+@property (atomic) NSTimeInterval maxReconnectDelay;
+/// The number of messages dropped, because the queue was full or a datagram could not be sent
+@property (atomic, readonly) NSUInteger droppedCount;
+/// YES, while the target is connected to the collector
+@property (atomic, readonly, getter=isConnected) BOOL connected;
+
+#pragma mark - Designated initializer
+/// @name Designated initializer
+
+/**
+ * The designated initializer. The connection is established with the first message.
+ *
+ * @param formatter The log formatter
+ * @param host The host name or address of the collector
+ * @param port The port of the collector
+ * @param transport The transport protocol
+ */
+- (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter host:(NSString *)host port:(uint16_t)port transport:(NXNetworkLogTransport)transport NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
@@ -0,0 +1,688 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXNetworkLogTarget.h"
+#import <stdatomic.h>
+#import <pthread.h>
+#import <unistd.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <netdb.h>
+#import <syslog.h>
+#import <time.h>
+#import <sys/socket.h>
+
+// The first delay before reconnecting, doubled with every failed attempt
+static const NSTimeInterval NXNetworkLogTargetInitialReconnectDelay = 0.5;
+
+// The largest payload of a UDP datagram
+static const size_t NXNetworkLogTargetMaxDatagramSize = 65507;
+
+// A lost connection must not raise SIGPIPE. Where MSG_NOSIGNAL is missing, the socket is configured with SO_NOSIGPIPE instead.
+#ifdef MSG_NOSIGNAL
+static const int NXNetworkLogTargetSendFlags = MSG_NOSIGNAL;
+#else
+static const int NXNetworkLogTargetSendFlags = 0;
+#endif
+
+/// Framed records waiting to be sent, together with the length of each frame
+typedef struct _NXNetworkBatch {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+    size_t *frames;
+    size_t frameCount;
+    size_t frameCapacity;
+} NXNetworkBatch;
+
+static void _NXNetworkReserve(NXNetworkBatch *batch, size_t length) {
+    if (batch->length + length > batch->capacity) {
+        batch->capacity = MAX(batch->capacity * 2, MAX(batch->length + length, (size_t)16 * 1024));
+        batch->bytes = reallocf(batch->bytes, batch->capacity);
+    }
+}
+
+static void _NXNetworkAppend(NXNetworkBatch *batch, const void *bytes, size_t length) {
+    _NXNetworkReserve(batch, length);
+    memcpy(batch->bytes + batch->length, bytes, length);
+    batch->length += length;
+}
+
+static void _NXNetworkAppendString(NXNetworkBatch *batch, const char *string) {
+    _NXNetworkAppend(batch, string, strlen(string));
+}
+
+// Append a JSON string literal
+static void _NXNetworkAppendJSONString(NXNetworkBatch *batch, const char *bytes, size_t length) {
+    static const char hex[] = "0123456789abcdef";
+    size_t start = 0;
+    
+    _NXNetworkAppend(batch, "\"", 1);
+    
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)bytes[i];
+        
+        if (c == '"' || c == '\\' || c < 0x20) {
+            char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            
+            _NXNetworkAppend(batch, bytes + start, i - start);
+            
+            if (c == '"' || c == '\\') {
+                escape[1] = (char)c;
+                _NXNetworkAppend(batch, escape, 2);
+            } else if (c == '\n') {
+                _NXNetworkAppend(batch, "\\n", 2);
+            } else {
+                _NXNetworkAppend(batch, escape, 6);
+            }
+            start = i + 1;
+        }
+    }
+    
+    _NXNetworkAppend(batch, bytes + start, length - start);
+    _NXNetworkAppend(batch, "\"", 1);
+}
+
+static void _NXNetworkAppendJSONField(NXNetworkBatch *batch, const char *key, NSString *value) {
+    const char *utf8 = value.UTF8String;
+    
+    if (utf8 && utf8[0]) {
+        _NXNetworkAppendString(batch, key);
+        _NXNetworkAppendJSONString(batch, utf8, strlen(utf8));
+    }
+}
+
+// Map the log levels to syslog severities the way NXSystemLogTarget maps them to ASL levels
+static int _NXNetworkSeverity(NXLogLevel level) {
+    switch (level) {
+        case NXLogLevelDebug:
+            return LOG_DEBUG;
+        case NXLogLevelInfo:
+            return LOG_INFO;
+        case NXLogLevelNotice:
+            return LOG_NOTICE;
+        case NXLogLevelWarning:
+            return LOG_WARNING;
+        case NXLogLevelError:
+            return LOG_ERR;
+        case NXLogLevelCritical:
+            return LOG_CRIT;
+        case NXLogLevelAlert:
+            return LOG_ALERT;
+        case NXLogLevelEmergency:
+            return LOG_EMERG;
+        default:
+            return LOG_NOTICE;
+    }
+}
+
+@interface NXNetworkLogTarget ()
+
+@property (atomic, readwrite, getter=isConnected) BOOL connected;
+
+@end
+
+@implementation NXNetworkLogTarget {
+    BOOL _overridesLogMessage;
+    NSString *_hostName;
+    NSString *_appName;
+    pthread_mutex_t _queueLock;
+    NXNetworkBatch _pending; // Appended to by the logging threads, only accessed while locked
+    _Atomic(NSUInteger) _droppedCount;
+    atomic_bool _sendScheduled;
+    
+    // Only accessed on the event queue
+    
+    NXNetworkBatch _sending; // The batch currently being sent
+    size_t _sendOffset; // The number of bytes of the batch sent
+    size_t _sendFrame; // The first frame not sent completely
+    size_t _sendFrameStart; // The offset of that frame
+    int _socket;
+    struct addrinfo *_addresses; // The addresses of the collector while connecting, NULL otherwise
+    struct addrinfo *_nextAddress; // The address to try when connecting to the current one fails
+    BOOL _connecting;
+    BOOL _reconnectScheduled;
+    NSTimeInterval _reconnectDelay;
+    NSUInteger _reportedDropCount;
+    dispatch_source_t _readSource;
+    dispatch_source_t _writeSource;
+    BOOL _writeSourceSuspended;
+}
+
+@synthesize maxLogLevel = _maxLogLevel;
+@synthesize logFormatter = _logFormatter;
+
+- (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter host:(NSString *)host port:(uint16_t)port transport:(NXNetworkLogTransport)transport {
+    self = [super init];
+    if (self) {
+        _maxLogLevel = NXLogLevelDebug;
+        _logFormatter = formatter;
+        _host = [host copy];
+        _port = port;
+        _transport = transport;
+        _framing = NXNetworkLogFramingAutomatic;
+        _queueCapacity = 4 * 1024 * 1024;
+        _maxReconnectDelay = 30;
+        _socket = -1;
+        _overridesLogMessage = NXLogTargetOverridesLogMessage(self, NXNetworkLogTarget.class);
+        pthread_mutex_init(&_queueLock, NULL);
+        
+        char hostName[256] = "";
+        
+        gethostname(hostName, sizeof(hostName) - 1);
+        _hostName = hostName[0] ? @(hostName) : @"-";
+        _appName = [[NSProcessInfo processInfo].processName stringByReplacingOccurrencesOfString:@" " withString:@"_"];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self _closeSocket];
+    [self _freeAddresses];
+    free(_pending.bytes);
+    free(_pending.frames);
+    free(_sending.bytes);
+    free(_sending.frames);
+    pthread_mutex_destroy(&_queueLock);
+}
+
+- (NSUInteger)droppedCount {
+    return atomic_load(&_droppedCount);
+}
+
+- (void)log:(NXLogLevel)level message:(id)message {
+    [self _enqueueRecord:[[NXLogRecord alloc] initWithMessage:message level:level client:nil loggerName:nil]];
+}
+
+- (void)logRecord:(NXLogRecord *)record {
+    if (_overridesLogMessage) {
+        [self log:record.level message:record.message];
+    } else {
+        [self _enqueueRecord:record];
+    }
+}
+
+#pragma mark - Private methods for the logging threads
+
+- (void)_enqueueRecord:(NXLogRecord *)record {
+    [self _enqueueRecord:record capacity:self.queueCapacity];
+}
+
+- (void)_enqueueRecord:(NXLogRecord *)record capacity:(NSUInteger)capacity {
+    NXNetworkLogFormat format = self.format;
+    NXNetworkLogFraming framing = self.framing;
+    BOOL datagram = _transport == NXNetworkLogTransportUDP;
+    
+    pthread_mutex_lock(&_queueLock);
+    
+    size_t start = _pending.length;
+    
+    [self _appendRecord:record format:format];
+    
+    size_t length = _pending.length - start;
+    
+    // Frame the record
+    
+    if (!datagram) {
+        if (framing == NXNetworkLogFramingAutomatic) {
+            framing = format == NXNetworkLogFormatGELF ? NXNetworkLogFramingNull : NXNetworkLogFramingNewline;
+        }
+        switch (framing) {
+            case NXNetworkLogFramingOctetCounting: {
+                char prefix[24];
+                int prefixLength = snprintf(prefix, sizeof(prefix), "%zu ", length);
+                
+                _NXNetworkReserve(&_pending, prefixLength);
+                memmove(_pending.bytes + start + prefixLength, _pending.bytes + start, length);
+                memcpy(_pending.bytes + start, prefix, prefixLength);
+                _pending.length += prefixLength;
+                break;
+            }
+            case NXNetworkLogFramingNull:
+                _NXNetworkAppend(&_pending, "", 1);
+                break;
+            default:
+                _NXNetworkAppend(&_pending, "\n", 1);
+                break;
+        }
+    }
+    
+    length = _pending.length - start;
+    
+    // Drop the record, if the queue is full or it does not fit in a datagram
+    
+    if (_pending.length > capacity || (datagram && length > NXNetworkLogTargetMaxDatagramSize)) {
+        _pending.length = start;
+        pthread_mutex_unlock(&_queueLock);
+        atomic_fetch_add(&_droppedCount, 1);
+        return;
+    }
+    
+    if (_pending.frameCount == _pending.frameCapacity) {
+        _pending.frameCapacity = MAX(_pending.frameCapacity * 2, (size_t)256);
+        _pending.frames = reallocf(_pending.frames, _pending.frameCapacity * sizeof(size_t));
+    }
+    _pending.frames[_pending.frameCount++] = length;
+    
+    pthread_mutex_unlock(&_queueLock);
+    
+    // Wake up the event queue, unless it is about to send anyway
+    
+    if (!atomic_exchange(&_sendScheduled, true)) {
+        dispatch_async([self.class _eventQueue], ^{
+            atomic_store(&self->_sendScheduled, false);
+            [self _send];
+        });
+    }
+}
+
+// Must be called while locked
+- (void)_appendRecord:(NXLogRecord *)record format:(NXNetworkLogFormat)format {
+    if (format == NXNetworkLogFormatPlain) {
+        _NXNetworkAppend(&_pending, record.bytes, record.length);
+        return;
+    }
+    
+    NSTimeInterval time = (record.date ?: [NSDate date]).timeIntervalSince1970;
+    int severity = _NXNetworkSeverity(record.level);
+    char buffer[128];
+    
+    if (format == NXNetworkLogFormatSyslog) {
+        
+        // <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA MSG
+        
+        time_t seconds = (time_t)floor(time);
+        struct tm fields;
+        
+        gmtime_r(&seconds, &fields);
+        snprintf(buffer, sizeof(buffer), "<%d>1 %04d-%02d-%02dT%02d:%02d:%02d.%06dZ ", LOG_USER | severity,
+                 fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday, fields.tm_hour, fields.tm_min, fields.tm_sec,
+                 MIN((int)((time - seconds) * 1000000), 999999));
+        _NXNetworkAppendString(&_pending, buffer);
+        _NXNetworkAppendString(&_pending, _hostName.UTF8String);
+        _NXNetworkAppend(&_pending, " ", 1);
+        _NXNetworkAppendString(&_pending, _appName.length ? _appName.UTF8String : "-");
+        snprintf(buffer, sizeof(buffer), " %d - - ", getpid());
+        _NXNetworkAppendString(&_pending, buffer);
+        _NXNetworkAppend(&_pending, record.bytes, record.length);
+        return;
+    }
+    
+    // GELF 1.1
+    
+    NXLogClientInfo *client = record.client;
+    
+    _NXNetworkAppendString(&_pending, "{\"version\":\"1.1\",\"host\":");
+    _NXNetworkAppendJSONString(&_pending, _hostName.UTF8String, strlen(_hostName.UTF8String));
+    _NXNetworkAppendString(&_pending, ",\"short_message\":");
+    _NXNetworkAppendJSONString(&_pending, record.bytes, record.length);
+    snprintf(buffer, sizeof(buffer), ",\"timestamp\":%.3f,\"level\":%d", time, severity);
+    _NXNetworkAppendString(&_pending, buffer);
+    _NXNetworkAppendJSONField(&_pending, ",\"_logger\":", record.loggerName);
+    _NXNetworkAppendJSONField(&_pending, ",\"_file\":", client.fileName);
+    _NXNetworkAppendJSONField(&_pending, ",\"_function\":", client.function);
+    _NXNetworkAppendJSONField(&_pending, ",\"_module\":", client.module);
+    if (client.line) {
+        snprintf(buffer, sizeof(buffer), ",\"_line\":%lld", client.line.longLongValue);
+        _NXNetworkAppendString(&_pending, buffer);
+    }
+    _NXNetworkAppend(&_pending, "}", 1);
+}
+
+#pragma mark - Private methods for the event queue
+
++ (dispatch_queue_t)_eventQueue {
+    static dispatch_queue_t eventQueue = nil;
+    static dispatch_once_t initOnce;
+    dispatch_once(&initOnce, ^{
+        eventQueue = dispatch_queue_create("com.naxos-software.NXLogging.network", DISPATCH_QUEUE_SERIAL);
+    });
+    return eventQueue;
+}
+
+// Send as much as possible without blocking
+- (void)_send {
+    if (_socket < 0) {
+        [self _connect];
+        return;
+    }
+    
+    if (_connecting || _writeSourceSuspended == NO) {
+        return; // Sending continues, when the socket is connected or writable again
+    }
+    
+    for (;;) {
+        
+        // Take over the pending records, when the current batch is sent
+        
+        if (_sendFrame == _sending.frameCount) {
+            pthread_mutex_lock(&_queueLock);
+            NXNetworkBatch batch = _sending;
+            _sending = _pending;
+            _pending = batch;
+            _pending.length = 0;
+            _pending.frameCount = 0;
+            pthread_mutex_unlock(&_queueLock);
+            
+            _sendOffset = 0;
+            _sendFrame = 0;
+            _sendFrameStart = 0;
+            
+            if (_sending.frameCount == 0) {
+                return;
+            }
+        }
+        
+        if (![self _sendBatch]) {
+            return;
+        }
+    }
+}
+
+// Send the current batch. Returns NO, if the socket would block or the connection was lost.
+- (BOOL)_sendBatch {
+    while (_sendFrame < _sending.frameCount) {
+        ssize_t sent;
+        
+        if (_transport == NXNetworkLogTransportUDP) {
+            sent = send(_socket, _sending.bytes + _sendFrameStart, _sending.frames[_sendFrame], NXNetworkLogTargetSendFlags);
+        } else {
+            
+            // Write everything that is left in one go
+            
+            sent = send(_socket, _sending.bytes + _sendOffset, _sending.length - _sendOffset, NXNetworkLogTargetSendFlags);
+        }
+        
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                [self _resumeWriteSource];
+                return NO;
+            }
+            if (_transport == NXNetworkLogTransportUDP) {
+                
+                // Datagrams are not retried, e.g. after the collector refused the previous one
+                
+                atomic_fetch_add(&_droppedCount, 1);
+                sent = _sending.frames[_sendFrame];
+            } else {
+                [self _disconnect];
+                return NO;
+            }
+        }
+        
+        if (_transport == NXNetworkLogTransportUDP) {
+            _sendOffset = _sendFrameStart + _sending.frames[_sendFrame];
+        } else {
+            _sendOffset += sent;
+        }
+        
+        // Advance to the first frame not sent completely
+        
+        while (_sendFrame < _sending.frameCount && _sendFrameStart + _sending.frames[_sendFrame] <= _sendOffset) {
+            _sendFrameStart += _sending.frames[_sendFrame];
+            _sendFrame++;
+        }
+    }
+    
+    return YES;
+}
+
+- (void)_connect {
+    if (_socket >= 0 || _reconnectScheduled) {
+        return;
+    }
+    
+    struct addrinfo hints;
+    char port[8];
+    
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = _transport == NXNetworkLogTransportUDP ? SOCK_DGRAM : SOCK_STREAM;
+    snprintf(port, sizeof(port), "%u", _port);
+    
+    [self _freeAddresses];
+    
+    if (getaddrinfo(_host.UTF8String, port, &hints, &_addresses) != 0) {
+        _addresses = NULL;
+        [self _scheduleReconnect];
+        return;
+    }
+    
+    _nextAddress = _addresses;
+    [self _connectToNextAddress];
+}
+
+// Try the addresses of the collector in turn, until connecting to one succeeds or is in progress
+- (void)_connectToNextAddress {
+    int sock = -1;
+    BOOL connected = NO;
+    
+    while (_nextAddress && sock < 0) {
+        struct addrinfo *address = _nextAddress;
+        
+        _nextAddress = address->ai_next;
+        sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        
+        if (sock < 0) {
+            continue;
+        }
+        
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+        fcntl(sock, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        
+        if (connect(sock, address->ai_addr, address->ai_addrlen) == 0) {
+            connected = YES;
+        } else if (errno != EINPROGRESS) {
+            close(sock);
+            sock = -1;
+        }
+    }
+    
+    if (sock < 0) {
+        [self _freeAddresses];
+        [self _scheduleReconnect];
+        return;
+    }
+    
+    _socket = sock;
+    _connecting = !connected;
+    
+    // Watch the socket: for the connection being closed, and for it being connected or writable
+    
+    __weak NXNetworkLogTarget *weakSelf = self;
+    dispatch_queue_t queue = [self.class _eventQueue];
+    
+    _readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, sock, 0, queue);
+    dispatch_source_set_event_handler(_readSource, ^{
+        [weakSelf _readSocket];
+    });
+    dispatch_source_set_cancel_handler(_readSource, ^{
+        close(sock);
+    });
+    
+    _writeSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_WRITE, sock, 0, queue);
+    dispatch_source_set_event_handler(_writeSource, ^{
+        [weakSelf _socketWritable];
+    });
+    
+    dispatch_resume(_readSource);
+    _writeSourceSuspended = YES;
+    
+    if (connected) {
+        [self _didConnect];
+    } else {
+        [self _resumeWriteSource];
+    }
+}
+
+// The connection in progress either succeeded or failed. If it failed, the next address is tried.
+- (void)_finishConnecting {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    
+    if (getsockopt(_socket, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+        [self _closeSocket];
+        [self _connectToNextAddress];
+        return;
+    }
+    
+    [self _didConnect];
+}
+
+- (void)_freeAddresses {
+    if (_addresses) {
+        freeaddrinfo(_addresses);
+    }
+    _addresses = NULL;
+    _nextAddress = NULL;
+}
+
+- (void)_didConnect {
+    [self _freeAddresses];
+    _connecting = NO;
+    _reconnectDelay = 0;
+    self.connected = YES;
+    
+    // Report the messages dropped since the last report
+    
+    NSUInteger droppedCount = atomic_load(&_droppedCount);
+    
+    if (droppedCount > _reportedDropCount) {
+        NSString *message = [NSString stringWithFormat:@"%@ dropped %lu log messages while %@:%u was unavailable", self.class, (unsigned long)(droppedCount - _reportedDropCount), _host, _port];
+        
+        // The queue is likely full, but the report must not be dropped as well
+        
+        _reportedDropCount = droppedCount;
+        [self _enqueueRecord:[[NXLogRecord alloc] initWithMessage:message level:NXLogLevelWarning client:nil loggerName:nil] capacity:NSUIntegerMax];
+    }
+    
+    [self _send];
+}
+
+- (void)_socketWritable {
+    [self _suspendWriteSource];
+    
+    if (_connecting) {
+        [self _finishConnecting];
+        return;
+    }
+    
+    [self _send];
+}
+
+- (void)_readSocket {
+    
+    // Reading would consume the error of a connection that failed, which decides on trying the next address
+    
+    if (_connecting) {
+        [self _finishConnecting];
+        return;
+    }
+    
+    char buffer[1024];
+    ssize_t length = read(_socket, buffer, sizeof(buffer));
+    
+    // Collectors do not answer, so anything but the connection being closed is ignored
+    
+    if (_transport == NXNetworkLogTransportTCP && (length == 0 || (length < 0 && errno != EAGAIN && errno != EINTR))) {
+        [self _disconnect];
+    }
+}
+
+- (void)_disconnect {
+    [self _closeSocket];
+    self.connected = NO;
+    
+    // Send the frame that was interrupted once again, the collector discards the partial one with the connection
+    
+    _sendOffset = _sendFrameStart;
+    
+    [self _scheduleReconnect];
+}
+
+- (void)_closeSocket {
+    if (_socket < 0) {
+        return;
+    }
+    
+    // A suspended source cannot be cancelled. The read source closes the socket, when it is cancelled.
+    
+    if (_writeSourceSuspended) {
+        dispatch_resume(_writeSource);
+    }
+    dispatch_source_cancel(_writeSource);
+    dispatch_source_cancel(_readSource);
+    _writeSource = nil;
+    _readSource = nil;
+    _writeSourceSuspended = NO;
+    _connecting = NO;
+    _socket = -1;
+}
+
+- (void)_scheduleReconnect {
+    _reconnectDelay = MIN(_reconnectDelay > 0 ? _reconnectDelay * 2 : NXNetworkLogTargetInitialReconnectDelay, MAX(self.maxReconnectDelay, NXNetworkLogTargetInitialReconnectDelay));
+    _reconnectScheduled = YES;
+    
+    __weak NXNetworkLogTarget *weakSelf = self;
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_reconnectDelay * NSEC_PER_SEC)), [self.class _eventQueue], ^{
+        NXNetworkLogTarget *target = weakSelf;
+        
+        if (target) {
+            target->_reconnectScheduled = NO;
+            [target _connect];
+        }
+    });
+}
+
+- (void)_resumeWriteSource {
+    if (_writeSourceSuspended) {
+        _writeSourceSuspended = NO;
+        dispatch_resume(_writeSource);
+    }
+}
+
+- (void)_suspendWriteSource {
+    if (!_writeSourceSuspended) {
+        _writeSourceSuspended = YES;
+        dispatch_suspend(_writeSource);
+    }
+}
+
+@end
@@ -0,0 +1,91 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <Foundation/Foundation.h>
+#import "NXLogTarget.h"
+
+/**
+ * A log target decorating another target, which may fall behind, e.g. a network target or a slow disk.
+ * Messages are handed to the wrapped target on a background queue. While the wrapped target keeps up,
+ * they wait in memory. When more than memoryCapacity messages are waiting, further messages are appended
+ * to segment files in a directory, and delivered from there in order once the wrapped target catches up.
+ * The segment files use at most maxDiskUsage bytes; messages exceeding it are dropped and counted.
+ * Segments left over from a previous run are delivered first.
+ * Messages are spilled as UTF-8 bytes with their log level. The info about the log client does not survive spilling.
+ * The maxLogLevel and logFormatter of the wrapped target are taken over when the decorator is created.
+ */
+@interface NXSpillLogTarget : NSObject <NXLogTarget>
+
+#pragma mark - Properties
+/// @name Properties
+
+/// The wrapped target
+@property (nonatomic, readonly) id<NXLogTarget> target;
+/// The directory of the segment files
+@property (nonatomic, readonly) NSString *directory;
+/// The maximum number of messages waiting in memory. Defaults to 1024.
+@property (atomic) NSUInteger memoryCapacity;
+/// The size at which a new segment file is started. Defaults to 4 MiB.
+@property (atomic) unsigned long long segmentSize;
+/// The maximum number of bytes used by the segment files. Defaults to 64 MiB.
+@property (atomic) unsigned long long maxDiskUsage;
+
+/// @name Counters
+
+/// The number of messages waiting in memory
+@property (atomic, readonly) NSUInteger memoryCount;
+/// The number of bytes currently used by the segment files
+@property (atomic, readonly) unsigned long long diskUsage;
+/// The number of messages that were written to segment files
+@property (atomic, readonly) NSUInteger spilledCount;
+/// The number of messages dropped, because the segment files reached maxDiskUsage or could not be written
+@property (atomic, readonly) NSUInteger droppedCount;
+/// The number of messages delivered to the wrapped target
+@property (atomic, readonly) NSUInteger deliveredCount;
+
+#pragma mark - Designated initializer
+/// @name Designated initializer
+
+/**
+ * The designated initializer
+ *
+ * @param target The target to decorate
+ * @param directory The directory for the segment files, which is created if necessary. It must not be used by another target.
+ */
+- (instancetype)initWithTarget:(id<NXLogTarget>)target directory:(NSString *)directory NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Unavailable methods
+
++ (id)new NS_UNAVAILABLE;
+- (id)init NS_UNAVAILABLE;
+
+@end
@@ -0,0 +1,449 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import "NXSpillLogTarget.h"
+#import <stdatomic.h>
+#import <pthread.h>
+#import <unistd.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <sys/uio.h>
+
+/// The header preceding each message in a segment file
+typedef struct _NXSpillHeader {
+    uint32_t length;
+    int32_t level;
+} NXSpillHeader;
+
+// The number of bytes read from a segment file at once, unless a message is larger
+static const size_t NXSpillReadChunkSize = 256 * 1024;
+
+@implementation NXSpillLogTarget {
+    BOOL _overridesLogMessage;
+    pthread_mutex_t _lock;
+    
+    // Only accessed while locked
+    
+    NSMutableArray<NXLogRecord *> *_memory; // Messages older than any message in the segment files
+    BOOL _spilling; // YES, while there are messages in the segment files. New messages are spilled then, too.
+    uint64_t _readSegment;
+    uint64_t _writeSegment;
+    off_t _readOffset;
+    off_t _writeSize;
+    int _writeFd;
+    unsigned long long _diskUsage;
+    
+    // Only accessed on the drain queue
+    
+    int _readFd;
+    uint64_t _openReadSegment;
+    char *_readBuffer;
+    size_t _readBufferCapacity;
+    
+    _Atomic(NSUInteger) _spilledCount;
+    _Atomic(NSUInteger) _droppedCount;
+    _Atomic(NSUInteger) _deliveredCount;
+    dispatch_queue_t _drainQueue;
+    atomic_bool _drainScheduled;
+}
+
+@synthesize maxLogLevel = _maxLogLevel;
+@synthesize logFormatter = _logFormatter;
+
+- (instancetype)initWithTarget:(id<NXLogTarget>)target directory:(NSString *)directory {
+    self = [super init];
+    if (self) {
+        _target = target;
+        _directory = [directory copy];
+        _maxLogLevel = target.maxLogLevel;
+        _logFormatter = target.logFormatter;
+        _memoryCapacity = 1024;
+        _segmentSize = 4 * 1024 * 1024;
+        _maxDiskUsage = 64 * 1024 * 1024;
+        _memory = [NSMutableArray new];
+        _writeFd = -1;
+        _readFd = -1;
+        _overridesLogMessage = NXLogTargetOverridesLogMessage(self, NXSpillLogTarget.class);
+        _drainQueue = dispatch_queue_create("com.naxos-software.NXLogging.spill", DISPATCH_QUEUE_SERIAL);
+        pthread_mutex_init(&_lock, NULL);
+        
+        if (![[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:nil]) {
+            [NSException raise:@"FileNotWritableException" format:@"Unable to create directory at path %@", _directory];
+        }
+        
+        // Deliver the segments left over from a previous run first
+        
+        [self _recoverSegments];
+        
+        if (_spilling) {
+            [self _scheduleDrain];
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_writeFd >= 0) {
+        close(_writeFd);
+    }
+    if (_readFd >= 0) {
+        close(_readFd);
+    }
+    free(_readBuffer);
+    pthread_mutex_destroy(&_lock);
+}
+
+#pragma mark - Counters
+
+- (NSUInteger)memoryCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger count = _memory.count;
+    pthread_mutex_unlock(&_lock);
+    
+    return count;
+}
+
+- (unsigned long long)diskUsage {
+    pthread_mutex_lock(&_lock);
+    unsigned long long diskUsage = _diskUsage;
+    pthread_mutex_unlock(&_lock);
+    
+    return diskUsage;
+}
+
+- (NSUInteger)spilledCount {
+    return atomic_load(&_spilledCount);
+}
+
+- (NSUInteger)droppedCount {
+    return atomic_load(&_droppedCount);
+}
+
+- (NSUInteger)deliveredCount {
+    return atomic_load(&_deliveredCount);
+}
+
+#pragma mark - Logging
+
+- (void)log:(NXLogLevel)level message:(id)message {
+    [self _enqueueRecord:[[NXLogRecord alloc] initWithMessage:message level:level client:nil loggerName:nil]];
+}
+
+- (void)logRecord:(NXLogRecord *)record {
+    if (_overridesLogMessage) {
+        [self log:record.level message:record.message];
+    } else {
+        [self _enqueueRecord:record];
+    }
+}
+
+#pragma mark - Private methods for the logging threads
+
+- (void)_enqueueRecord:(NXLogRecord *)record {
+    NSUInteger memoryCapacity = self.memoryCapacity;
+    
+    pthread_mutex_lock(&_lock);
+    
+    // Once spilling, all messages go to the segment files, so they are delivered in order
+    
+    if (!_spilling && _memory.count < memoryCapacity) {
+        [_memory addObject:record];
+    } else if ([self _spillRecord:record]) {
+        _spilling = YES;
+        atomic_fetch_add(&_spilledCount, 1);
+    } else {
+        atomic_fetch_add(&_droppedCount, 1);
+    }
+    
+    pthread_mutex_unlock(&_lock);
+    
+    [self _scheduleDrain];
+}
+
+// Append a message to the current segment file, must be called while locked
+- (BOOL)_spillRecord:(NXLogRecord *)record {
+    NXSpillHeader header = { (uint32_t)MIN(record.length, (NSUInteger)UINT32_MAX), (int32_t)record.level };
+    off_t length = sizeof(header) + header.length;
+    
+    if (_diskUsage + length > self.maxDiskUsage) {
+        return NO;
+    }
+    
+    // Start a new segment, if there is none or the current one is full
+    
+    if (_writeFd < 0 || (_writeSize > 0 && _writeSize + length > (off_t)self.segmentSize)) {
+        if (_writeFd >= 0) {
+            close(_writeFd);
+        }
+        _writeSegment++;
+        _writeSize = 0;
+        _writeFd = open([self _pathOfSegment:_writeSegment].fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+        
+        if (!_spilling) {
+            _readSegment = _writeSegment;
+            _readOffset = 0;
+        }
+        
+        if (_writeFd < 0) {
+            return NO;
+        }
+    }
+    
+    struct iovec parts[2] = {
+        { &header, sizeof(header) },
+        { (void *)record.bytes, header.length },
+    };
+    
+    ssize_t written;
+    
+    do {
+        written = writev(_writeFd, parts, 2);
+    } while (written < 0 && errno == EINTR);
+    
+    if (written != length) {
+        
+        // Cut off a partially written message, so it is not mistaken for one
+        
+        if (written > 0) {
+            ftruncate(_writeFd, _writeSize);
+        }
+        return NO;
+    }
+    
+    _writeSize += length;
+    _diskUsage += length;
+    
+    return YES;
+}
+
+- (void)_scheduleDrain {
+    if (!atomic_exchange(&_drainScheduled, true)) {
+        dispatch_async(_drainQueue, ^{
+            atomic_store(&self->_drainScheduled, false);
+            [self _drain];
+        });
+    }
+}
+
+#pragma mark - Private methods for the drain queue
+
+// Deliver the messages in memory and in the segment files to the wrapped target, in the order they were logged
+- (void)_drain {
+    for (;;) {
+        pthread_mutex_lock(&_lock);
+        
+        NXLogRecord *record = _memory.firstObject;
+        BOOL spilling = _spilling;
+        
+        if (record) {
+            [_memory removeObjectAtIndex:0];
+        }
+        
+        pthread_mutex_unlock(&_lock);
+        
+        if (record) {
+            [self _deliverRecord:record];
+        } else if (!spilling || ![self _drainSegment]) {
+            return;
+        }
+    }
+}
+
+// Deliver a chunk of messages from the oldest segment file. Returns NO, if there was nothing to deliver.
+- (BOOL)_drainSegment {
+    pthread_mutex_lock(&_lock);
+    
+    uint64_t segment = _readSegment;
+    off_t offset = _readOffset;
+    BOOL isWritten = segment == _writeSegment && _writeFd >= 0;
+    off_t end = isWritten ? _writeSize : -1;
+    
+    pthread_mutex_unlock(&_lock);
+    
+    // Open the segment and determine its size, unless messages are still appended to it
+    
+    if (_readFd >= 0 && _openReadSegment != segment) {
+        close(_readFd);
+        _readFd = -1;
+    }
+    
+    if (_readFd < 0) {
+        _readFd = open([self _pathOfSegment:segment].fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+        _openReadSegment = segment;
+    }
+    
+    if (end < 0) {
+        struct stat info;
+        
+        end = _readFd >= 0 && fstat(_readFd, &info) == 0 ? info.st_size : 0;
+    }
+    
+    // Deliver as many complete messages as fit into the buffer
+    
+    size_t consumed = 0;
+    
+    if (_readFd >= 0 && offset < end) {
+        size_t length = (size_t)MIN(end - offset, (off_t)MAX(NXSpillReadChunkSize, _readBufferCapacity));
+        
+        if (length > _readBufferCapacity) {
+            _readBufferCapacity = length;
+            _readBuffer = reallocf(_readBuffer, _readBufferCapacity);
+        }
+        
+        ssize_t bytesRead = _readBuffer ? pread(_readFd, _readBuffer, length, offset) : -1;
+        
+        while (bytesRead > 0 && consumed + sizeof(NXSpillHeader) <= (size_t)bytesRead) {
+            NXSpillHeader header;
+            
+            memcpy(&header, _readBuffer + consumed, sizeof(header));
+            
+            size_t recordLength = sizeof(header) + header.length;
+            
+            if (consumed + recordLength > (size_t)bytesRead) {
+                
+                // A message larger than the buffer is read with a larger one next time
+                
+                if (consumed == 0 && offset + (off_t)recordLength <= end) {
+                    _readBufferCapacity = recordLength;
+                    _readBuffer = reallocf(_readBuffer, _readBufferCapacity);
+                    return YES;
+                }
+                break;
+            }
+            
+            char *bytes = malloc(MAX(header.length, 1));
+            
+            memcpy(bytes, _readBuffer + consumed + sizeof(header), header.length);
+            consumed += recordLength;
+            
+            [self _deliverRecord:[[NXLogRecord alloc] initWithBytesNoCopy:bytes length:header.length level:header.level client:nil loggerName:nil]];
+        }
+    }
+    
+    // Advance, and remove the segment once it is delivered completely
+    
+    pthread_mutex_lock(&_lock);
+    
+    _readOffset = offset + consumed;
+    _diskUsage -= MIN(_diskUsage, (unsigned long long)consumed);
+    
+    BOOL done = NO;
+    
+    if (segment == _writeSegment && _writeFd >= 0) {
+        
+        // Caught up with the messages spilled meanwhile: Back to memory
+        
+        if (_readOffset >= _writeSize) {
+            close(_writeFd);
+            _writeFd = -1;
+            _spilling = NO;
+            done = YES;
+        }
+    } else if (!isWritten && consumed == 0) {
+        
+        // A segment not written to anymore: The remainder, if any, is a truncated message
+        
+        _diskUsage -= MIN(_diskUsage, (unsigned long long)MAX(end - offset, 0));
+        
+        if (segment == _writeSegment) {
+            _spilling = NO;
+        } else {
+            _readSegment++;
+            _readOffset = 0;
+        }
+        done = YES;
+    }
+    
+    if (done) {
+        unlink([self _pathOfSegment:segment].fileSystemRepresentation);
+    }
+    
+    pthread_mutex_unlock(&_lock);
+    
+    if (done && _readFd >= 0) {
+        close(_readFd);
+        _readFd = -1;
+    }
+    
+    return consumed > 0 || done;
+}
+
+- (void)_deliverRecord:(NXLogRecord *)record {
+    if ([_target respondsToSelector:@selector(logRecord:)]) {
+        [_target logRecord:record];
+    } else {
+        [_target log:record.level message:record.message];
+    }
+    atomic_fetch_add(&_deliveredCount, 1);
+}
+
+#pragma mark - Private methods
+
+- (NSString *)_pathOfSegment:(uint64_t)segment {
+    return [_directory stringByAppendingPathComponent:[NSString stringWithFormat:@"%020llu.spill", segment]];
+}
+
+- (void)_recoverSegments {
+    NSArray<NSString *> *files = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:_directory error:nil];
+    uint64_t first = 0;
+    uint64_t last = 0;
+    
+    for (NSString *file in files) {
+        if (![file.pathExtension isEqualToString:@"spill"]) {
+            continue;
+        }
+        
+        uint64_t segment = strtoull(file.stringByDeletingPathExtension.UTF8String, NULL, 10);
+        struct stat info;
+        
+        if (segment == 0 || stat([self _pathOfSegment:segment].fileSystemRepresentation, &info) != 0) {
+            continue;
+        }
+        
+        first = first == 0 ? segment : MIN(first, segment);
+        last = MAX(last, segment);
+        _diskUsage += info.st_size;
+    }
+    
+    if (last) {
+        
+        // Segments are delivered from the first one found, new messages start a segment after the last one
+        
+        _readSegment = first;
+        _readOffset = 0;
+        _writeSegment = last;
+        _spilling = YES;
+    }
+}
+
+@end
@@ -33,6 +33,8 @@
 #import <Foundation/Foundation.h>
 #import "NXLogTarget.h"
 
+#if defined(__APPLE__)
+
 /**
  * The default log target for every logger. Since every
  * logger created withe one of the static initializers of the
@@ -70,3 +72,5 @@
 - (id)init NS_UNAVAILABLE;
 
 @end
+
+#endif
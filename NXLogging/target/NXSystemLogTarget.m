@@ -30,11 +30,15 @@
 // POSSIBILITY OF SUCH DAMAGE.
 // -----------------------------------------------------------------------------
 
+#if defined(__APPLE__)
+
 #import "NXSystemLogTarget.h"
 #import "NXSystemLogFormatter.h"
 #import <asl.h>
 
-@implementation NXSystemLogTarget
+@implementation NXSystemLogTarget {
+    BOOL _overridesLogMessage;
+}
 
 @synthesize maxLogLevel = _maxLogLevel;
 @synthesize logFormatter = _logFormatter;
@@ -53,6 +57,7 @@
     self = [super init];
     if (self) {
         _logFormatter = formatter;
+        _overridesLogMessage = NXLogTargetOverridesLogMessage(self, NXSystemLogTarget.class);
     }
     return self;
 }
@@ -64,6 +69,15 @@
     asl_log(NULL, NULL, [self.class _ASLLevel:level], "%s", [msg UTF8String]);
 }
 
+- (void)logRecord:(NXLogRecord *)record {
+    if (_overridesLogMessage) {
+        [self log:record.level message:record.message];
+        return;
+    }
+    
+    asl_log(NULL, NULL, [self.class _ASLLevel:record.level], "%.*s", (int)MIN(record.length, (NSUInteger)INT_MAX), record.bytes);
+}
+
 #pragma mark - Private methods
 /*
 + (void)_enableStdErrorLog {
@@ -98,3 +112,5 @@
 }
 
 @end
+
+#endif
@@ -0,0 +1,291 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <XCTest/XCTest.h>
+#import <NXLogging/NXLogging.h>
+
+// The info that may be present or missing in the header of a message
+static const NXLogInfo NXTestHeaderInfo[] = {
+    NXLogInfoDate, NXLogInfoDeviceName, NXLogInfoDeviceModel, NXLogInfoSystemName, NXLogInfoSystemVersion,
+    NXLogInfoProcessName, NXLogInfoProcessID, NXLogInfoLevel, NXLogInfoLoggerName, NXLogInfoModule,
+    NXLogInfoFunction, NXLogInfoFile, NXLogInfoLine,
+};
+
+static const NSUInteger NXTestHeaderInfoCount = sizeof(NXTestHeaderInfo) / sizeof(NXTestHeaderInfo[0]);
+
+/**
+ * The header as NXBasicLogFormatter built it before it rendered patterns. The patterns must
+ * render exactly the same headers.
+ */
+static NSString *NXTestLegacyHeader(NXBasicLogFormatter *formatter, NSString *loggerName, NXLogLevel level, NXLogClientInfo *client) {
+    NSMutableString *infoString = [NSMutableString new];
+    
+    if (client == nil) {
+        return infoString;
+    }
+    
+    NXLogInfo info = ~formatter.hiddenInfo;
+    
+    NSString *name = info & NXLogInfoLoggerName && loggerName.length ? loggerName : nil;
+    NSString *levelName = info & NXLogInfoLevel ? [NXBasicLogFormatter levelName:level] : nil;
+    NSDate *date = info & NXLogInfoDate && client.date ? client.date : nil;
+    NSString *device = info & NXLogInfoDeviceName && client.deviceName.length ? client.deviceName : nil;
+    NSString *model = info & NXLogInfoDeviceModel && client.deviceModel.length ? client.deviceModel : nil;
+    NSString *system = info & NXLogInfoSystemName && client.systemName.length ? client.systemName : nil;
+    NSString *systemVersion = info & NXLogInfoSystemVersion && client.systemVersion.length ? client.systemVersion : nil;
+    NSString *process = info & NXLogInfoProcessName && client.processName.length ? client.processName : nil;
+    NSNumber *pid = info & NXLogInfoProcessID && client.processID ? client.processID : nil;
+    NSString *function = info & NXLogInfoFunction && client.function.length ? client.function : nil;
+    NSString *file = info & NXLogInfoFile && client.file.length ? client.file : nil;
+    NSNumber *line = info & NXLogInfoLine && client.line ? client.line : nil;
+    NSString *module = info & NXLogInfoModule && client.module.length ? client.module : nil;
+    
+    // 1st part
+    
+    if (date) {
+        [infoString appendString:[formatter.dateFormatter stringFromDate:date]];
+    }
+    if (device) {
+        if (infoString.length) {
+            [infoString appendString:@" "];
+        }
+        [infoString appendString:device];
+    }
+    if (model || system) {
+        if (device) {
+            [infoString appendString:@"("];
+        } else if (infoString.length) {
+            [infoString appendString:@" "];
+        }
+        if (model) {
+            [infoString appendString:model];
+        }
+        if (system) {
+            if (model) {
+                [infoString appendString:@" "];
+            }
+            [infoString appendString:system];
+            if (systemVersion) {
+                [infoString appendString:@" "];
+                [infoString appendString:systemVersion];
+            }
+        }
+        if (device) {
+            [infoString appendString:@")"];
+        }
+    }
+    if (process) {
+        if (infoString.length) {
+            [infoString appendString:@" "];
+        }
+        [infoString appendString:process];
+        if (pid) {
+            [infoString appendFormat:@"[%@]", pid];
+        }
+    }
+    if (levelName) {
+        if (infoString.length) {
+            [infoString appendString:@" "];
+        }
+        [infoString appendFormat:@"<%@>", levelName];
+    }
+    
+    // 2nd part
+    
+    NSMutableString *infoString2 = [NSMutableString new];
+    
+    if (name) {
+        [infoString2 appendString:name];
+    }
+    if (module) {
+        if (name) {
+            [infoString2 appendString:@"["];
+        }
+        [infoString2 appendString:module];
+        if (name) {
+            [infoString2 appendString:@"]"];
+        }
+    }
+    if (function) {
+        if (infoString2.length) {
+            [infoString2 appendString:@" "];
+        }
+        NSArray *comps = [function componentsSeparatedByCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"[]"]];
+        
+        [infoString2 appendString:comps.count >= 2 ? [NSString stringWithFormat:@"[%@]", comps[1]] : function];
+    }
+    if (file) {
+        if (function || name) {
+            [infoString2 appendString:@"("];
+        } else if (infoString2.length) {
+            [infoString2 appendString:@" "];
+        }
+        [infoString2 appendString:file.lastPathComponent];
+        if (line) {
+            [infoString2 appendFormat:@":%@", line];
+        }
+        if (function || name) {
+            [infoString2 appendString:@")"];
+        }
+    }
+    
+    // Concatenate 1st and 2nd part
+    
+    if (infoString.length && infoString2.length) {
+        [infoString appendString:@": "];
+    }
+    [infoString appendString:infoString2];
+    
+    return infoString;
+}
+
+@interface NXBasicLogFormatterTests : XCTestCase
+
+@end
+
+@implementation NXBasicLogFormatterTests {
+    NXLogClientInfo *_client;
+}
+
+- (void)setUp {
+    [super setUp];
+    
+    _client = [[NXLogClientInfo alloc] initWithSourceCodeInfo:@{@(NXLogInfoFunction) : @"-[Controller viewDidLoad]",
+                                                                @(NXLogInfoFile)     : @"/Users/dev/Sample/Controller.m",
+                                                                @(NXLogInfoLine)     : @49,
+                                                                @(NXLogInfoModule)   : @"Sample"}];
+}
+
+#pragma mark - Helpers
+
+- (void)useFixedDateFormatIn:(NXBasicLogFormatter *)formatter {
+    NSDateFormatter *dateFormatter = [NSDateFormatter new];
+    
+    dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    dateFormatter.timeZone = [NSTimeZone timeZoneWithName:@"UTC"];
+    dateFormatter.dateFormat = @"yyyy-MM-dd HH:mm:ss";
+    formatter.dateFormatter = dateFormatter;
+}
+
+- (NSString *)messageOf:(NXBasicLogFormatter *)formatter logger:(NSString *)loggerName client:(NXLogClientInfo *)client format:(NSString *)format, ... NS_FORMAT_FUNCTION(4,5) {
+    va_list args;
+    va_start(args, format);
+    
+    NSString *message = [formatter messageForLogger:loggerName level:NXLogLevelNotice client:client error:nil exception:nil format:format arguments:args];
+    
+    va_end(args);
+    
+    return message;
+}
+
+// Render the message with every combination of header info present and missing, on top of the info the formatter hides anyway
+- (void)assertHeadersOf:(NXBasicLogFormatter *)formatter matchLegacyHeadersForLogger:(NSString *)loggerName {
+    NXLogInfo baseHiddenInfo = formatter.hiddenInfo;
+    
+    [self useFixedDateFormatIn:formatter];
+    
+    for (NSUInteger combination = 0; combination < (1 << NXTestHeaderInfoCount); combination++) {
+        NXLogInfo hiddenInfo = baseHiddenInfo;
+        
+        for (NSUInteger i = 0; i < NXTestHeaderInfoCount; i++) {
+            if (combination & (1 << i)) {
+                hiddenInfo |= NXTestHeaderInfo[i];
+            }
+        }
+        formatter.hiddenInfo = hiddenInfo;
+        
+        NSString *header = NXTestLegacyHeader(formatter, loggerName, NXLogLevelNotice, _client);
+        NSString *expected = header.length ? [header stringByAppendingString:@" - Message 42"] : @"Message 42";
+        
+        XCTAssertEqualObjects([self messageOf:formatter logger:loggerName client:_client format:@"Message %d", 42], expected, @"pattern %@, hidden info 0x%lx", formatter.pattern, (unsigned long)hiddenInfo);
+    }
+    
+    formatter.hiddenInfo = baseHiddenInfo;
+}
+
+#pragma mark - Tests
+
+- (void)testBasicPatternMatchesLegacyHeaders {
+    [self assertHeadersOf:[NXBasicLogFormatter new] matchLegacyHeadersForLogger:@"com.naxos-software.Sample"];
+}
+
+- (void)testDebugFormatterMatchesLegacyHeaders {
+    NXDebugLogFormatter *formatter = [NXDebugLogFormatter new];
+    
+    XCTAssertEqualObjects(formatter.pattern, NXLogPatternBasic);
+    [self assertHeadersOf:formatter matchLegacyHeadersForLogger:@"com.naxos-software.Sample"];
+}
+
+- (void)testSystemFormatterMatchesLegacyHeaders {
+    NXSystemLogFormatter *formatter = [NXSystemLogFormatter new];
+    
+    XCTAssertEqualObjects(formatter.pattern, NXLogPatternBasic);
+    [self assertHeadersOf:formatter matchLegacyHeadersForLogger:@"com.naxos-software.Sample"];
+}
+
+- (void)testSubclassPatternsMatchTheirFormatters {
+    for (NXBasicLogFormatter *formatter in @[[NXDebugLogFormatter new], [NXSystemLogFormatter new]]) {
+        NSString *pattern = [formatter isKindOfClass:NXDebugLogFormatter.class] ? NXLogPatternDebug : NXLogPatternSystem;
+        
+        [self useFixedDateFormatIn:formatter];
+        
+        NSString *expected = [self messageOf:formatter logger:@"com.naxos-software.Sample" client:_client format:@"Message %d", 42];
+        
+        formatter.pattern = pattern;
+        XCTAssertEqualObjects([self messageOf:formatter logger:@"com.naxos-software.Sample" client:_client format:@"Message %d", 42], expected, @"pattern %@", pattern);
+    }
+}
+
+- (void)testHeadersWithoutLoggerName {
+    [self assertHeadersOf:[NXBasicLogFormatter new] matchLegacyHeadersForLogger:nil];
+}
+
+- (void)testNoHeaderWithoutClient {
+    NXBasicLogFormatter *formatter = [NXBasicLogFormatter new];
+    
+    XCTAssertEqualObjects([self messageOf:formatter logger:@"com.naxos-software.Sample" client:nil format:@"Message %d", 42], @"Message 42");
+}
+
+- (void)testVariablesOfInfoNotCaptured {
+    static NXLogCallSite site = { "-[Controller viewDidLoad]", "/Users/dev/Sample/Controller.m", 49, "Sample", YES, NULL, NULL };
+    
+    NXLogClientInfo *client = [[NXLogClientInfo alloc] initWithCallSite:&site capturedInfo:NXLogInfoNone date:nil expandsVariables:YES];
+    NXLogClientInfo *plainClient = [[NXLogClientInfo alloc] initWithCallSite:&site capturedInfo:NXLogInfoNone];
+    
+    XCTAssertNil(client.file);
+    XCTAssertNil(client.date);
+    XCTAssertEqualObjects([client stringByReplacingVariablesInString:@"$(file):$(line) $(function)"], @"Controller.m:49 -[Controller viewDidLoad]");
+    XCTAssertFalse([[client stringByReplacingVariablesInString:@"$(date)"] hasPrefix:@"$("]);
+    XCTAssertEqualObjects([plainClient stringByReplacingVariablesInString:@"$(file) $(date)"], @"$(file) $(date)");
+}
+
+@end
@@ -0,0 +1,230 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <XCTest/XCTest.h>
+#import <NXLogging/NXLogging.h>
+
+#if defined(__linux__)
+
+#import <unistd.h>
+#import <syslog.h>
+#import <sys/socket.h>
+#import <sys/time.h>
+#import <sys/un.h>
+
+/**
+ * The target talks to a Unix datagram socket bound by the test in place of the daemon.
+ */
+@interface NXLinuxSystemLogTargetTests : XCTestCase
+
+@end
+
+@implementation NXLinuxSystemLogTargetTests {
+    NSString *_socketPath;
+    int _socket;
+}
+
+- (void)setUp {
+    [super setUp];
+    
+    struct sockaddr_un address;
+    struct timeval timeout = { 5, 0 };
+    
+    _socketPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"nxlogging-%@.sock", [NSUUID UUID].UUIDString]];
+    
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, _socketPath.fileSystemRepresentation, sizeof(address.sun_path) - 1);
+    
+    _socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    XCTAssertGreaterThanOrEqual(_socket, 0);
+    XCTAssertEqual(bind(_socket, (struct sockaddr *)&address, sizeof(address)), 0);
+    setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+- (void)tearDown {
+    close(_socket);
+    unlink(_socketPath.fileSystemRepresentation);
+    
+    [super tearDown];
+}
+
+#pragma mark - Helpers
+
+- (NXLinuxSystemLogTarget *)targetWithTransport:(NXLinuxSystemLogTransport)transport {
+    NXLinuxSystemLogTarget *target = [[NXLinuxSystemLogTarget alloc] initWithFormatter:[NXBasicLogFormatter new] transport:transport socketPath:_socketPath];
+    
+    target.flushInterval = 60; // Only full batches, severe messages and flush send the messages
+    
+    return target;
+}
+
+// The next datagram or nil, if none arrives (in time, if wait is YES)
+- (NSData *)receiveDatagram:(BOOL)wait {
+    NSMutableData *datagram = [NSMutableData dataWithLength:256 * 1024];
+    ssize_t length = recv(_socket, datagram.mutableBytes, datagram.length, wait ? 0 : MSG_DONTWAIT);
+    
+    if (length < 0) {
+        return nil;
+    }
+    
+    datagram.length = length;
+    
+    return datagram;
+}
+
+- (NSString *)receiveMessage {
+    NSData *datagram = [self receiveDatagram:YES];
+    
+    return datagram ? [[NSString alloc] initWithData:datagram encoding:NSUTF8StringEncoding] : nil;
+}
+
+#pragma mark - Tests
+
+- (void)testSyslogFraming {
+    NXLinuxSystemLogTarget *target = [self targetWithTransport:NXLinuxSystemLogTransportSyslog];
+    
+    target.facility = LOG_LOCAL0;
+    [target log:NXLogLevelNotice message:@"Hello world"];
+    [target flush];
+    
+    NSString *message = [self receiveMessage];
+    NSString *pattern = [NSString stringWithFormat:@"^<%d>1 \\d{4}-\\d{2}-\\d{2}T\\d{2}:\\d{2}:\\d{2}\\.\\d{6}Z \\S+ \\S+ %d - - Hello world$", LOG_LOCAL0 | LOG_NOTICE, getpid()];
+    
+    XCTAssertNotNil(message);
+    XCTAssertNotEqual([message rangeOfString:pattern options:NSRegularExpressionSearch].location, NSNotFound, @"%@", message);
+}
+
+- (void)testJournalFraming {
+    NXLinuxSystemLogTarget *target = [self targetWithTransport:NXLinuxSystemLogTransportJournal];
+    NSString *header = [NSString stringWithFormat:@"PRIORITY=%d\nSYSLOG_FACILITY=%d\nSYSLOG_IDENTIFIER=%@\nSYSLOG_PID=%d\nMESSAGE\n", LOG_WARNING, LOG_USER >> 3, [NSProcessInfo processInfo].processName, getpid()];
+    NSMutableData *expected = [[header dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+    uint8_t length[8] = { 13 }; // Little endian
+    
+    // A message with a line feed is framed with its length
+    
+    [expected appendBytes:length length:sizeof(length)];
+    [expected appendData:[@"Line 1\nLine 2\n" dataUsingEncoding:NSUTF8StringEncoding]];
+    
+    [target log:NXLogLevelWarning message:@"Line 1\nLine 2"];
+    [target flush];
+    
+    XCTAssertEqualObjects([self receiveDatagram:YES], expected);
+}
+
+- (void)testBatching {
+    NXLinuxSystemLogTarget *target = [self targetWithTransport:NXLinuxSystemLogTransportSyslog];
+    
+    target.batchSize = 4;
+    
+    for (int i = 0; i < 3; i++) {
+        [target log:NXLogLevelInfo message:[NSString stringWithFormat:@"Message %d", i]];
+    }
+    XCTAssertNil([self receiveDatagram:NO]);
+    
+    // The full batch is sent in order, ...
+    
+    [target log:NXLogLevelInfo message:@"Message 3"];
+    
+    for (int i = 0; i < 4; i++) {
+        XCTAssertTrue([[self receiveMessage] hasSuffix:[NSString stringWithFormat:@" - - Message %d", i]]);
+    }
+    
+    // ... and so is a batch with a severe message
+    
+    [target log:NXLogLevelInfo message:@"Message 4"];
+    [target log:NXLogLevelError message:@"Message 5"];
+    
+    XCTAssertTrue([[self receiveMessage] hasSuffix:@" - - Message 4"]);
+    XCTAssertTrue([[self receiveMessage] hasSuffix:@" - - Message 5"]);
+    XCTAssertNil([self receiveDatagram:NO]);
+}
+
+- (void)testZeroFlushIntervalSendsEveryMessage {
+    NXLinuxSystemLogTarget *target = [self targetWithTransport:NXLinuxSystemLogTransportSyslog];
+    
+    target.flushInterval = -1;
+    XCTAssertEqual(target.flushInterval, 0.0);
+    
+    [target log:NXLogLevelInfo message:@"Message 0"];
+    
+    XCTAssertTrue([[self receiveMessage] hasSuffix:@" - - Message 0"]);
+    XCTAssertNil([self receiveDatagram:NO]);
+}
+
+- (void)testMessagesAreDroppedWithoutDaemon {
+    NXLinuxSystemLogTarget *target = [[NXLinuxSystemLogTarget alloc] initWithFormatter:[NXBasicLogFormatter new]
+                                                                             transport:NXLinuxSystemLogTransportSyslog
+                                                                            socketPath:[_socketPath stringByAppendingString:@".missing"]];
+    
+    XCTAssertNoThrow([target log:NXLogLevelError message:@"Lost"]);
+    XCTAssertNoThrow([target flush]);
+}
+
+- (void)testThroughput {
+    static const NSUInteger count = 20000;
+    NXLinuxSystemLogTarget *target = [self targetWithTransport:NXLinuxSystemLogTransportSyslog];
+    
+    [self measureBlock:^{
+        
+        // The daemon's side receives concurrently, as the socket only queues a few datagrams
+        
+        dispatch_semaphore_t received = dispatch_semaphore_create(0);
+        __block NSUInteger inOrder = 0;
+        
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+            for (NSUInteger i = 0; i < count; i++) {
+                NSString *message = [self receiveMessage];
+                
+                if (message == nil) {
+                    break;
+                }
+                if ([message hasSuffix:[NSString stringWithFormat:@" - - Message %lu", (unsigned long)i]]) {
+                    inOrder++;
+                }
+            }
+            dispatch_semaphore_signal(received);
+        });
+        
+        for (NSUInteger i = 0; i < count; i++) {
+            [target log:NXLogLevelInfo message:[NSString stringWithFormat:@"Message %lu", (unsigned long)i]];
+        }
+        [target flush];
+        
+        XCTAssertEqual(dispatch_semaphore_wait(received, dispatch_time(DISPATCH_TIME_NOW, 30 * NSEC_PER_SEC)), 0L);
+        XCTAssertEqual(inOrder, count);
+    }];
+}
+
+@end
+
+#endif
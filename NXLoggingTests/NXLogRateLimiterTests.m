@@ -0,0 +1,140 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <XCTest/XCTest.h>
+#import "NXLogRateLimiter.h"
+
+static const uint64_t NXTestInterval = 100 * NSEC_PER_MSEC;
+
+@interface NXLogRateLimiterTests : XCTestCase
+
+@end
+
+@implementation NXLogRateLimiterTests
+
+#pragma mark - Helpers
+
+- (NSUInteger)rejectionsAtSite:(NXLogCallSite *)site limiter:(NXLogRateLimiter *)limiter count:(NSUInteger)count {
+    NSUInteger rejected = 0;
+    NSUInteger dropped;
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        if (![limiter admitCallSite:site interval:NXTestInterval burst:1 dropped:&dropped]) {
+            rejected++;
+        }
+    }
+    return rejected;
+}
+
+#pragma mark - Tests
+
+- (void)testBurstIsAdmitted {
+    NXLogCallSite site = { __PRETTY_FUNCTION__, __FILE__, __LINE__, NULL, NO, NULL, NULL };
+    NXLogRateLimiter *limiter = [[NXLogRateLimiter alloc] initWithCapacity:16];
+    NSUInteger dropped;
+    
+    for (int i = 0; i < 3; i++) {
+        XCTAssertTrue([limiter admitCallSite:&site interval:NSEC_PER_SEC burst:3 dropped:&dropped]);
+        XCTAssertEqual(dropped, (NSUInteger)0);
+    }
+    XCTAssertFalse([limiter admitCallSite:&site interval:NSEC_PER_SEC burst:3 dropped:&dropped]);
+}
+
+- (void)testDroppedCountIsHandedOverWhenAdmitted {
+    NXLogCallSite site = { __PRETTY_FUNCTION__, __FILE__, __LINE__, NULL, NO, NULL, NULL };
+    NXLogRateLimiter *limiter = [[NXLogRateLimiter alloc] initWithCapacity:16];
+    NSUInteger dropped;
+    
+    XCTAssertTrue([limiter admitCallSite:&site interval:NXTestInterval burst:1 dropped:&dropped]);
+    XCTAssertEqual([self rejectionsAtSite:&site limiter:limiter count:5], (NSUInteger)5);
+    
+    usleep(2 * NXTestInterval / NSEC_PER_USEC);
+    
+    XCTAssertTrue([limiter admitCallSite:&site interval:NXTestInterval burst:1 dropped:&dropped]);
+    XCTAssertEqual(dropped, (NSUInteger)5);
+}
+
+- (void)testDroppedCountsAreCollected {
+    NXLogCallSite site = { __PRETTY_FUNCTION__, __FILE__, __LINE__, NULL, NO, NULL, NULL };
+    NXLogRateLimiter *limiter = [[NXLogRateLimiter alloc] initWithCapacity:16];
+    __block NSUInteger reports = 0;
+    NSUInteger dropped;
+    
+    XCTAssertTrue([limiter admitCallSite:&site interval:NXTestInterval burst:1 dropped:&dropped]);
+    XCTAssertEqual([self rejectionsAtSite:&site limiter:limiter count:7], (NSUInteger)7);
+    
+    [limiter collectDroppedCounts:^(const char *file, NSInteger line, NSUInteger count) {
+        XCTAssertEqual(file, site.file);
+        XCTAssertEqual(line, site.line);
+        XCTAssertEqual(count, (NSUInteger)7);
+        reports++;
+    }];
+    XCTAssertEqual(reports, (NSUInteger)1);
+    
+    // Collected counts are neither collected again nor handed over when admitted
+    
+    [limiter collectDroppedCounts:^(const char *file, NSInteger line, NSUInteger count) {
+        reports++;
+    }];
+    XCTAssertEqual(reports, (NSUInteger)1);
+    
+    usleep(2 * NXTestInterval / NSEC_PER_USEC);
+    
+    XCTAssertTrue([limiter admitCallSite:&site interval:NXTestInterval burst:1 dropped:&dropped]);
+    XCTAssertEqual(dropped, (NSUInteger)0);
+}
+
+- (void)testCallSitesAreLimitedIndependently {
+    NXLogCallSite site1 = { __PRETTY_FUNCTION__, __FILE__, __LINE__, NULL, NO, NULL, NULL };
+    NXLogCallSite site2 = { __PRETTY_FUNCTION__, __FILE__, __LINE__, NULL, NO, NULL, NULL };
+    NXLogRateLimiter *limiter = [[NXLogRateLimiter alloc] initWithCapacity:16];
+    NSUInteger dropped;
+    
+    XCTAssertTrue([limiter admitCallSite:&site1 interval:NSEC_PER_SEC burst:1 dropped:&dropped]);
+    XCTAssertFalse([limiter admitCallSite:&site1 interval:NSEC_PER_SEC burst:1 dropped:&dropped]);
+    XCTAssertTrue([limiter admitCallSite:&site2 interval:NSEC_PER_SEC burst:1 dropped:&dropped]);
+}
+
+- (void)testCallSitesBeyondCapacityAreNotLimited {
+    NXLogCallSite site1 = { __PRETTY_FUNCTION__, __FILE__, __LINE__, NULL, NO, NULL, NULL };
+    NXLogCallSite site2 = { __PRETTY_FUNCTION__, __FILE__, __LINE__, NULL, NO, NULL, NULL };
+    NXLogRateLimiter *limiter = [[NXLogRateLimiter alloc] initWithCapacity:1];
+    NSUInteger dropped;
+    
+    XCTAssertTrue([limiter admitCallSite:&site1 interval:NSEC_PER_SEC burst:1 dropped:&dropped]);
+    
+    for (int i = 0; i < 3; i++) {
+        XCTAssertTrue([limiter admitCallSite:&site2 interval:NSEC_PER_SEC burst:1 dropped:&dropped]);
+    }
+}
+
+@end
@@ -0,0 +1,236 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <XCTest/XCTest.h>
+#import "NXLogTimestampRenderer.h"
+
+@interface NXLogTimestampRendererTests : XCTestCase
+
+@end
+
+@implementation NXLogTimestampRendererTests
+
+#pragma mark - Helpers
+
++ (NSArray<NSString *> *)dateFormats {
+    NSMutableArray<NSString *> *formats = [NSMutableArray new];
+    
+    for (NSString *dateTime in @[@"yyyy-MM-dd HH:mm:ss", @"yyyy-MM-dd'T'HH:mm:ss"]) {
+        for (NSString *fraction in @[@"", @".SSS"]) {
+            for (NSString *zone in @[@"", @"Z", @"ZZ", @"ZZZ"]) {
+                [formats addObject:[NSString stringWithFormat:@"%@%@%@", dateTime, fraction, zone]];
+            }
+        }
+    }
+    return formats;
+}
+
++ (NSArray<NSTimeZone *> *)timeZones {
+    NSArray<NSString *> *names = @[@"UTC",
+                                   @"Europe/Berlin",
+                                   @"America/New_York",
+                                   @"America/St_Johns",    // -03:30 with DST
+                                   @"Asia/Kolkata",        // +05:30
+                                   @"Asia/Kathmandu",      // +05:45
+                                   @"Australia/Lord_Howe", // DST shifts by 30 minutes
+                                   @"Pacific/Chatham",     // +12:45 with DST
+                                   @"Pacific/Apia"];       // Skipped a whole day in 2011
+    NSMutableArray<NSTimeZone *> *timeZones = [NSMutableArray new];
+    
+    for (NSString *name in names) {
+        NSTimeZone *timeZone = [NSTimeZone timeZoneWithName:name];
+        
+        if (timeZone) {
+            [timeZones addObject:timeZone];
+        }
+    }
+    return timeZones;
+}
+
++ (NSDateFormatter *)dateFormatterWithFormat:(NSString *)format timeZone:(NSTimeZone *)timeZone {
+    NSDateFormatter *dateFormatter = [NSDateFormatter new];
+    
+    dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    dateFormatter.calendar = [[NSCalendar alloc] initWithCalendarIdentifier:NSCalendarIdentifierGregorian];
+    dateFormatter.timeZone = timeZone;
+    dateFormatter.dateFormat = format;
+    
+    return dateFormatter;
+}
+
+// The dates around each daylight saving time transition of a time zone between 1970 and 2040
++ (NSArray<NSDate *> *)transitionDatesOfTimeZone:(NSTimeZone *)timeZone {
+    NSMutableArray<NSDate *> *dates = [NSMutableArray new];
+    NSDate *end = [NSDate dateWithTimeIntervalSince1970:2208988800]; // 2040-01-01
+    NSDate *transition = [timeZone nextDaylightSavingTimeTransitionAfterDate:[NSDate dateWithTimeIntervalSince1970:0]];
+    
+    while (transition && [transition compare:end] == NSOrderedAscending) {
+        for (NSNumber *delta in @[@-1.0, @-0.001, @0.0, @0.001, @1.0]) {
+            [dates addObject:[transition dateByAddingTimeInterval:delta.doubleValue]];
+        }
+        transition = [timeZone nextDaylightSavingTimeTransitionAfterDate:transition];
+    }
+    return dates;
+}
+
++ (NSArray<NSDate *> *)sampleDates {
+    NSMutableArray<NSDate *> *dates = [NSMutableArray new];
+    
+    for (NSNumber *interval in @[@0.0, @0.001, @0.999, @1452861296.789, @1468627199.999, @1451606399.9995,
+                                 @951782400.5,   // 2000-02-29
+                                 @4102444800.0,  // 2100-01-01
+                                 @253402300799.999, // 9999-12-31 23:59:59.999
+                                 @-0.001, @-0.5, @-1.0, @-1.001, @-86400.25,
+                                 @-2208988800.0,    // 1900-01-01
+                                 @-11676096000.0,   // 1600-01-01
+                                 @-12219292800.0,   // 1582-10-15, the first day of the Gregorian calendar
+                                 @-12219292800.001, // 1582-10-04 in the Julian calendar
+                                 @-14000000000.0]) {
+        [dates addObject:[NSDate dateWithTimeIntervalSince1970:interval.doubleValue]];
+    }
+    
+    // A pseudo-random spread over both sides of the epoch, reproducible between runs
+    
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    
+    for (NSUInteger i = 0; i < 500; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        
+        double interval = (double)(int64_t)(state >> 11) / (double)(1ULL << 53) * 8e9 - 4e9;
+        
+        [dates addObject:[NSDate dateWithTimeIntervalSince1970:interval]];
+    }
+    return dates;
+}
+
+- (void)assertRenderer:(NXLogTimestampRenderer *)renderer matchesDates:(NSArray<NSDate *> *)dates {
+    for (NSDate *date in dates) {
+        NSString *expected = [renderer.dateFormatter stringFromDate:date];
+        NSString *rendered = [renderer stringFromDate:date];
+        
+        XCTAssertEqualObjects(rendered, expected, @"format %@, time zone %@, date %.3f", renderer.dateFormatter.dateFormat, renderer.dateFormatter.timeZone.name, date.timeIntervalSince1970);
+    }
+}
+
+#pragma mark - Tests
+
+- (void)testSupportedFormatsAreRenderedFast {
+    for (NSString *format in [self.class dateFormats]) {
+        NXLogTimestampRenderer *renderer = [[NXLogTimestampRenderer alloc] initWithDateFormatter:[self.class dateFormatterWithFormat:format timeZone:[NSTimeZone timeZoneWithName:@"UTC"]]];
+        
+        XCTAssertTrue(renderer.fast, @"format %@", format);
+    }
+}
+
+- (void)testMatchesDateFormatterAcrossFormatsAndTimeZones {
+    NSArray<NSDate *> *dates = [self.class sampleDates];
+    
+    for (NSTimeZone *timeZone in [self.class timeZones]) {
+        for (NSString *format in [self.class dateFormats]) {
+            [self assertRenderer:[[NXLogTimestampRenderer alloc] initWithDateFormatter:[self.class dateFormatterWithFormat:format timeZone:timeZone]] matchesDates:dates];
+        }
+    }
+}
+
+- (void)testMatchesDateFormatterAtDaylightSavingTimeTransitions {
+    for (NSTimeZone *timeZone in [self.class timeZones]) {
+        NSArray<NSDate *> *dates = [self.class transitionDatesOfTimeZone:timeZone];
+        
+        for (NSString *format in @[@"yyyy-MM-dd HH:mm:ss.SSSZ", @"yyyy-MM-dd'T'HH:mm:ss"]) {
+            [self assertRenderer:[[NXLogTimestampRenderer alloc] initWithDateFormatter:[self.class dateFormatterWithFormat:format timeZone:timeZone]] matchesDates:dates];
+        }
+    }
+}
+
+- (void)testMatchesDateFormatterForOffsetsWithSeconds {
+    NSMutableArray<NSDate *> *dates = [NSMutableArray new];
+    
+    // Amsterdam used its local mean time of +00:19:32 until 1937, Monrovia -00:44:30 until 1972
+    
+    for (NSInteger year = 1900; year <= 1975; year++) {
+        [dates addObject:[NSDate dateWithTimeIntervalSince1970:(year - 1970) * 365.2425 * 86400 + 43200.25]];
+    }
+    
+    for (NSString *name in @[@"Europe/Amsterdam", @"Africa/Monrovia"]) {
+        NSTimeZone *timeZone = [NSTimeZone timeZoneWithName:name];
+        
+        if (timeZone) {
+            [self assertRenderer:[[NXLogTimestampRenderer alloc] initWithDateFormatter:[self.class dateFormatterWithFormat:@"yyyy-MM-dd HH:mm:ss.SSSZ" timeZone:timeZone]] matchesDates:dates];
+        }
+    }
+}
+
+- (void)testMatchesDateFormatterWithinTheSameSecond {
+    NXLogTimestampRenderer *renderer = [[NXLogTimestampRenderer alloc] initWithDateFormatter:[self.class dateFormatterWithFormat:@"yyyy-MM-dd HH:mm:ss.SSSZ" timeZone:[NSTimeZone timeZoneWithName:@"Europe/Berlin"]]];
+    NSMutableArray<NSDate *> *dates = [NSMutableArray new];
+    
+    // Consecutive dates hit the cached fields of the second, on both sides of the epoch
+    
+    for (NSInteger millis = -2500; millis <= 2500; millis += 7) {
+        [dates addObject:[NSDate dateWithTimeIntervalSince1970:millis / 1000.0]];
+    }
+    
+    [self assertRenderer:renderer matchesDates:dates];
+}
+
+- (void)testOtherFormatsCalendarsAndDigitsUseTheDateFormatter {
+    NSTimeZone *timeZone = [NSTimeZone timeZoneWithName:@"UTC"];
+    NSDateFormatter *otherFormat = [self.class dateFormatterWithFormat:@"dd.MM.yyyy HH:mm" timeZone:timeZone];
+    NSDateFormatter *otherCalendar = [self.class dateFormatterWithFormat:@"yyyy-MM-dd HH:mm:ss" timeZone:timeZone];
+    NSDateFormatter *otherDigits = [self.class dateFormatterWithFormat:@"yyyy-MM-dd HH:mm:ss" timeZone:timeZone];
+    
+    otherCalendar.calendar = [[NSCalendar alloc] initWithCalendarIdentifier:NSCalendarIdentifierBuddhist];
+    otherDigits.locale = [NSLocale localeWithLocaleIdentifier:@"ar_EG"];
+    
+    for (NSDateFormatter *dateFormatter in @[otherFormat, otherCalendar, otherDigits]) {
+        NXLogTimestampRenderer *renderer = [[NXLogTimestampRenderer alloc] initWithDateFormatter:dateFormatter];
+        
+        XCTAssertFalse(renderer.fast, @"format %@, calendar %@, locale %@", dateFormatter.dateFormat, dateFormatter.calendar.calendarIdentifier, dateFormatter.locale.localeIdentifier);
+        [self assertRenderer:renderer matchesDates:[self.class sampleDates]];
+    }
+}
+
+- (void)testDetectsChangedDateFormatter {
+    NSDateFormatter *dateFormatter = [self.class dateFormatterWithFormat:@"yyyy-MM-dd HH:mm:ss" timeZone:[NSTimeZone timeZoneWithName:@"UTC"]];
+    NXLogTimestampRenderer *renderer = [[NXLogTimestampRenderer alloc] initWithDateFormatter:dateFormatter];
+    
+    XCTAssertTrue([renderer isValidForDateFormatter:dateFormatter]);
+    
+    dateFormatter.timeZone = [NSTimeZone timeZoneWithName:@"Europe/Berlin"];
+    XCTAssertFalse([renderer isValidForDateFormatter:dateFormatter]);
+    
+    dateFormatter.timeZone = [NSTimeZone timeZoneWithName:@"UTC"];
+    dateFormatter.dateFormat = @"yyyy-MM-dd HH:mm:ss.SSS";
+    XCTAssertFalse([renderer isValidForDateFormatter:dateFormatter]);
+}
+
+@end
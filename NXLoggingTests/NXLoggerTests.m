@@ -0,0 +1,157 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <XCTest/XCTest.h>
+#import <NXLogging/NXLogging.h>
+
+/// A log target collecting the messages it receives
+@interface NXTestCapturingLogTarget : NSObject <NXLogTarget>
+
+/// The messages received so far, after the pipeline delivered everything logged before
+@property (nonatomic, readonly) NSArray<NSString *> *messages;
+
+- (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter;
+
+@end
+
+@implementation NXTestCapturingLogTarget {
+    NSMutableArray<NSString *> *_messages; // Only accessed while synchronized
+}
+
+@synthesize maxLogLevel = _maxLogLevel;
+@synthesize logFormatter = _logFormatter;
+
+- (instancetype)initWithFormatter:(id<NXLogFormatter>)formatter {
+    self = [super init];
+    if (self) {
+        _maxLogLevel = NXLogLevelDebug;
+        _logFormatter = formatter;
+        _messages = [NSMutableArray new];
+    }
+    return self;
+}
+
+- (void)log:(NXLogLevel)level message:(id)message {
+    @synchronized(_messages) {
+        [_messages addObject:[NSString stringWithFormat:@"%@", message]];
+    }
+}
+
+- (NSArray<NSString *> *)messages {
+    [[NXLogPipeline sharedInstance] drain];
+    
+    @synchronized(_messages) {
+        return [_messages copy];
+    }
+}
+
+@end
+
+@interface NXLoggerTests : XCTestCase
+
+@end
+
+@implementation NXLoggerTests {
+    NXTestCapturingLogTarget *_target;
+    NXLogger *_logger;
+}
+
+- (void)setUp {
+    [super setUp];
+    
+    // Render the bare message without any header
+    
+    NXBasicLogFormatter *formatter = [NXBasicLogFormatter new];
+    
+    formatter.hiddenInfo = NXLogInfoAll;
+    formatter.expandsVariablesInFormat = YES;
+    
+    _target = [[NXTestCapturingLogTarget alloc] initWithFormatter:formatter];
+    _logger = [[NXLogger alloc] initWithName:@"com.naxos-software.NXLoggerTests" target:_target];
+    _logger.maxLogLevel = NXLogLevelDebug;
+    _logger.suppressesDuplicates = YES;
+}
+
+#pragma mark - Tests
+
+- (void)testRepeatsAreReportedWhenTheRunEnds {
+    for (int i = 0; i < 3; i++) {
+        [_logger log:NXLogLevelNotice site:NX_LOG_SITE format:@"Message %d", 42];
+    }
+    [_logger log:NXLogLevelNotice site:NX_LOG_SITE format:@"Message %d", 43];
+    
+    NSArray<NSString *> *expected = @[@"Message 42", @"Last message repeated 2 times", @"Message 43"];
+    
+    XCTAssertEqualObjects(_target.messages, expected);
+    XCTAssertEqual(_logger.suppressedCount, (NSUInteger)2);
+}
+
+- (void)testMessagesDifferingInLevelOrArgumentsAreNotDuplicates {
+    for (int i = 0; i < 2; i++) {
+        [_logger log:NXLogLevelNotice site:NX_LOG_SITE format:@"Message %d", i];
+    }
+    for (int i = 0; i < 2; i++) {
+        [_logger log:i ? NXLogLevelWarning : NXLogLevelNotice site:NX_LOG_SITE format:@"Message"];
+    }
+    
+    NSArray<NSString *> *expected = @[@"Message 0", @"Message 1", @"Message", @"Message"];
+    
+    XCTAssertEqualObjects(_target.messages, expected);
+    XCTAssertEqual(_logger.suppressedCount, (NSUInteger)0);
+}
+
+- (void)testFormattedMessageIsNotFormattedAgain {
+    
+    // The message formatted for the comparison is logged with "%@", so its percent signs stay literal
+    
+    [_logger log:NXLogLevelNotice site:NX_LOG_SITE format:@"%@ done", @"100%d"];
+    [_logger log:NXLogLevelNotice site:NX_LOG_SITE format:@"Progress %d%%", 50];
+    
+    NSArray<NSString *> *expected = @[@"100%d done", @"Progress 50%"];
+    
+    XCTAssertEqualObjects(_target.messages, expected);
+}
+
+- (void)testFormatWithVariablesIsFormattedByTheFormatter {
+    NSString *processName = [NSProcessInfo processInfo].processName;
+    
+    for (int i = 0; i < 2; i++) {
+        [_logger log:NXLogLevelNotice site:NX_LOG_SITE format:@"$(processName) %d%%", 42];
+    }
+    
+    NSArray<NSString *> *expected = @[[NSString stringWithFormat:@"%@ 42%%", processName]];
+    
+    XCTAssertEqualObjects(_target.messages, expected);
+    XCTAssertEqual(_logger.suppressedCount, (NSUInteger)1);
+}
+
+@end
@@ -0,0 +1,234 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <XCTest/XCTest.h>
+#import <NXLogging/NXLogging.h>
+#import <poll.h>
+#import <unistd.h>
+#import <netinet/in.h>
+#import <arpa/inet.h>
+#import <sys/socket.h>
+
+// How long the tests wait for the target to connect and send
+static const int NXTestTimeout = 5000; // ms
+
+@interface NXNetworkLogTargetTests : XCTestCase
+
+@end
+
+@implementation NXNetworkLogTargetTests {
+    int _listener;
+    int _connection;
+    uint16_t _port;
+}
+
+- (void)setUp {
+    [super setUp];
+    
+    _connection = -1;
+    _listener = [self listenOnPort:0];
+    
+    struct sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    
+    getsockname(_listener, (struct sockaddr *)&addr, &length);
+    _port = ntohs(addr.sin_port);
+}
+
+- (void)tearDown {
+    if (_connection >= 0) {
+        close(_connection);
+    }
+    if (_listener >= 0) {
+        close(_listener);
+    }
+    
+    [super tearDown];
+}
+
+#pragma mark - Helpers
+
+// A TCP socket listening on the loopback interface
+- (int)listenOnPort:(uint16_t)port {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    struct sockaddr_in addr = { 0 };
+    
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+- (NXNetworkLogTarget *)target {
+    NXBasicLogFormatter *formatter = [NXBasicLogFormatter new];
+    
+    formatter.hiddenInfo = NXLogInfoAll;
+    
+    return [[NXNetworkLogTarget alloc] initWithFormatter:formatter host:@"127.0.0.1" port:_port transport:NXNetworkLogTransportTCP];
+}
+
+// Accept the connection of the target and read from it, until the data received is complete or the time is up
+- (NSData *)receiveUntil:(BOOL (^)(NSData *data))complete {
+    NSMutableData *data = [NSMutableData new];
+    struct pollfd pfd = { _listener, POLLIN, 0 };
+    
+    if (_connection < 0) {
+        if (poll(&pfd, 1, NXTestTimeout) != 1) {
+            return data;
+        }
+        _connection = accept(_listener, NULL, NULL);
+    }
+    
+    pfd.fd = _connection;
+    
+    while (!complete(data) && poll(&pfd, 1, NXTestTimeout) == 1) {
+        char buffer[4096];
+        ssize_t length = recv(_connection, buffer, sizeof(buffer), 0);
+        
+        if (length <= 0) {
+            break;
+        }
+        [data appendBytes:buffer length:length];
+    }
+    return data;
+}
+
+// The records of data terminated by the byte
+- (NSArray<NSString *> *)recordsOf:(NSData *)data terminator:(char)terminator {
+    NSMutableArray<NSString *> *records = [NSMutableArray new];
+    const char *bytes = data.bytes;
+    NSUInteger start = 0;
+    
+    for (NSUInteger i = 0; i < data.length; i++) {
+        if (bytes[i] == terminator) {
+            [records addObject:[[NSString alloc] initWithBytes:bytes + start length:i - start encoding:NSUTF8StringEncoding]];
+            start = i + 1;
+        }
+    }
+    return records;
+}
+
+#pragma mark - Tests
+
+- (void)testGELFIsFramedWithNullBytes {
+    NXNetworkLogTarget *target = [self target];
+    
+    target.format = NXNetworkLogFormatGELF;
+    
+    [target log:NXLogLevelWarning message:@"Message 1"];
+    [target log:NXLogLevelError message:@"Line 1\nLine 2"];
+    
+    NSData *data = [self receiveUntil:^BOOL(NSData *data) {
+        return [self recordsOf:data terminator:'\0'].count >= 2;
+    }];
+    NSArray<NSString *> *records = [self recordsOf:data terminator:'\0'];
+    
+    XCTAssertEqual(records.count, (NSUInteger)2);
+    XCTAssertTrue(target.connected);
+    
+    NSArray<NSString *> *messages = @[@"Message 1", @"Line 1\nLine 2"];
+    NSArray<NSNumber *> *levels = @[@4, @3];
+    
+    for (NSUInteger i = 0; i < records.count; i++) {
+        NSDictionary *gelf = [NSJSONSerialization JSONObjectWithData:[records[i] dataUsingEncoding:NSUTF8StringEncoding] options:0 error:nil];
+        
+        XCTAssertEqualObjects(gelf[@"version"], @"1.1");
+        XCTAssertEqualObjects(gelf[@"short_message"], messages[i]);
+        XCTAssertEqualObjects(gelf[@"level"], levels[i]);
+    }
+}
+
+- (void)testOctetCounting {
+    NXNetworkLogTarget *target = [self target];
+    
+    target.framing = NXNetworkLogFramingOctetCounting;
+    
+    [target log:NXLogLevelNotice message:@"Message 1"];
+    [target log:NXLogLevelNotice message:@"Größe\n2"];
+    
+    NSString *expected = @"9 Message 1" @"9 Größe\n2"; // Lengths in bytes, not characters
+    NSData *expectedData = [expected dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *data = [self receiveUntil:^BOOL(NSData *data) {
+        return data.length >= expectedData.length;
+    }];
+    
+    XCTAssertEqualObjects(data, expectedData);
+}
+
+- (void)testMessagesAreKeptAndDropsReportedUntilReconnected {
+    
+    // Nobody listens at first
+    
+    close(_listener);
+    _listener = -1;
+    
+    NXNetworkLogTarget *target = [self target];
+    
+    target.queueCapacity = 40;
+    target.maxReconnectDelay = 0.5;
+    
+    // Only as many messages as fit into the queue are kept, "Message n\n" takes 10 bytes
+    
+    for (int i = 0; i < 10; i++) {
+        [target log:NXLogLevelNotice message:[NSString stringWithFormat:@"Message %d", i]];
+    }
+    
+    XCTAssertFalse(target.connected);
+    XCTAssertEqual(target.droppedCount, (NSUInteger)6);
+    
+    // The kept messages and the report of the dropped ones are sent, once the collector is back
+    
+    _listener = [self listenOnPort:_port];
+    XCTAssertGreaterThanOrEqual(_listener, 0);
+    
+    NSData *data = [self receiveUntil:^BOOL(NSData *data) {
+        return [self recordsOf:data terminator:'\n'].count >= 5;
+    }];
+    NSArray<NSString *> *records = [self recordsOf:data terminator:'\n'];
+    
+    XCTAssertEqual(records.count, (NSUInteger)5);
+    for (int i = 0; i < 4 && i < (int)records.count; i++) {
+        XCTAssertEqualObjects(records[i], ([NSString stringWithFormat:@"Message %d", i]));
+    }
+    XCTAssertTrue([records.lastObject hasPrefix:@"NXNetworkLogTarget dropped 6 log messages while 127.0.0.1:"], @"%@", records.lastObject);
+    XCTAssertEqual(target.droppedCount, (NSUInteger)6);
+}
+
+@end
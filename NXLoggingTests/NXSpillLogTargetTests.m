@@ -0,0 +1,247 @@
+// -----------------------------------------------------------------------------
+// This file is part of NXLogging.
+//
+// Copyright © 2016 Naxos Software Solutions GmbH. All rights reserved.
+//
+// Author: Martin Schaefer <martin.schaefer@naxos-software.de>
+//
+// NXLogging is licensed under the Simplified BSD License
+// -----------------------------------------------------------------------------
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+
+#import <XCTest/XCTest.h>
+#import <NXLogging/NXLogging.h>
+#import <stdatomic.h>
+
+/// The header preceding each message in a segment file, as NXSpillLogTarget writes it
+typedef struct {
+    uint32_t length;
+    int32_t level;
+} NXTestSpillHeader;
+
+/// A log target collecting the messages it receives, which can be held up until it is opened
+@interface NXTestBlockingLogTarget : NSObject <NXLogTarget>
+
+@property (nonatomic, readonly) NSArray<NSString *> *messages;
+
+- (instancetype)initOpen:(BOOL)open;
+
+/// Wait until the first message is being delivered
+- (BOOL)waitUntilEntered;
+/// Let the messages through
+- (void)open;
+
+@end
+
+@implementation NXTestBlockingLogTarget {
+    NSMutableArray<NSString *> *_messages; // Only accessed while synchronized
+    dispatch_semaphore_t _entered;
+    dispatch_semaphore_t _gate;
+    atomic_bool _open;
+}
+
+@synthesize maxLogLevel = _maxLogLevel;
+@synthesize logFormatter = _logFormatter;
+
+- (instancetype)initOpen:(BOOL)open {
+    self = [super init];
+    if (self) {
+        _maxLogLevel = NXLogLevelDebug;
+        _logFormatter = [NXBasicLogFormatter new];
+        _messages = [NSMutableArray new];
+        _entered = dispatch_semaphore_create(0);
+        _gate = dispatch_semaphore_create(0);
+        atomic_init(&_open, open);
+    }
+    return self;
+}
+
+- (void)log:(NXLogLevel)level message:(id)message {
+    dispatch_semaphore_signal(_entered);
+    
+    // Once the gate is open, every waiting message passes it and opens it for the next one
+    
+    if (!atomic_load(&_open)) {
+        dispatch_semaphore_wait(_gate, DISPATCH_TIME_FOREVER);
+        dispatch_semaphore_signal(_gate);
+    }
+    
+    @synchronized(_messages) {
+        [_messages addObject:[NSString stringWithFormat:@"%@", message]];
+    }
+}
+
+- (NSArray<NSString *> *)messages {
+    @synchronized(_messages) {
+        return [_messages copy];
+    }
+}
+
+- (BOOL)waitUntilEntered {
+    return dispatch_semaphore_wait(_entered, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)) == 0;
+}
+
+- (void)open {
+    atomic_store(&_open, true);
+    dispatch_semaphore_signal(_gate);
+}
+
+@end
+
+@interface NXSpillLogTargetTests : XCTestCase
+
+@end
+
+@implementation NXSpillLogTargetTests {
+    NSString *_directory;
+}
+
+- (void)setUp {
+    [super setUp];
+    
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:nil];
+    
+    [super tearDown];
+}
+
+#pragma mark - Helpers
+
+// The messages "Message first" to "Message last"
+- (NSArray<NSString *> *)messagesFrom:(int)first to:(int)last {
+    NSMutableArray<NSString *> *messages = [NSMutableArray new];
+    
+    for (int i = first; i <= last; i++) {
+        [messages addObject:[NSString stringWithFormat:@"Message %d", i]];
+    }
+    return messages;
+}
+
+- (BOOL)waitForTarget:(NXSpillLogTarget *)target toDeliver:(NSUInteger)count {
+    for (int i = 0; i < 500 && target.deliveredCount < count; i++) {
+        usleep(10000);
+    }
+    return target.deliveredCount == count;
+}
+
+- (NSArray<NSString *> *)segmentFiles {
+    NSArray<NSString *> *files = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:_directory error:nil];
+    
+    return [files filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"pathExtension == 'spill'"]];
+}
+
+#pragma mark - Tests
+
+- (void)testSpilledMessagesAreDeliveredInOrder {
+    NXTestBlockingLogTarget *blockingTarget = [[NXTestBlockingLogTarget alloc] initOpen:NO];
+    NXSpillLogTarget *target = [[NXSpillLogTarget alloc] initWithTarget:blockingTarget directory:_directory];
+    NSArray<NSString *> *messages = [self messagesFrom:0 to:9];
+    
+    target.memoryCapacity = 2;
+    
+    // Hold up the wrapped target with the first message, so the next two wait in memory and the rest is spilled
+    
+    [target log:NXLogLevelNotice message:messages[0]];
+    XCTAssertTrue([blockingTarget waitUntilEntered]);
+    
+    for (NSUInteger i = 1; i < messages.count; i++) {
+        [target log:NXLogLevelNotice message:messages[i]];
+    }
+    
+    XCTAssertEqual(target.memoryCount, (NSUInteger)2);
+    XCTAssertEqual(target.spilledCount, (NSUInteger)7);
+    XCTAssertGreaterThan(target.diskUsage, 0ULL);
+    XCTAssertGreaterThan([self segmentFiles].count, (NSUInteger)0);
+    
+    [blockingTarget open];
+    
+    XCTAssertTrue([self waitForTarget:target toDeliver:messages.count]);
+    XCTAssertEqualObjects(blockingTarget.messages, messages);
+    XCTAssertEqual(target.diskUsage, 0ULL);
+    XCTAssertEqual(target.droppedCount, (NSUInteger)0);
+}
+
+- (void)testSegmentsOfPreviousRunAreDeliveredFirst {
+    
+    // A segment as a previous run left it, with its last message cut short
+    
+    NSMutableData *segment = [NSMutableData new];
+    
+    for (NSString *message in [self messagesFrom:0 to:2]) {
+        NSData *bytes = [message dataUsingEncoding:NSUTF8StringEncoding];
+        NXTestSpillHeader header = { (uint32_t)bytes.length, NXLogLevelNotice };
+        
+        [segment appendBytes:&header length:sizeof(header)];
+        [segment appendData:bytes];
+    }
+    segment.length -= 3;
+    
+    [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:nil];
+    XCTAssertTrue([segment writeToFile:[_directory stringByAppendingPathComponent:@"00000000000000000001.spill"] atomically:NO]);
+    
+    NXTestBlockingLogTarget *collectingTarget = [[NXTestBlockingLogTarget alloc] initOpen:YES];
+    NXSpillLogTarget *target = [[NXSpillLogTarget alloc] initWithTarget:collectingTarget directory:_directory];
+    
+    [target log:NXLogLevelNotice message:@"Message 3"];
+    
+    NSArray<NSString *> *expected = @[@"Message 0", @"Message 1", @"Message 3"];
+    
+    XCTAssertTrue([self waitForTarget:target toDeliver:expected.count]);
+    XCTAssertEqualObjects(collectingTarget.messages, expected);
+    XCTAssertEqual([self segmentFiles].count, (NSUInteger)0);
+}
+
+- (void)testMessagesBeyondMaxDiskUsageAreDropped {
+    NXTestBlockingLogTarget *blockingTarget = [[NXTestBlockingLogTarget alloc] initOpen:NO];
+    NXSpillLogTarget *target = [[NXSpillLogTarget alloc] initWithTarget:blockingTarget directory:_directory];
+    NSArray<NSString *> *messages = [self messagesFrom:0 to:9];
+    unsigned long long spilledSize = sizeof(NXTestSpillHeader) + [messages[0] lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    
+    target.memoryCapacity = 1;
+    target.maxDiskUsage = 3 * spilledSize;
+    
+    // The first message holds up the wrapped target, the second waits in memory, three fit on disk
+    
+    [target log:NXLogLevelNotice message:messages[0]];
+    XCTAssertTrue([blockingTarget waitUntilEntered]);
+    
+    for (NSUInteger i = 1; i < messages.count; i++) {
+        [target log:NXLogLevelNotice message:messages[i]];
+    }
+    
+    XCTAssertEqual(target.spilledCount, (NSUInteger)3);
+    XCTAssertEqual(target.droppedCount, (NSUInteger)5);
+    XCTAssertEqual(target.diskUsage, 3 * spilledSize);
+    
+    [blockingTarget open];
+    
+    XCTAssertTrue([self waitForTarget:target toDeliver:5]);
+    XCTAssertEqualObjects(blockingTarget.messages, [self messagesFrom:0 to:4]);
+    XCTAssertEqual(target.diskUsage, 0ULL);
+}
+
+@end